@@ -8,17 +8,25 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include "cgi.h"
 
 #define MIN(x,y) ( (x)<(y) ? (x) : (y) )
 
+/*!
+ *  directory of the sample upload route, NULL if the route is disabled
+ */
+static char* _cgi_upload_dir;
+
 /*!
  *  Sample common gateway interface (CGI)
  *
@@ -31,10 +39,11 @@
 int TestCgiHandler( struct _HTTP_OBJ* this )
 {
   int   len1, len2;
-  int   bytes_written;
   int   error;
-  char  content1[512];
+  char  content1[1024];
   char  content2[1024];
+  const FORM*       query;
+  const FORM_FIELD* field;
   
   this->mimetyp = HTTP_MIME_TEXT_HTML;
   
@@ -49,10 +58,12 @@ int TestCgiHandler( struct _HTTP_OBJ* this )
     this->method_id, this->url_path, this->search_path
     );
   len1 = strlen( content1 );
-  
-  /* ensure proper EOS character, avoid buffer overflow */
-  this->body_len = MIN( this->body_len, 1000 );
-  this->body_ptr[this->body_len] = '\0';
+
+  /* list decoded parameters of the search path */
+  query = HTTP_GetQuery( this );
+  for( field = FORM_Next( query, NULL ); field != NULL && len1 < (int) sizeof(content1); field = FORM_Next( query, field ) )
+    len1 += snprintf( content1 + len1, sizeof(content1) - len1, "<p>*** %s : %s</p>\n", field->key, field->value );
+  len1 = MIN( len1, (int) sizeof(content1) - 1 );
   
   if( this->method_id == HTTP_POST_ID )
   {
@@ -73,17 +84,12 @@ int TestCgiHandler( struct _HTTP_OBJ* this )
   
   error = HTTP_SendHeader( this, HTTP_ACK_OK );
   if( error == HTTP_OK )
-  {
-    /* write header/content separation line */
-    bytes_written = HTTP_SOCKET_SEND( this->socket, "\r\n\r\n", 4 );
-    bytes_written += HTTP_SOCKET_SEND( this->socket, content1, len1 );
-    bytes_written += HTTP_SOCKET_SEND( this->socket, content2, len2 );
-  
-    if( bytes_written != this->content_len + 4 )
-    {
-      error = HTTP_CGI_EXEC_ERROR;
-    }
-  }
+    error = HTTP_SendContent( this, content1, len1 );
+  if( error == HTTP_OK )
+    error = HTTP_SendContent( this, content2, len2 );
+
+  if( error != HTTP_OK )
+    error = HTTP_CGI_EXEC_ERROR;
   
   return error;
 }
@@ -99,7 +105,6 @@ int TestCgiHandler( struct _HTTP_OBJ* this )
  */
 int DirCgiHandler( struct _HTTP_OBJ* this )
 {
-  int   bytes_written;
   int   error = HTTP_OK;
 
   char  content[1024];
@@ -110,13 +115,11 @@ int DirCgiHandler( struct _HTTP_OBJ* this )
   struct dirent*  ep;
   struct stat     s;
   int             filesize;
+  unsigned int    hash;
+  int             i;
 
   this->mimetyp = HTTP_MIME_APPLICATION_JSON;
   
-  /* ensure proper EOS character, avoid buffer overflow */
-  this->body_len = MIN( this->body_len, 1000 );
-  this->body_ptr[this->body_len] = '\0';
-  
   /* generate directory in JSON format */
   
   /* insert JSON array header */
@@ -203,19 +206,179 @@ int DirCgiHandler( struct _HTTP_OBJ* this )
   content_len += 1;
   
   this->content_len = content_len;
+
+  /* entity tag derived from the content, unchanged listings are not retransmitted */
+  for( i = 0, hash = 2166136261u; i < content_len; ++i )
+    hash = ( hash ^ (unsigned char) content[i] ) * 16777619u;
+  sprintf( entrybuf, "%x-%x", content_len, hash );
+  HTTP_SetValidators( this, entrybuf, false, 0 );
   
+  if( HTTP_IsNotModified( this ) )
+  {
+    error = HTTP_SendHeader( this, HTTP_ACK_NOT_MODIFIED );
+  }
+  else
+  {
+    error = HTTP_SendHeader( this, HTTP_ACK_OK );
+    if( error == HTTP_OK )
+      error = HTTP_SendContent( this, content, content_len );
+  }
+
+  if( error != HTTP_OK )
+    error = HTTP_CGI_EXEC_ERROR;
+  
+  return error;
+}
+
+
+
+
+/*!
+ *  Sample CGI handler serving a family of URLs, the sensor
+ *  is given by a path parameter of its route
+ *
+ *  Function parameters
+ *     - this:      pointer to HTTP Object
+ *    
+ *  Returnparameter
+ *     - R: 0 in case of success, otherwise error code
+ */
+int SensorCgiHandler( struct _HTTP_OBJ* this )
+{
+  const char* id;
+  int         id_len;
+  char        content[256];
+  int         len;
+  int         error;
+
+  this->mimetyp = HTTP_MIME_APPLICATION_JSON;
+
+  id = HTTP_GetPathParam( this, "id", & id_len );
+  if( id == NULL )
+    return HTTP_CGI_EXEC_ERROR;
+
+  len = snprintf( content, sizeof(content), "{\"sensor\": \"%.*s\", \"history\": []}\n", MIN( id_len, 64 ), id );
+  this->content_len = len;
+
   error = HTTP_SendHeader( this, HTTP_ACK_OK );
   if( error == HTTP_OK )
-  {
-    /* write header/content separation line */
-    bytes_written = HTTP_SOCKET_SEND( this->socket, "\r\n\r\n", 4 );
-    bytes_written += HTTP_SOCKET_SEND( this->socket, content, content_len );
+    error = HTTP_SendContent( this, content, len );
+
+  if( error != HTTP_OK )
+    error = HTTP_CGI_EXEC_ERROR;
   
-    if( bytes_written != this->content_len + 4 )
-    {
-      error = HTTP_CGI_EXEC_ERROR;
-    }
+  return error;
+}
+
+
+
+
+/*!
+ *  file name within the upload directory for a file part, the directory
+ *  of the client is stripped. Returns false for parts which are no files.
+ */
+static int _cgi_upload_filename( const MULTIPART_PART* part, char* filename, const int size )
+{
+  const char* basename = part->filename;
+  const char* p;
+
+  for( p = part->filename; *p != '\0'; ++p )
+  {
+    if( *p == '/' || *p == '\\' )
+      basename = p + 1;
+  }
+
+  if( basename[0] == '\0' || basename[0] == '.' )
+    return false;
+
+  snprintf( filename, size, "%s/%s", _cgi_upload_dir, basename );
+  return true;
+}
+
+
+/*!
+ *  Sample part handler of multipart uploads, files are written to the
+ *  upload directory while they are received, other fields are ignored
+ *
+ *  Function parameters
+ *     - arg:       pointer to HTTP Object
+ *     - part:      current part
+ *     - event:     MULTIPART_EVENT
+ *     - data:      data of the part for MULTIPART_PART_DATA
+ *     - len:       length of data
+ *    
+ *  Returnparameter
+ *     - R: 0 in case of success, otherwise error code
+ */
+int UploadPartHandler( void* arg, MULTIPART_PART* part, const int event, const char* data, const long len )
+{
+  char              filename[300];
+
+  (void) arg;
+  (void) data;
+  (void) len;
+
+  switch( event )
+  {
+    case MULTIPART_PART_BEGIN:
+      if( _cgi_upload_filename( part, filename, sizeof(filename) ) )
+      {
+        /* data is written by the parser from now on */
+        part->fd = open( filename, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+        if( part->fd < 0 )
+          return HTTP_CGI_EXEC_ERROR;
+      }
+      break;
+
+    case MULTIPART_PART_END:
+    case MULTIPART_PART_ABORT:
+      if( part->fd >= 0 )
+      {
+        close( part->fd );
+        part->fd = -1;
+
+        /* do not keep truncated files */
+        if( event == MULTIPART_PART_ABORT && _cgi_upload_filename( part, filename, sizeof(filename) ) )
+          unlink( filename );
+      }
+      break;
+
+    default:
+      break;
   }
+
+  return 0;
+}
+
+
+/*!
+ *  Sample CGI handler responding to a multipart upload after all 
+ *  parts have been passed to UploadPartHandler()
+ *
+ *  Function parameters
+ *     - this:      pointer to HTTP Object
+ *    
+ *  Returnparameter
+ *     - R: 0 in case of success, otherwise error code
+ */
+int UploadCgiHandler( struct _HTTP_OBJ* this )
+{
+  char  content[128];
+  int   len;
+  int   error;
+
+  this->mimetyp = HTTP_MIME_APPLICATION_JSON;
+
+  len = snprintf( content, sizeof(content), "{\"parts\": %d, \"bytes\": %ld}\n",
+                  this->upload.nr_parts, this->upload.total_len );
+  this->content_len = len;
+
+  error = HTTP_SendHeader( this, HTTP_ACK_OK );
+  if( error == HTTP_OK )
+    error = HTTP_SendContent( this, content, len );
+
+  if( error != HTTP_OK )
+    error = HTTP_CGI_EXEC_ERROR;
   
   return error;
 }
@@ -223,16 +386,53 @@ int DirCgiHandler( struct _HTTP_OBJ* this )
 
 
 
+/*!
+ *  Prepare the directory of the sample upload route, it is created when 
+ *  missing. Uploaded files must not be served as static content, hence
+ *  the directory is refused when it is located within the root directory.
+ */
+static int _cgi_init_upload_dir( struct _HTTP_OBJ* this, const char* upload_dir )
+{
+  char  root_path[PATH_MAX];
+  int   created = ( mkdir( upload_dir, 0755 ) == 0 );
+
+  if( ! created && errno != EEXIST )
+  {
+    fprintf( stderr, "Could not create upload directory %s, error: %s!\n", upload_dir, strerror( errno ) );
+    return HTTP_CGI_EXEC_ERROR;
+  }
+
+  _cgi_upload_dir = realpath( upload_dir, NULL );
+  if( _cgi_upload_dir == NULL || realpath( this->ht_root_dir, root_path ) == NULL )
+  {
+    fprintf( stderr, "Could not resolve upload directory %s, error: %s!\n", upload_dir, strerror( errno ) );
+    return HTTP_CGI_EXEC_ERROR;
+  }
+
+  if( strncmp( _cgi_upload_dir, root_path, strlen( root_path ) ) == 0 &&
+      ( _cgi_upload_dir[strlen( root_path )] == '\0' || _cgi_upload_dir[strlen( root_path )] == '/' ) )
+  {
+    fprintf( stderr, "Upload directory %s must not be located within the root directory!\n", upload_dir );
+    if( created )
+      rmdir( upload_dir );
+    return HTTP_CGI_EXEC_ERROR;
+  }
+
+  return 0;
+}
+
+
 /*!
  *  Sample registration of CGI handlers
  *
  *  Function parameters
- *     - this:      pointer to HTTP Object
+ *     - this:       pointer to HTTP Object
+ *     - upload_dir: directory receiving files of the upload route, NULL disables the route
  *    
  *  Returnparameter
  *     - R: 0 in case of success, otherwise error code
  */
-int RegisterCgiHandlers( struct _HTTP_OBJ* this )
+int RegisterCgiHandlers( struct _HTTP_OBJ* this, const char* upload_dir )
 {
   int error = 0;
 
@@ -245,6 +445,16 @@ int RegisterCgiHandlers( struct _HTTP_OBJ* this )
   if( ! error ) 
     error = HTTP_AddCgiHanlder( this, TestCgiHandler, HTTP_POST_ID, "form" );
 
+  if( ! error ) 
+    error = HTTP_AddCgiRoute( this, SensorCgiHandler, HTTP_GET_ID, "/sensor/{id}/history", true );
+
+  /* uploads are accepted without authentication, hence only on demand */
+  if( ! error && upload_dir != NULL )
+    error = _cgi_init_upload_dir( this, upload_dir );
+
+  if( ! error && upload_dir != NULL )
+    error = HTTP_AddUploadRoute( this, UploadCgiHandler, UploadPartHandler, "/upload", true );
+
   
   return error;
 }
@@ -40,7 +40,38 @@ int DirCgiHandler( struct _HTTP_OBJ* this );
 
 
 /*!
- *  Sample registration of CGI handlers
+ *  Sample CGI handler serving a family of URLs, the sensor
+ *  is given by a path parameter of its route
+ *
+ *  Function parameters
+ *     - this:      pointer to HTTP Object
+ *    
+ *  Returnparameter
+ *     - R: 0 in case of success, otherwise error code
+ */
+int SensorCgiHandler( struct _HTTP_OBJ* this );
+
+
+/*!
+ *  Sample part handler of multipart uploads, files are written to the
+ *  upload directory while they are received, other fields are ignored
+ *
+ *  Function parameters
+ *     - arg:       pointer to HTTP Object
+ *     - part:      current part
+ *     - event:     MULTIPART_EVENT
+ *     - data:      data of the part for MULTIPART_PART_DATA
+ *     - len:       length of data
+ *    
+ *  Returnparameter
+ *     - R: 0 in case of success, otherwise error code
+ */
+int UploadPartHandler( void* arg, MULTIPART_PART* part, const int event, const char* data, const long len );
+
+
+/*!
+ *  Sample CGI handler responding to a multipart upload after all 
+ *  parts have been passed to UploadPartHandler()
  *
  *  Function parameters
  *     - this:      pointer to HTTP Object
@@ -48,7 +79,20 @@ int DirCgiHandler( struct _HTTP_OBJ* this );
  *  Returnparameter
  *     - R: 0 in case of success, otherwise error code
  */
-int RegisterCgiHandlers( struct _HTTP_OBJ* this );
+int UploadCgiHandler( struct _HTTP_OBJ* this );
+
+
+/*!
+ *  Sample registration of CGI handlers
+ *
+ *  Function parameters
+ *     - this:       pointer to HTTP Object
+ *     - upload_dir: directory receiving files of the upload route, NULL disables the route
+ *    
+ *  Returnparameter
+ *     - R: 0 in case of success, otherwise error code
+ */
+int RegisterCgiHandlers( struct _HTTP_OBJ* this, const char* upload_dir );
 
 
 #endif /* #ifndef _CGI_H */
\ No newline at end of file
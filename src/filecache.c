@@ -0,0 +1,710 @@
+/*
+ *  filecache.c
+ *  idefix
+ *
+ *  in-memory cache for static content, the least recently used files 
+ *  are evicted when the byte budget is exceeded and modified files
+ *  are invalidated by inotify. Names of missing files are cached, too.
+ *
+ *  Copyright 2010 GNU General Public Licence. All rights reserved.
+ *
+ */
+
+/* -- includes -------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <dirent.h>
+#include <time.h>
+#include <stdbool.h>
+#include <sys/inotify.h>
+
+#include "filecache.h"
+
+
+/* -- const definitions -----------------------------------------------------------*/
+
+
+/*!
+ *  Modifications which invalidate cached files
+ */
+#define FILECACHE_WATCH_MASK        ( IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE | \
+                                      IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF )
+
+
+/*!
+ *  Size of buffer for reading inotify events
+ */
+#define FILECACHE_EVENT_BUF_LEN     4096
+
+
+/* -- local functions -------------------------------------------------------------*/
+
+
+/*!
+ *  FNV-1a hash of a file name
+ */
+static unsigned int _filecache_hash( const char* path )
+{
+  unsigned int hash = 2166136261u;
+
+  while( *path )
+  {
+    hash ^= (unsigned char) *path++;
+    hash *= 16777619u;
+  }
+
+  return hash % FILECACHE_HASH_SIZE;
+}
+
+
+/*!
+ *  Only files with unambiguous names are cached, otherwise an 
+ *  inotify event would not match the name of the cached file
+ */
+static int _filecache_is_canonical( const char* path )
+{
+  return ( strstr( path, "//" ) == NULL && strstr( path, "/./" ) == NULL && strstr( path, "/../" ) == NULL );
+}
+
+
+/*!
+ *  release memory of entry
+ */
+static void _filecache_free( FILECACHE_ENTRY* entry )
+{
+  free( entry->path );
+  free( entry->data );
+  free( entry );
+}
+
+
+/*!
+ *  move entry to the front of the LRU list, missing files are kept in a list 
+ *  of their own in order not to evict content
+ */
+static void _filecache_lru_insert( FILECACHE* cache, FILECACHE_ENTRY* entry )
+{
+  FILECACHE_ENTRY** head = entry->missing ? & cache->miss_head : & cache->lru_head;
+  FILECACHE_ENTRY** tail = entry->missing ? & cache->miss_tail : & cache->lru_tail;
+
+  entry->lru_prev = NULL;
+  entry->lru_next = *head;
+  if( *head != NULL )
+    (*head)->lru_prev = entry;
+  else
+    *tail = entry;
+  *head = entry;
+}
+
+
+/*!
+ *  remove entry from LRU list
+ */
+static void _filecache_lru_remove( FILECACHE* cache, FILECACHE_ENTRY* entry )
+{
+  FILECACHE_ENTRY** head = entry->missing ? & cache->miss_head : & cache->lru_head;
+  FILECACHE_ENTRY** tail = entry->missing ? & cache->miss_tail : & cache->lru_tail;
+
+  if( entry->lru_prev != NULL )
+    entry->lru_prev->lru_next = entry->lru_next;
+  else
+    *head = entry->lru_next;
+
+  if( entry->lru_next != NULL )
+    entry->lru_next->lru_prev = entry->lru_prev;
+  else
+    *tail = entry->lru_prev;
+}
+
+
+/*!
+ *  remove entry from the cache, it is released when it is not referenced anymore
+ */
+static void _filecache_unlink( FILECACHE* cache, FILECACHE_ENTRY* entry )
+{
+  FILECACHE_ENTRY** pp = & cache->hash_tab[ _filecache_hash( entry->path ) ];
+
+  while( *pp != entry )
+    pp = & (*pp)->hash_next;
+  *pp = entry->hash_next;
+
+  _filecache_lru_remove( cache, entry );
+  if( entry->missing )
+    --cache->nr_missing;
+  else
+    cache->used -= entry->size;
+  entry->linked = false;
+
+  if( entry->refcnt == 0 )
+    _filecache_free( entry );
+}
+
+
+/*!
+ *  find entry for given file name
+ */
+static FILECACHE_ENTRY* _filecache_find( FILECACHE* cache, const char* path )
+{
+  FILECACHE_ENTRY* entry = cache->hash_tab[ _filecache_hash( path ) ];
+
+  while( entry != NULL && strcmp( entry->path, path ) != 0 )
+    entry = entry->hash_next;
+
+  return entry;
+}
+
+
+/*!
+ *  remove all entries
+ */
+static void _filecache_flush( FILECACHE* cache )
+{
+  while( cache->lru_head != NULL )
+    _filecache_unlink( cache, cache->lru_head );
+
+  while( cache->miss_head != NULL )
+    _filecache_unlink( cache, cache->miss_head );
+}
+
+
+/*!
+ *  add entry to hash table and LRU list
+ */
+static void _filecache_link( FILECACHE* cache, FILECACHE_ENTRY* entry )
+{
+  const unsigned int hash = _filecache_hash( entry->path );
+
+  entry->hash_next = cache->hash_tab[hash];
+  cache->hash_tab[hash] = entry;
+  _filecache_lru_insert( cache, entry );
+  if( entry->missing )
+    ++cache->nr_missing;
+  else
+    cache->used += entry->size;
+  entry->linked = true;
+}
+
+
+/*!
+ *  watch given directory and its subdirectories, path is terminated by '/'
+ */
+static void _filecache_watch_dir( FILECACHE* cache, const char* path, const int depth )
+{
+  FILECACHE_WATCH*  watch_tab;
+  struct dirent*    dir_entry;
+  DIR*              dir;
+  char*             sub_path;
+  int               wd, i;
+
+  wd = inotify_add_watch( cache->inotify_fd, path, FILECACHE_WATCH_MASK | IN_ONLYDIR );
+  if( wd < 0 )
+    return;
+
+  /* a directory which is watched already, e.g. after it has been moved, keeps its descriptor */
+  for( i = 0; i < cache->nr_watches && cache->watch_tab[i].wd != wd; ++i )
+    ;
+
+  if( i == cache->nr_watches )
+  {
+    watch_tab = realloc( cache->watch_tab, ( cache->nr_watches + 1 ) * sizeof( FILECACHE_WATCH ) );
+    if( watch_tab == NULL )
+      return;
+    cache->watch_tab = watch_tab;
+    watch_tab[i].wd   = wd;
+    watch_tab[i].path = NULL;
+    ++cache->nr_watches;
+  }
+
+  free( cache->watch_tab[i].path );
+  cache->watch_tab[i].path = strdup( path );
+  if( cache->watch_tab[i].path == NULL )
+  {
+    cache->watch_tab[i] = cache->watch_tab[--cache->nr_watches];
+    return;
+  }
+
+  if( depth >= FILECACHE_MAX_DEPTH || ( dir = opendir( path ) ) == NULL )
+    return;
+
+  while( ( dir_entry = readdir( dir ) ) != NULL )
+  {
+    if( dir_entry->d_type != DT_DIR || dir_entry->d_name[0] == '.' )
+      continue;
+
+    sub_path = malloc( strlen( path ) + strlen( dir_entry->d_name ) + 2 );
+    if( sub_path == NULL )
+      break;
+    sprintf( sub_path, "%s%s/", path, dir_entry->d_name );
+    _filecache_watch_dir( cache, sub_path, depth + 1 );
+    free( sub_path );
+  }
+
+  closedir( dir );
+}
+
+
+/*!
+ *  directory of given watch descriptor, NULL if unknown
+ */
+static const char* _filecache_watch_path( FILECACHE* cache, const int wd )
+{
+  int i;
+
+  for( i = 0; i < cache->nr_watches; ++i )
+  {
+    if( cache->watch_tab[i].wd == wd )
+      return cache->watch_tab[i].path;
+  }
+
+  return NULL;
+}
+
+
+/*!
+ *  stop tracking watch descriptor which has been removed by the kernel,
+ *  e.g. since its directory has been deleted
+ */
+static void _filecache_unwatch( FILECACHE* cache, const int wd )
+{
+  int i;
+
+  for( i = 0; i < cache->nr_watches; ++i )
+  {
+    if( cache->watch_tab[i].wd == wd )
+    {
+      free( cache->watch_tab[i].path );
+      cache->watch_tab[i] = cache->watch_tab[--cache->nr_watches];
+      return;
+    }
+  }
+}
+
+
+/*!
+ *  events got lost, forget all watched directories and watch the 
+ *  directory tree as it is now. Directories which still exist keep
+ *  their descriptors.
+ */
+static void _filecache_rewatch( FILECACHE* cache )
+{
+  int i;
+
+  for( i = 0; i < cache->nr_watches; ++i )
+    free( cache->watch_tab[i].path );
+  cache->nr_watches = 0;
+
+  _filecache_watch_dir( cache, cache->root_path, 0 );
+}
+
+
+/*!
+ *  invalidate cached files according to inotify event
+ */
+static void _filecache_handle_event( FILECACHE* cache, const struct inotify_event* event )
+{
+  const char*       dir_path = _filecache_watch_path( cache, event->wd );
+  FILECACHE_ENTRY*  entry;
+  char*             path;
+
+  ++cache->generation;
+
+  if( event->mask & IN_Q_OVERFLOW )
+  {
+    _filecache_flush( cache );
+    _filecache_rewatch( cache );
+    return;
+  }
+
+  /* directory has been deleted or moved away, its files are not watched anymore */
+  if( event->mask & IN_IGNORED )
+  {
+    _filecache_flush( cache );
+    _filecache_unwatch( cache, event->wd );
+    return;
+  }
+
+  if( ( event->mask & IN_ISDIR ) || event->len == 0 || dir_path == NULL )
+  {
+    /* a whole directory changed or events got lost */
+    _filecache_flush( cache );
+
+    if( dir_path != NULL && ( event->mask & IN_ISDIR ) && ( event->mask & ( IN_CREATE | IN_MOVED_TO ) ) )
+    {
+      path = malloc( strlen( dir_path ) + strlen( event->name ) + 2 );
+      if( path != NULL )
+      {
+        sprintf( path, "%s%s/", dir_path, event->name );
+        _filecache_watch_dir( cache, path, 1 );
+        free( path );
+      }
+    }
+    return;
+  }
+
+  path = malloc( strlen( dir_path ) + strlen( event->name ) + 1 );
+  if( path == NULL )
+  {
+    _filecache_flush( cache );
+    return;
+  }
+
+  sprintf( path, "%s%s", dir_path, event->name );
+  if( ( entry = _filecache_find( cache, path ) ) != NULL )
+    _filecache_unlink( cache, entry );
+  free( path );
+}
+
+
+/*!
+ *  Check whether modifications of the directory of given file are watched
+ */
+static int _filecache_is_watched( FILECACHE* cache, const char* path )
+{
+  const char* sep = strrchr( path, '/' );
+  int         len, i;
+
+  if( sep == NULL )
+    return false;
+
+  len = sep - path + 1;
+  for( i = 0; i < cache->nr_watches; ++i )
+  {
+    if( (int) strlen( cache->watch_tab[i].path ) == len && strncmp( cache->watch_tab[i].path, path, len ) == 0 )
+      return true;
+  }
+
+  return false;
+}
+
+
+/*!
+ *  thread processing inotify events
+ */
+static void* _filecache_watcher( void* arg )
+{
+  FILECACHE*                  cache = (FILECACHE *) arg;
+  char                        buf[FILECACHE_EVENT_BUF_LEN] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+  const struct inotify_event* event;
+  long                        n, pos;
+
+  for( ;; )
+  {
+    n = read( cache->inotify_fd, buf, sizeof( buf ) );
+    if( n < 0 && errno == EINTR )
+      continue;
+    if( n <= 0 )
+      break;
+
+    /* FILECACHE_Exit() cancels the thread only while it waits for events */
+    pthread_setcancelstate( PTHREAD_CANCEL_DISABLE, NULL );
+    pthread_mutex_lock( & cache->mutex );
+    for( pos = 0; pos < n; pos += sizeof( struct inotify_event ) + event->len )
+    {
+      event = (const struct inotify_event *) & buf[pos];
+      _filecache_handle_event( cache, event );
+    }
+    pthread_mutex_unlock( & cache->mutex );
+    pthread_setcancelstate( PTHREAD_CANCEL_ENABLE, NULL );
+  }
+
+  return NULL;
+}
+
+
+/* -- public prototypes ----------------------------------------------------------*/
+
+
+/*******************************************************************************
+ * FILECACHE_Init() 
+ *                                                                         */ /*!
+ * Initialize empty file cache and start watching the root directory 
+ * and its subdirectories for modifications.
+ *                                                                              
+ * Function parameters
+ *     - cache:       pointer to file cache
+ *     - root_dir:    root directory for static web content
+ *     - budget:      maximum number of bytes of cached content
+ *
+ * Returnparameter
+ *     - R: 0 in case of success, -1 when modifications cannot be watched
+ *
+ *******************************************************************************/
+int FILECACHE_Init( FILECACHE* cache, const char* root_dir, const long budget )
+{
+  const int len = strlen( root_dir );
+  char*     path;
+
+  memset( cache, 0, sizeof( FILECACHE ) );
+  cache->budget = budget;
+  pthread_mutex_init( & cache->mutex, NULL );
+
+  cache->inotify_fd = inotify_init1( IN_CLOEXEC );
+  if( cache->inotify_fd < 0 )
+    return -1;
+
+  /* same notation of the root directory as within the HTTP object */
+  path = malloc( len + 2 );
+  if( path == NULL )
+  {
+    close( cache->inotify_fd );
+    cache->inotify_fd = -1;
+    return -1;
+  }
+  strcpy( path, root_dir );
+  if( len == 0 || path[len-1] != '/' )
+    strcat( path, "/" );
+
+  cache->root_path = path;
+  _filecache_watch_dir( cache, path, 0 );
+
+  if( cache->nr_watches == 0 || pthread_create( & cache->watcher, NULL, _filecache_watcher, cache ) != 0 )
+  {
+    close( cache->inotify_fd );
+    cache->inotify_fd = -1;
+    return -1;
+  }
+
+  return 0;
+}
+
+
+/*******************************************************************************
+ * FILECACHE_Exit() 
+ *                                                                         */ /*!
+ * Stop watching and release all entries. No entry must be referenced anymore.
+ *                                                                              
+ * Function parameters
+ *     - cache:       pointer to file cache
+ *
+ *******************************************************************************/
+void FILECACHE_Exit( FILECACHE* cache )
+{
+  int i;
+
+  if( cache->inotify_fd >= 0 )
+  {
+    pthread_cancel( cache->watcher );
+    pthread_join( cache->watcher, NULL );
+    close( cache->inotify_fd );
+    cache->inotify_fd = -1;
+  }
+
+  _filecache_flush( cache );
+
+  for( i = 0; i < cache->nr_watches; ++i )
+    free( cache->watch_tab[i].path );
+  free( cache->watch_tab );
+  cache->watch_tab  = NULL;
+  cache->nr_watches = 0;
+  free( cache->root_path );
+  cache->root_path  = NULL;
+
+  pthread_mutex_destroy( & cache->mutex );
+}
+
+
+/*******************************************************************************
+ * FILECACHE_Lookup() 
+ *                                                                         */ /*!
+ * Retrieve cached file, the entry has to be given back by FILECACHE_Unref()
+ *                                                                              
+ * Function parameters
+ *     - cache:       pointer to file cache
+ *     - path:        resolved file name
+ *     - generation:  returns state of the cache, to be passed to FILECACHE_Insert()
+ *                    after a miss
+ *
+ * Returnparameter
+ *     - R: referenced entry, NULL when the file is not cached
+ *
+ *******************************************************************************/
+FILECACHE_ENTRY* FILECACHE_Lookup( FILECACHE* cache, const char* path, unsigned long* generation )
+{
+  FILECACHE_ENTRY* entry;
+
+  pthread_mutex_lock( & cache->mutex );
+
+  *generation = cache->generation;
+  entry = _filecache_find( cache, path );
+
+  /* file might have been created in a directory which is not watched */
+  if( entry != NULL && entry->missing && time( NULL ) >= entry->expires )
+  {
+    _filecache_unlink( cache, entry );
+    entry = NULL;
+  }
+
+  if( entry != NULL )
+  {
+    ++entry->refcnt;
+    _filecache_lru_remove( cache, entry );
+    _filecache_lru_insert( cache, entry );
+  }
+
+  pthread_mutex_unlock( & cache->mutex );
+
+  return entry;
+}
+
+
+/*******************************************************************************
+ * FILECACHE_Insert() 
+ *                                                                         */ /*!
+ * Read opened file into the cache, the least recently used entries are 
+ * evicted if required. The file is not cached when it is too big, when its
+ * directory is not watched or when the cache has been invalidated since the 
+ * lookup.
+ *                                                                              
+ * Function parameters
+ *     - cache:       pointer to file cache
+ *     - path:        resolved file name
+ *     - fd:          opened file
+ *     - file_stat:   status of the opened file
+ *     - generation:  as returned by the preceding FILECACHE_Lookup()
+ *
+ * Returnparameter
+ *     - R: referenced entry, NULL when the file is not cached
+ *
+ *******************************************************************************/
+FILECACHE_ENTRY* FILECACHE_Insert( 
+  FILECACHE*          cache, 
+  const char*         path, 
+  const int           fd, 
+  const struct stat*  file_stat, 
+  const unsigned long generation 
+)
+{
+  const long        size = file_stat->st_size;
+  FILECACHE_ENTRY*  entry;
+  FILECACHE_ENTRY*  existing;
+  long              n, pos = 0;
+
+  if( size > cache->budget / FILECACHE_MAX_FILE_FRACTION || ! _filecache_is_canonical( path ) )
+    return NULL;
+
+  /* read file outside of the lock */
+  entry = calloc( 1, sizeof( FILECACHE_ENTRY ) );
+  if( entry == NULL )
+    return NULL;
+
+  entry->path  = strdup( path );
+  entry->data  = malloc( size > 0 ? size : 1 );
+  entry->size  = size;
+  entry->mtime = file_stat->st_mtime;
+  entry->ino   = file_stat->st_ino;
+  if( entry->path == NULL || entry->data == NULL )
+  {
+    _filecache_free( entry );
+    return NULL;
+  }
+
+  while( pos < size && ( n = pread( fd, entry->data + pos, size - pos, pos ) ) > 0 )
+    pos += n;
+  if( pos < size )
+  {
+    _filecache_free( entry );
+    return NULL;
+  }
+
+  pthread_mutex_lock( & cache->mutex );
+
+  /* file might have been modified while it was read */
+  if( cache->generation != generation || ! _filecache_is_watched( cache, path ) )
+  {
+    pthread_mutex_unlock( & cache->mutex );
+    _filecache_free( entry );
+    return NULL;
+  }
+
+  /* another thread was faster */
+  if( ( existing = _filecache_find( cache, path ) ) != NULL )
+    _filecache_unlink( cache, existing );
+
+  while( cache->used + size > cache->budget && cache->lru_tail != NULL )
+    _filecache_unlink( cache, cache->lru_tail );
+
+  _filecache_link( cache, entry );
+  entry->refcnt = 1;
+
+  pthread_mutex_unlock( & cache->mutex );
+
+  return entry;
+}
+
+
+/*******************************************************************************
+ * FILECACHE_InsertMissing() 
+ *                                                                         */ /*!
+ * Cache the name of a file which does not exist or is no regular file. The
+ * least recently used name is evicted when FILECACHE_MAX_MISSING names are
+ * cached already. The entry is invalidated by the creation of the file or 
+ * after FILECACHE_MISSING_TTL seconds.
+ *                                                                              
+ * Function parameters
+ *     - cache:       pointer to file cache
+ *     - path:        resolved file name
+ *     - generation:  as returned by the preceding FILECACHE_Lookup()
+ *
+ *******************************************************************************/
+void FILECACHE_InsertMissing( FILECACHE* cache, const char* path, const unsigned long generation )
+{
+  FILECACHE_ENTRY*  entry;
+
+  if( ! _filecache_is_canonical( path ) )
+    return;
+
+  entry = calloc( 1, sizeof( FILECACHE_ENTRY ) );
+  if( entry == NULL )
+    return;
+
+  entry->path    = strdup( path );
+  entry->missing = true;
+  entry->expires = time( NULL ) + FILECACHE_MISSING_TTL;
+  if( entry->path == NULL )
+  {
+    _filecache_free( entry );
+    return;
+  }
+
+  pthread_mutex_lock( & cache->mutex );
+
+  /* file might have been created meanwhile, or another thread was faster */
+  if( cache->generation != generation || _filecache_find( cache, path ) != NULL )
+  {
+    pthread_mutex_unlock( & cache->mutex );
+    _filecache_free( entry );
+    return;
+  }
+
+  if( cache->nr_missing >= FILECACHE_MAX_MISSING )
+    _filecache_unlink( cache, cache->miss_tail );
+
+  _filecache_link( cache, entry );
+
+  pthread_mutex_unlock( & cache->mutex );
+}
+
+
+/*******************************************************************************
+ * FILECACHE_Unref() 
+ *                                                                         */ /*!
+ * Give back entry retrieved by FILECACHE_Lookup() or FILECACHE_Insert()
+ *                                                                              
+ * Function parameters
+ *     - cache:       pointer to file cache
+ *     - entry:       entry which is not used anymore
+ *
+ *******************************************************************************/
+void FILECACHE_Unref( FILECACHE* cache, FILECACHE_ENTRY* entry )
+{
+  pthread_mutex_lock( & cache->mutex );
+
+  if( --entry->refcnt == 0 && ! entry->linked )
+    _filecache_free( entry );
+
+  pthread_mutex_unlock( & cache->mutex );
+}
@@ -0,0 +1,226 @@
+/*
+ *  filecache.h
+ *  idefix
+ *
+ *  in-memory cache for static content, the least recently used files 
+ *  are evicted when the byte budget is exceeded and modified files
+ *  are invalidated by inotify. Names of missing files are cached, too.
+ *
+ *  Copyright 2010 GNU General Public Licence. All rights reserved.
+ *
+ */
+
+#ifndef _FILECACHE_H
+#define _FILECACHE_H
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+
+/* -- const definitions -----------------------------------------------------------*/
+
+
+/*!
+ *  Number of hash buckets
+ */
+#define FILECACHE_HASH_SIZE         256
+
+
+/*!
+ *  Files bigger than the given fraction of the budget are not cached
+ */
+#define FILECACHE_MAX_FILE_FRACTION 4
+
+
+/*!
+ *  Maximum depth of subdirectories of the root directory which are watched
+ */
+#define FILECACHE_MAX_DEPTH         8
+
+
+/*!
+ *  Maximum number of cached names of missing files
+ */
+#define FILECACHE_MAX_MISSING       256
+
+
+/*!
+ *  Seconds after which a missing file is looked up again, in case its
+ *  creation is not reported by inotify
+ */
+#define FILECACHE_MISSING_TTL       10
+
+
+
+/* -- public types    -----------------------------------------------------------*/
+
+
+/*!
+ *  Cached file, contents and metadata stay valid as long as it is referenced
+ */
+typedef struct _FILECACHE_ENTRY
+{
+  /* public members */
+  char*                     path;         /* resolved file name, key of the entry */
+  char*                     data;         /* file content, NULL if missing */
+  long                      size;         /* file length in bytes */
+  time_t                    mtime;        /* time of last modification */
+  ino_t                     ino;          /* inode number of the file */
+  int                       missing;      /* there is no regular file of this name */
+
+  /* private members */
+  time_t                    expires;      /* entry of missing file is not valid anymore, 0 for others */
+  int                       refcnt;       /* number of pending users */
+  int                       linked;       /* entry is in hash table and LRU list */
+  struct _FILECACHE_ENTRY*  hash_next;    /* next entry in same bucket */
+  struct _FILECACHE_ENTRY*  lru_prev;     /* more recently used entry */
+  struct _FILECACHE_ENTRY*  lru_next;     /* less recently used entry */
+} FILECACHE_ENTRY;
+
+
+/*!
+ *  Watched directory
+ */
+typedef struct
+{
+  int                       wd;           /* inotify watch descriptor */
+  char*                     path;         /* directory name terminated by '/' */
+} FILECACHE_WATCH;
+
+
+/*!
+ *  File cache, shared by all threads of a process
+ */
+typedef struct _FILECACHE
+{
+  FILECACHE_ENTRY*          hash_tab[FILECACHE_HASH_SIZE];
+  FILECACHE_ENTRY*          lru_head;     /* most recently used entry */
+  FILECACHE_ENTRY*          lru_tail;     /* least recently used entry */
+  FILECACHE_ENTRY*          miss_head;    /* most recently used entry of a missing file */
+  FILECACHE_ENTRY*          miss_tail;    /* least recently used entry of a missing file */
+  int                       nr_missing;   /* number of entries of missing files */
+  long                      budget;       /* maximum number of bytes of cached content */
+  long                      used;         /* number of bytes of cached content */
+  unsigned long             generation;   /* incremented by each invalidation */
+  pthread_mutex_t           mutex;        /* protects all members */
+  int                       inotify_fd;   /* reports modifications below the root directory */
+  char*                     root_path;    /* root directory terminated by '/' */
+  FILECACHE_WATCH*          watch_tab;    /* watched directories */
+  int                       nr_watches;
+  pthread_t                 watcher;      /* processes inotify events */
+} FILECACHE;
+
+
+
+/* -- public prototypes ----------------------------------------------------------*/
+
+
+/*******************************************************************************
+ * FILECACHE_Init() 
+ *                                                                         */ /*!
+ * Initialize empty file cache and start watching the root directory 
+ * and its subdirectories for modifications.
+ *                                                                              
+ * Function parameters
+ *     - cache:       pointer to file cache
+ *     - root_dir:    root directory for static web content
+ *     - budget:      maximum number of bytes of cached content
+ *
+ * Returnparameter
+ *     - R: 0 in case of success, -1 when modifications cannot be watched
+ *
+ *******************************************************************************/
+int FILECACHE_Init( FILECACHE* cache, const char* root_dir, const long budget );
+
+
+/*******************************************************************************
+ * FILECACHE_Exit() 
+ *                                                                         */ /*!
+ * Stop watching and release all entries. No entry must be referenced anymore.
+ *                                                                              
+ * Function parameters
+ *     - cache:       pointer to file cache
+ *
+ *******************************************************************************/
+void FILECACHE_Exit( FILECACHE* cache );
+
+
+/*******************************************************************************
+ * FILECACHE_Lookup() 
+ *                                                                         */ /*!
+ * Retrieve cached file, the entry has to be given back by FILECACHE_Unref().
+ * Entries of files which are known to be missing have the member missing set.
+ *                                                                              
+ * Function parameters
+ *     - cache:       pointer to file cache
+ *     - path:        resolved file name
+ *     - generation:  returns state of the cache, to be passed to FILECACHE_Insert()
+ *                    after a miss
+ *
+ * Returnparameter
+ *     - R: referenced entry, NULL when the file is not cached
+ *
+ *******************************************************************************/
+FILECACHE_ENTRY* FILECACHE_Lookup( FILECACHE* cache, const char* path, unsigned long* generation );
+
+
+/*******************************************************************************
+ * FILECACHE_Insert() 
+ *                                                                         */ /*!
+ * Read opened file into the cache, the least recently used entries are 
+ * evicted if required. The file is not cached when it is too big, when its
+ * directory is not watched or when the cache has been invalidated since the 
+ * lookup.
+ *                                                                              
+ * Function parameters
+ *     - cache:       pointer to file cache
+ *     - path:        resolved file name
+ *     - fd:          opened file
+ *     - file_stat:   status of the opened file
+ *     - generation:  as returned by the preceding FILECACHE_Lookup()
+ *
+ * Returnparameter
+ *     - R: referenced entry, NULL when the file is not cached
+ *
+ *******************************************************************************/
+FILECACHE_ENTRY* FILECACHE_Insert( 
+  FILECACHE*          cache, 
+  const char*         path, 
+  const int           fd, 
+  const struct stat*  file_stat, 
+  const unsigned long generation 
+);
+
+
+/*******************************************************************************
+ * FILECACHE_InsertMissing() 
+ *                                                                         */ /*!
+ * Cache the name of a file which does not exist or is no regular file. The
+ * least recently used name is evicted when FILECACHE_MAX_MISSING names are
+ * cached already. The entry is invalidated by the creation of the file or 
+ * after FILECACHE_MISSING_TTL seconds.
+ *                                                                              
+ * Function parameters
+ *     - cache:       pointer to file cache
+ *     - path:        resolved file name
+ *     - generation:  as returned by the preceding FILECACHE_Lookup()
+ *
+ *******************************************************************************/
+void FILECACHE_InsertMissing( FILECACHE* cache, const char* path, const unsigned long generation );
+
+
+/*******************************************************************************
+ * FILECACHE_Unref() 
+ *                                                                         */ /*!
+ * Give back entry retrieved by FILECACHE_Lookup() or FILECACHE_Insert()
+ *                                                                              
+ * Function parameters
+ *     - cache:       pointer to file cache
+ *     - entry:       entry which is not used anymore
+ *
+ *******************************************************************************/
+void FILECACHE_Unref( FILECACHE* cache, FILECACHE_ENTRY* entry );
+
+
+#endif /* #ifndef _FILECACHE_H */
@@ -0,0 +1,235 @@
+/*
+ *  form.c
+ *  idefix
+ *
+ *  parser of application/x-www-form-urlencoded data, i.e. query strings
+ *  and form bodies. Keys and values are percent-decoded in place within
+ *  a single pass and indexed by the hash of their keys.
+ *
+ *  Copyright 2010 GNU General Public Licence. All rights reserved.
+ *
+ */
+
+/* -- includes -------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "form.h"
+#include "keyword.h"
+
+
+/* -- local functions -------------------------------------------------------------*/
+
+
+/*!
+ *  value of a hex digit, -1 for other characters
+ */
+static inline int _form_hex( int c )
+{
+  if( c >= '0' && c <= '9' )
+    return c - '0';
+
+  c |= 0x20;
+  if( c >= 'a' && c <= 'f' )
+    return c - 'a' + 10;
+
+  return -1;
+}
+
+
+/*!
+ *  decode characters from src to dst until the separator sep or '&' or the
+ *  end is reached, dst never overtakes src. Returns the position of the
+ *  separator, the number of decoded bytes and their hash are stored.
+ */
+static char* _form_decode( char* src, const char* end, const int sep, char* dst, int* len, unsigned int* hash )
+{
+  char* const   start = dst;
+  unsigned int  h = KEYWORD_HASH_INIT;
+  int           c, hi, lo;
+
+  while( src < end && *src != sep && *src != '&' )
+  {
+    c = (unsigned char) *src++;
+
+    if( c == '+' )
+      c = ' ';
+    else if( c == '%' && end - src >= 2 && ( hi = _form_hex( src[0] ) ) >= 0 && ( lo = _form_hex( src[1] ) ) >= 0 )
+    {
+      c = ( hi << 4 ) | lo;
+      src += 2;
+    }
+
+    *dst++ = c;
+    h = KEYWORD_HashStep( h, c );
+  }
+
+  *len  = dst - start;
+  *hash = h;
+  return src;
+}
+
+
+/*!
+ *  insert the last field of the table into the index, repeated keys are
+ *  chained to the first field of the key
+ */
+static void _form_index_field( FORM* form )
+{
+  const unsigned int  mask  = FORM_INDEX_SIZE - 1;
+  FORM_FIELD*         field = & form->field_tab[form->nr_fields - 1];
+  FORM_FIELD*         other;
+  unsigned int        slot;
+
+  for( slot = field->hash & mask; form->index[slot] != 0; slot = ( slot + 1 ) & mask )
+  {
+    other = & form->field_tab[form->index[slot] - 1];
+    if( other->hash == field->hash && other->key_len == field->key_len &&
+        memcmp( other->key, field->key, field->key_len ) == 0 )
+    {
+      while( other->next != 0 )
+        other = & form->field_tab[other->next - 1];
+      other->next = form->nr_fields;
+      return;
+    }
+  }
+
+  form->index[slot] = form->nr_fields;
+}
+
+
+
+/* -- public prototypes ----------------------------------------------------------*/
+
+
+/*******************************************************************************
+ * FORM_Parse()
+ *                                                                         */ /*!
+ * Decode urlencoded data in place and index its fields. '+' is decoded
+ * to space, malformed percent escapes are kept as they are. Fields with
+ * an empty key are skipped, a key without '=' has an empty value.
+ *
+ * Function parameters
+ *     - form:        fields are stored here
+ *     - buf:         data, buf[len] must be writable for the zero termination
+ *                    of the last value
+ *     - len:         number of bytes of data
+ *
+ * Returnparameter
+ *     - R: 0 in case of success, FORM_TOO_MANY_FIELDS when only the first
+ *          FORM_MAX_FIELDS fields are stored
+ *
+ *******************************************************************************/
+int FORM_Parse( FORM* form, char* buf, const long len )
+{
+  const char*   end = buf + len;
+  char*         src = buf;
+  char*         dst;
+  FORM_FIELD*   field;
+  unsigned int  hash;
+  int           sep;
+
+  form->nr_fields = 0;
+  memset( form->index, 0, sizeof( form->index ) );
+
+  while( src < end )
+  {
+    if( form->nr_fields >= FORM_MAX_FIELDS )
+      return FORM_TOO_MANY_FIELDS;
+
+    field = & form->field_tab[form->nr_fields];
+    field->key  = dst = src;
+    field->next = 0;
+
+    /* the separator is read before the termination may overwrite it */
+    src = _form_decode( src, end, '=', dst, & field->key_len, & field->hash );
+    sep = ( src < end ) ? *src++ : '&';
+    dst += field->key_len;
+    *dst++ = '\0';
+
+    field->value = dst;
+    if( sep == '=' )
+    {
+      src = _form_decode( src, end, '&', dst, & field->value_len, & hash );
+      if( src < end )
+        ++src;
+      dst[field->value_len] = '\0';
+    }
+    else
+    {
+      /* points to the termination of the key */
+      field->value     = dst - 1;
+      field->value_len = 0;
+    }
+
+    if( field->key_len > 0 )
+    {
+      ++form->nr_fields;
+      _form_index_field( form );
+    }
+  }
+
+  return 0;
+}
+
+
+/*******************************************************************************
+ * FORM_Find()
+ *                                                                         */ /*!
+ * Retrieve first field of a key, use FORM_NextOfKey() for repeated keys
+ *
+ * Function parameters
+ *     - form:        parsed form
+ *     - key:         decoded key, case-sensitive
+ *
+ * Returnparameter
+ *     - R: field, NULL when the form has no such key
+ *
+ *******************************************************************************/
+const FORM_FIELD* FORM_Find( const FORM* form, const char* key )
+{
+  const FORM_FIELD*   field;
+  const unsigned int  mask    = FORM_INDEX_SIZE - 1;
+  const int           key_len = strlen( key );
+  const unsigned int  hash    = KEYWORD_Hash( key, key_len );
+  unsigned int        slot;
+
+  /* the index has empty slots left, hence the probing terminates */
+  for( slot = hash & mask; form->index[slot] != 0; slot = ( slot + 1 ) & mask )
+  {
+    field = & form->field_tab[form->index[slot] - 1];
+    if( field->hash == hash && field->key_len == key_len && memcmp( field->key, key, key_len ) == 0 )
+      return field;
+  }
+
+  return NULL;
+}
+
+
+/*******************************************************************************
+ * FORM_Get()
+ *                                                                         */ /*!
+ * Retrieve value of the first field of a key
+ *
+ * Function parameters
+ *     - form:        parsed form
+ *     - key:         decoded key, case-sensitive
+ *     - len:         length of the value is stored here, may be NULL
+ *
+ * Returnparameter
+ *     - R: decoded and zero terminated value, NULL when the form has no
+ *          such key
+ *
+ *******************************************************************************/
+const char* FORM_Get( const FORM* form, const char* key, int* len )
+{
+  const FORM_FIELD* field = FORM_Find( form, key );
+
+  if( field == NULL )
+    return NULL;
+
+  if( len != NULL )
+    *len = field->value_len;
+
+  return field->value;
+}
@@ -0,0 +1,155 @@
+/*
+ *  form.h
+ *  idefix
+ *
+ *  parser of application/x-www-form-urlencoded data, i.e. query strings
+ *  and form bodies. Keys and values are percent-decoded in place within
+ *  a single pass and indexed by the hash of their keys.
+ *
+ *  Copyright 2010 GNU General Public Licence. All rights reserved.
+ *
+ */
+
+#ifndef _FORM_H
+#define _FORM_H
+
+
+/* -- const definitions -----------------------------------------------------------*/
+
+
+/*!
+ *  Maximum number of fields of a form, further fields are ignored
+ */
+#define FORM_MAX_FIELDS             32
+
+
+/*!
+ *  Number of slots of the key index, power of two and
+ *  twice the number of fields at least
+ */
+#define FORM_INDEX_SIZE             64
+
+
+/*!
+ *  Error codes of FORM_Parse()
+ */
+#define FORM_TOO_MANY_FIELDS        ( -1 )
+
+
+
+/* -- public types    -----------------------------------------------------------*/
+
+
+/*!
+ *  Decoded field, key and value point into the parsed buffer
+ *  and are zero terminated
+ */
+typedef struct
+{
+  const char*       key;
+  const char*       value;
+  int               key_len;
+  int               value_len;
+  unsigned int      hash;             /* hash of the key */
+  unsigned char     next;             /* next field with the same key plus one, 0 if none */
+} FORM_FIELD;
+
+
+/*!
+ *  Fields of a form in the order of the data. The index maps the hash
+ *  of a key to its first field plus one, 0 denotes an empty slot.
+ *  Collisions are resolved by linear probing.
+ */
+typedef struct
+{
+  FORM_FIELD        field_tab[FORM_MAX_FIELDS];
+  int               nr_fields;
+  unsigned char     index[FORM_INDEX_SIZE];
+} FORM;
+
+
+
+/* -- inline functions -----------------------------------------------------------*/
+
+
+/*!
+ *  iterate over all fields, returns the first field for field == NULL and
+ *  NULL behind the last one
+ */
+static inline const FORM_FIELD* FORM_Next( const FORM* form, const FORM_FIELD* field )
+{
+  field = ( field == NULL ) ? form->field_tab : field + 1;
+
+  return ( field < form->field_tab + form->nr_fields ) ? field : NULL;
+}
+
+
+/*!
+ *  next field with the same key as field, NULL if none
+ */
+static inline const FORM_FIELD* FORM_NextOfKey( const FORM* form, const FORM_FIELD* field )
+{
+  return field->next ? & form->field_tab[field->next - 1] : NULL;
+}
+
+
+
+/* -- public prototypes ----------------------------------------------------------*/
+
+
+/*******************************************************************************
+ * FORM_Parse()
+ *                                                                         */ /*!
+ * Decode urlencoded data in place and index its fields. '+' is decoded
+ * to space, malformed percent escapes are kept as they are. Fields with
+ * an empty key are skipped, a key without '=' has an empty value.
+ *
+ * Function parameters
+ *     - form:        fields are stored here
+ *     - buf:         data, buf[len] must be writable for the zero termination
+ *                    of the last value
+ *     - len:         number of bytes of data
+ *
+ * Returnparameter
+ *     - R: 0 in case of success, FORM_TOO_MANY_FIELDS when only the first
+ *          FORM_MAX_FIELDS fields are stored
+ *
+ *******************************************************************************/
+int FORM_Parse( FORM* form, char* buf, const long len );
+
+
+/*******************************************************************************
+ * FORM_Find()
+ *                                                                         */ /*!
+ * Retrieve first field of a key, use FORM_NextOfKey() for repeated keys
+ *
+ * Function parameters
+ *     - form:        parsed form
+ *     - key:         decoded key, case-sensitive
+ *
+ * Returnparameter
+ *     - R: field, NULL when the form has no such key
+ *
+ *******************************************************************************/
+const FORM_FIELD* FORM_Find( const FORM* form, const char* key );
+
+
+/*******************************************************************************
+ * FORM_Get()
+ *                                                                         */ /*!
+ * Retrieve value of the first field of a key
+ *
+ * Function parameters
+ *     - form:        parsed form
+ *     - key:         decoded key, case-sensitive
+ *     - len:         length of the value is stored here, may be NULL
+ *
+ * Returnparameter
+ *     - R: decoded and zero terminated value, NULL when the form has no
+ *          such key
+ *
+ *******************************************************************************/
+const char* FORM_Get( const FORM* form, const char* key, int* len );
+
+
+#endif /* #ifndef _FORM_H */
@@ -9,14 +9,27 @@
 
 /* -- includes -------------------------------------------------------------------*/
 
+#define _GNU_SOURCE     /* for strcasestr, strptime and timegm */
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
 #include <sys/stat.h>   /* for checking correct file status */
+#ifdef HTTP_USE_ZLIB
+#include <zlib.h>
+#endif
 #include "http.h"
 #include "socket_io.h"
+#include "scan.h"
+#include "keyword.h"
+#ifdef HTTP_USE_ROMFS
+#include "romfs.h"
+#endif
 
 
 
@@ -41,12 +54,6 @@
 #define HTML_MAX_PATH_LEN     256
 
 
-/*!
- *  Chunksize used for HTML file operations
- */
-#define HTML_CHUNK_SIZE       512
-
-
 /*!
  *  Maximum length of server acknowledge block
  */
@@ -60,20 +67,20 @@
 #define HTML_MAX_STATLINE     80
 
 
+/*!
+ *  Maximum number of compressed bytes transmitted in one chunk
+ */
+#define HTTP_DEFLATE_CHUNK_LEN  2048
 
-/*
- *  HTTP methods
- */
-#define HTTP_GET              "GET"
-#define HTTP_POST             "POST"
-#define HTTP_HEAD             "HEAD"
-#define HTTP_PUT              "PUT"
-#define HTTP_DELETE           "DELETE"
-#define HTTP_TRACE            "TRACE"
-#define HTTP_OPTIONS          "OPTIONS"
-#define HTTP_CONNECT          "CONNECT"
-
-/*  maximum length of HTTP command above */
+
+/*!
+ *  Format of HTTP dates ( IMF-fixdate, RFC 7231 )
+ */
+#define HTTP_DATE_FORMAT        "%a, %d %b %Y %H:%M:%S GMT"
+
+
+
+/*  maximum length of HTTP command ( see keywords.def ) */
 #define MAX_HTTP_COMMAND_LEN  10
 
 
@@ -90,6 +97,21 @@ typedef struct
 } HTTP_HASH_TYPE;
 
 
+/*!
+ *  Static content file, compiled-in, cached or opened
+ */
+typedef struct
+{
+  const char*       data;     /* content in memory, NULL when it is read from fd */
+  FILECACHE_ENTRY*  entry;    /* referenced cache entry holding data, NULL if none */
+  PACK*             pack;     /* referenced content pack holding data, NULL if none */
+  int               fd;       /* opened file, -1 if none */
+  long              size;     /* file length in bytes */
+  time_t            mtime;    /* time of last modification */
+  char              etag[HTTP_MAX_ETAG_LEN]; /* strong entity tag of the file */
+} HTTP_STATIC_FILE;
+
+
 /*!
  *  Server error text messages
  */
@@ -106,13 +128,19 @@ static const HTTP_HASH_TYPE _httpErrorTab[] =
   { HTTP_WRONG_METHOD, "http method does not exist" },
   { HTTP_CGI_HANLDER_NOT_FOUND, "wrong CGI handler invoked (IMPLEMENTATION BUG)" },
   { HTTP_CGI_EXEC_ERROR, "error occured within cgi execution" },
-  { HTTP_TOO_MANY_CGI_HANDLERS, "to many cgi handlers registered" },
+  { HTTP_TOO_MANY_CGI_HANDLERS, "no memory left for further cgi handlers" },
   { HTTP_FILE_NOT_FOUND, "static content file like html, jpeg not found" },
   { HTTP_NOT_IMPLEMENTED_YET, "http method of other feature not implmented yet" },
   { HTTP_HEADER_ERROR, "could not read http header or header is corrupted" },
   { HTTP_POST_DATA_TOO_BIG, "too many bytes in http post body" },
   { HTTP_POST_IO_ERROR, "could not read http post data " },
-  { HTTP_FILE_IO_ERROR, "error while accessing local file system" }
+  { HTTP_FILE_IO_ERROR, "error while accessing local file system" },
+  { HTTP_TOO_MANY_CACHE_RULES, "too many cache rules registered" },
+  { HTTP_CACHE_RULE_ERROR, "malformed cache rule" },
+  { HTTP_CGI_ROUTE_ERROR, "malformed path parameter of cgi handler" },
+  { HTTP_UPLOAD_ERROR, "malformed multipart body or part handler failed" },
+  { HTTP_PENDING, "operation pending, socket not ready" },
+  { HTTP_CONNECTION_CLOSED, "connection closed by peer" }
 };
 
 const int _httpErrorTabSize = sizeof( _httpErrorTab ) / sizeof( HTTP_HASH_TYPE );
@@ -126,62 +154,53 @@ static const HTTP_HASH_TYPE HttpAckTable[] =
   { 200, "OK" },
   { 404, "Not Found" },
   { 500, "Internal Server Error" },
+  { 304, "Not Modified" },
 };
 
 
 /*
- *  Hash for mime type key/string pair
+ *  Hash for mime type key/string pair, indexed by mime type
  */
 static const HTTP_HASH_TYPE HttpMimeTypeTable[] =
 {
-  { HTTP_MIME_UNDEFINED, "application/octet-stream" },
-  { HTTP_MIME_TEXT_HTML, "text/html" },
-  { HTTP_MIME_TEXT_CSS, "text/css" },
-  { HTTP_MIME_TEXT_PLAIN, "text/plain" },
-  { HTTP_MIME_IMAGE_JPEG, "image/jpeg" },
-  { HTTP_MIME_IMAGE_PNG, "image/png" },
-  { HTTP_MIME_IMAGE_GIF, "image/gif" },
-  { HTTP_MIME_IMAGE_TIFF, "image/tiff" },
-  { HTTP_MIME_IMAGE_ICON, "image/x-icon" },
-  { HTTP_MIME_APPLICATION_JAVASCRIPT, "application/javascript" },
-  { HTTP_MIME_APPLICATION_JSON, "application/json" },
-  { HTTP_MIME_APPLICATION_XML, "application/xml" },
-  { HTTP_MIME_APPLICATION_INDEX, "applicaiton/index" },
-  { HTTP_MIME_AUDIO_MP4, "audio/mp4" },
-  { HTTP_MIME_AUDIO_MPEG, "audio/mpeg" },
-  { HTTP_MIME_AUDIO_SPEEX, "audio/speex" },
-  { HTTP_MIME_MULTIPART_FORM_DATA, "multipart/form-data" },
-  { HTTP_MIME_MULTIPART_ALTERNATIVE, "mutipart/alternative" }
+#define KEYWORD_MEDIA_TYPE( key, id )   [id] = { id, key },
+#include "keywords.def"
+};
+
+
+/*
+ *  Hash for content codings
+ */
+static const HTTP_HASH_TYPE HttpContentEncodingTable[] =
+{
+  { HTTP_ENCODING_IDENTITY, "identity" },
+  { HTTP_ENCODING_GZIP, "gzip" },
+  { HTTP_ENCODING_BR, "br" },
+  { HTTP_ENCODING_DEFLATE, "deflate" }
 };
 
-static const int HttpMimeTypeTableSize = sizeof(HttpMimeTypeTable) / sizeof(HTTP_HASH_TYPE);
+static const int HttpContentEncodingTableSize = sizeof(HttpContentEncodingTable) / sizeof(HTTP_HASH_TYPE);
 
 
 /*
- *  Hash for mapping file extentions to mime types
- */
-static const HTTP_HASH_TYPE HttpFileExtMimeTable[] =
-{
-  { HTTP_MIME_UNDEFINED, "undefined" },
-  { HTTP_MIME_TEXT_HTML, "html" },
-  { HTTP_MIME_TEXT_CSS, "css" },
-  { HTTP_MIME_TEXT_PLAIN, "txt" },
-  { HTTP_MIME_IMAGE_JPEG, "jpg" },
-  { HTTP_MIME_IMAGE_JPEG, "jpeg" },
-  { HTTP_MIME_IMAGE_PNG, "png" },
-  { HTTP_MIME_IMAGE_GIF, "gif" },
-  { HTTP_MIME_IMAGE_TIFF, "tiff" },
-  { HTTP_MIME_IMAGE_ICON, "ico" },
-  { HTTP_MIME_APPLICATION_JAVASCRIPT, "js" },
-  { HTTP_MIME_APPLICATION_JSON, "json" },
-  { HTTP_MIME_APPLICATION_XML, "xml" },
-  { HTTP_MIME_AUDIO_MP4, "mp4" },
-  { HTTP_MIME_AUDIO_MPEG, "mpeg" },
-  { HTTP_MIME_AUDIO_MPEG, "mpg" },  
-  { HTTP_MIME_AUDIO_SPEEX, "speex" }
+ *  File name extensions of precompressed static content in order of preference
+ */
+static const HTTP_HASH_TYPE HttpPrecompressedExtTable[] =
+{
+  { HTTP_ENCODING_BR, ".br" },
+  { HTTP_ENCODING_GZIP, ".gz" }
 };
 
-static const int HttpFileExtMimeTableSize = sizeof(HttpFileExtMimeTable) / sizeof(HTTP_HASH_TYPE);
+static const int HttpPrecompressedExtTableSize = sizeof(HttpPrecompressedExtTable) / sizeof(HTTP_HASH_TYPE);
+
+
+/*
+ *  Pre-serialized responses for static content which does not exist
+ */
+#define HTTP_NOT_FOUND_HEADER   "HTTP/1.1 404 Not Found\r\nServer: " HTML_SERVER_NAME "\r\nContent-Length: 0\r\n"
+
+static const char HttpNotFoundKeepAlive[] = HTTP_NOT_FOUND_HEADER "Connection: Keep-Alive\r\n\r\n";
+static const char HttpNotFoundClose[]     = HTTP_NOT_FOUND_HEADER "Connection: close\r\n\r\n";
 
 
 
@@ -233,22 +252,15 @@ static void _http_trim( char *string, const int max_len )
 
 
 /*
- *  Helper function for determine the mime type in a given string
+ *  Helper function for determine the mime type in a given string,
+ *  parameters like "; charset=utf-8" are ignored
  */
 static HTTP_MIME_TYPE   _http_get_mime_type_from_string( const char *string )
 {
-  int i, index = HTTP_MIME_UNDEFINED;
+  const int len = strcspn( string, "; \t" );
+  int       id  = KEYWORD_Lookup( & KEYWORD_MediaTypes, string, len, KEYWORD_Hash( string, len ) );
   
-  for( i=1; i < HttpMimeTypeTableSize; ++i )
-  {
-    if( strcasestr( string, HttpMimeTypeTable[i].txt ) != NULL )
-    {
-      index = i;
-      break;
-    }
-  }
-  
-  return HttpMimeTypeTable[index].id;
+  return ( id >= 0 ) ? id : HTTP_MIME_UNDEFINED;
 }
 
 
@@ -257,31 +269,118 @@ static HTTP_MIME_TYPE   _http_get_mime_type_from_string( const char *string )
  */
 static HTTP_MIME_TYPE   _http_get_mime_type_from_filename( const char *filename )
 {
-  int len, i, j, index = HTTP_MIME_UNDEFINED;
-  
-  /* determine position of file extension in filename (last dot) */
-  len=strlen( filename );
-  for( i=len-1; i>=0; i-- )
-  {
-    if( filename[i] == '.' )
-      break;
-  }
+  const char* ext = strrchr( filename, '.' );
+  int         len, id;
   
-  if( i==0 || i==(len-1) ) /* nothing found */
+  /* file extension follows the last dot */
+  if( ext == NULL || ext == filename ) /* nothing found */
     return HTTP_MIME_UNDEFINED;
   
-  ++i;
+  ++ext;
+  len = strlen( ext );
+  id  = KEYWORD_Lookup( & KEYWORD_FileExts, ext, len, KEYWORD_Hash( ext, len ) );
   
-  for( j=0; j < HttpFileExtMimeTableSize; ++j )
+  return ( id >= 0 ) ? id : HTTP_MIME_UNDEFINED;  
+}
+
+
+/*
+ *  Helper function for determining the content codings accepted by the 
+ *  client from the value of its Accept-Encoding header. Codings with a 
+ *  quality value of 0 are refused, '*' stands for all codings.
+ */
+static int _http_get_accept_encoding( const char* value )
+{
+  const char* p = value;
+  const char* next;
+  const char* param;
+  int         accepted = 0, refused = 0, mask, len, i;
+
+  while( *p != '\0' )
   {
-    if( strcasestr( & filename[i], HttpFileExtMimeTable[j].txt ) != NULL )
-    {
-      index = j;
+    p   += strspn( p, " ," );
+    len  = strcspn( p, " ,;" );
+    next = p + strcspn( p, "," );
+    if( len == 0 )
       break;
+
+    /* determine coding */
+    if( len == 1 && *p == '*' )
+      mask = ~0;
+    else
+    {
+      mask = 0;
+      for( i = 0; i < HttpContentEncodingTableSize; ++i )
+      {
+        if( (int) strlen( HttpContentEncodingTable[i].txt ) == len && strncasecmp( p, HttpContentEncodingTable[i].txt, len ) == 0 )
+          mask = HTTP_ENCODING_MASK( HttpContentEncodingTable[i].id );
+      }
+    }
+
+    /* check for quality value 0 */
+    param = memchr( p, ';', next - p );
+    if( param != NULL )
+    {
+      param += 1 + strspn( param + 1, " " );
+      if( strncasecmp( param, "q=", 2 ) == 0 && strtod( param + 2, NULL ) == 0.0 )
+        refused |= mask;
+      else
+        accepted |= mask;
     }
+    else
+      accepted |= mask;
+
+    p = next;
   }
-  
-  return HttpFileExtMimeTable[index].id;  
+
+  return accepted & ~refused;
+}
+
+
+/*
+ *  Helper function for checking whether an entity tag is contained in the
+ *  list of an If-None-Match header. Weak comparison is used, i.e. the weak
+ *  indicator is ignored. '*' matches any entity tag.
+ */
+static int _http_etag_matches( const char* list, const char* etag )
+{
+  const char* opaque = ( strncmp( etag, "W/", 2 ) == 0 ) ? etag + 2 : etag;
+  const int   len = strlen( opaque );
+  const char* p = list;
+
+  while( *p != '\0' )
+  {
+    p += strspn( p, " ," );
+    if( *p == '*' )
+      return true;
+
+    if( strncmp( p, "W/", 2 ) == 0 )
+      p += 2;
+    if( strncmp( p, opaque, len ) == 0 && ( p[len] == '\0' || p[len] == ',' || p[len] == ' ' ) )
+      return true;
+
+    p += strcspn( p, "," );
+  }
+
+  return false;
+}
+
+
+/*
+ *  Helper function for converting an HTTP date to calendar time,
+ *  returns 0 when the date cannot be parsed
+ */
+static time_t _http_parse_date( const char* date )
+{
+  struct tm   tm;
+  const char* end;
+
+  memset( & tm, 0, sizeof( tm ) );
+  end = strptime( date, HTTP_DATE_FORMAT, & tm );
+  if( end == NULL )
+    return 0;
+
+  return timegm( & tm );
 }
 
 
@@ -290,6 +389,7 @@ static HTTP_MIME_TYPE   _http_get_mime_type_from_filename( const char *filename
  */
 static int _http_get_url_from_request( char url[HTML_MAX_URL_SIZE], char *pbuf )
 {
+  const char* eou;
   int   c;
   int   beg = 0, end;
   int   i, j;
@@ -307,14 +407,11 @@ static int _http_get_url_from_request( char url[HTML_MAX_URL_SIZE], char *pbuf )
   
   
   /* find the position of the last blank separating the URL form the http protocol specifier */
-  end = beg + HTML_MAX_URL_SIZE - 1;
-  for( i=beg; i < end  &&  pbuf[i] != ' '; ++i )
-    ;
-  
-  if( i==end )
+  eou = memchr( & pbuf[beg], ' ', HTML_MAX_URL_SIZE - 1 );
+  if( eou == NULL )
     return HTTP_MALFORMED_URL;
   else 
-    end = i;
+    end = eou - pbuf;
   
   
   /* strip out the following leading characters '.', '/', digits, '\', '*', ':', ';' */
@@ -363,14 +460,21 @@ static int _http_search_path_index_from_url( char url[HTML_MAX_URL_SIZE] )
 
 
 /*!
- *  generate acknowledge info block
+ *  generate acknowledge info block, it is appended to the transmit buffer
+ *  and terminated by the empty line which separates it from the content
  */
-static int _http_ack( int socket, const HTTP_ACK_KEY ack_key, const char* mime_type, const long content_len, const char* add_ons )
+static int _http_ack( HTTP_OBJ* this, const HTTP_ACK_KEY ack_key, const char* mime_type, const long content_len, const char* add_ons )
 {
   char    linebuf[HTML_MAX_STATLINE];
-  char    ackbuf[HTML_MAX_ACK_BLOCK];
+  struct tm tm;
+  time_t  expires;
+  char*   ackbuf = this->sndbuf + this->snd_len;
+  int     max_len = HTTP_SND_BUF_LEN - this->snd_len;
   int     i = 0, len, error = HTTP_OK;
   
+  if( max_len > HTML_MAX_ACK_BLOCK )
+    max_len = HTML_MAX_ACK_BLOCK;
+
   ackbuf[0] = '\0';
   
   switch( ack_key )
@@ -379,7 +483,7 @@ static int _http_ack( int socket, const HTTP_ACK_KEY ack_key, const char* mime_t
       /* Status line */
       snprintf( linebuf, HTML_MAX_STATLINE, "HTTP/1.1 %3d %s\r\n", HttpAckTable[ack_key].id, HttpAckTable[ack_key].txt );
       len = strlen( linebuf );
-      if( i+len >= HTML_MAX_ACK_BLOCK )
+      if( i+len >= max_len )
       {
         error = HTTP_BUFFER_OVERRUN;
         break;
@@ -390,7 +494,7 @@ static int _http_ack( int socket, const HTTP_ACK_KEY ack_key, const char* mime_t
       /* Server indication */
       snprintf(  linebuf, HTML_MAX_STATLINE, "Server: %s\r\n", HTML_SERVER_NAME );
       len = strlen( linebuf );
-      if( i+len >= HTML_MAX_ACK_BLOCK )
+      if( i+len >= max_len )
       {
         error = HTTP_BUFFER_OVERRUN;
         break;
@@ -399,12 +503,26 @@ static int _http_ack( int socket, const HTTP_ACK_KEY ack_key, const char* mime_t
       i += len;
       
       
-      /* Content length */
-      if( content_len >  0 )
+      /* Content length, required for persistent connections even if zero */
+      if( content_len >= 0 )
       {
         snprintf(  linebuf, HTML_MAX_STATLINE, "Content-Length: %ld\r\n", content_len );
         len = strlen( linebuf );
-        if( i+len >= HTML_MAX_ACK_BLOCK )
+        if( i+len >= max_len )
+        {
+          error = HTTP_BUFFER_OVERRUN;
+          break;
+        }
+        strcat( & ackbuf[i], linebuf );
+        i += len;
+      }
+      
+      /* Content of unknown length is transmitted in chunks */
+      if( this->snd_chunked )
+      {
+        snprintf(  linebuf, HTML_MAX_STATLINE, "Transfer-Encoding: chunked\r\n" );
+        len = strlen( linebuf );
+        if( i+len >= max_len )
         {
           error = HTTP_BUFFER_OVERRUN;
           break;
@@ -418,7 +536,91 @@ static int _http_ack( int socket, const HTTP_ACK_KEY ack_key, const char* mime_t
       {
         snprintf(  linebuf, HTML_MAX_STATLINE, "Content-Type: %s\r\n", mime_type );
         len = strlen( linebuf );
-        if( i+len >= HTML_MAX_ACK_BLOCK )
+        if( i+len >= max_len )
+        {
+          error = HTTP_BUFFER_OVERRUN;
+          break;
+        }
+        strcat( & ackbuf[i], linebuf );
+        i += len;
+      }
+      
+      /* Content coding */
+      if( this->content_encoding != HTTP_ENCODING_IDENTITY )
+      {
+        snprintf(  linebuf, HTML_MAX_STATLINE, "Content-Encoding: %s\r\n", HttpContentEncodingTable[this->content_encoding].txt );
+        len = strlen( linebuf );
+        if( i+len >= max_len )
+        {
+          error = HTTP_BUFFER_OVERRUN;
+          break;
+        }
+        strcat( & ackbuf[i], linebuf );
+        i += len;
+      }
+
+      /* Caches have to distinguish encoded and plain representations */
+      if( this->vary_encoding )
+      {
+        snprintf(  linebuf, HTML_MAX_STATLINE, "Vary: Accept-Encoding\r\n" );
+        len = strlen( linebuf );
+        if( i+len >= max_len )
+        {
+          error = HTTP_BUFFER_OVERRUN;
+          break;
+        }
+        strcat( & ackbuf[i], linebuf );
+        i += len;
+      }
+      
+      /* Validators for conditional requests */
+      if( this->etag[0] != '\0' )
+      {
+        snprintf(  linebuf, HTML_MAX_STATLINE, "ETag: %s\r\n", this->etag );
+        len = strlen( linebuf );
+        if( i+len >= max_len )
+        {
+          error = HTTP_BUFFER_OVERRUN;
+          break;
+        }
+        strcat( & ackbuf[i], linebuf );
+        i += len;
+      }
+
+      if( this->last_modified != 0 )
+      {
+        strcpy( linebuf, "Last-Modified: " );
+        len = strlen( linebuf );
+        len += strftime( linebuf + len, HTML_MAX_STATLINE - len, HTTP_DATE_FORMAT "\r\n", gmtime_r( & this->last_modified, & tm ) );
+        if( i+len >= max_len )
+        {
+          error = HTTP_BUFFER_OVERRUN;
+          break;
+        }
+        strcat( & ackbuf[i], linebuf );
+        i += len;
+      }
+      
+      /* Caching policy */
+      if( this->cache_rule != NULL )
+      {
+        snprintf(  linebuf, HTML_MAX_STATLINE, "Cache-Control: max-age=%ld%s\r\n", 
+          this->cache_rule->max_age, this->cache_rule->immutable ? ", immutable" : "" );
+        len = strlen( linebuf );
+        if( i+len >= max_len )
+        {
+          error = HTTP_BUFFER_OVERRUN;
+          break;
+        }
+        strcat( & ackbuf[i], linebuf );
+        i += len;
+
+        /* for HTTP/1.0 caches */
+        expires = time( NULL ) + this->cache_rule->max_age;
+        strcpy( linebuf, "Expires: " );
+        len = strlen( linebuf );
+        len += strftime( linebuf + len, HTML_MAX_STATLINE - len, HTTP_DATE_FORMAT "\r\n", gmtime_r( & expires, & tm ) );
+        if( i+len >= max_len )
         {
           error = HTTP_BUFFER_OVERRUN;
           break;
@@ -432,7 +634,7 @@ static int _http_ack( int socket, const HTTP_ACK_KEY ack_key, const char* mime_t
       {
         snprintf(  linebuf, HTML_MAX_STATLINE, "%s\r\n", add_ons );
         len = strlen( linebuf );
-        if( i+len >= HTML_MAX_ACK_BLOCK )
+        if( i+len >= max_len )
         {
           error = HTTP_BUFFER_OVERRUN;
           break;
@@ -445,24 +647,32 @@ static int _http_ack( int socket, const HTTP_ACK_KEY ack_key, const char* mime_t
       while( ( ackbuf[i-1] == '\r' || ackbuf[i-1] == '\n' ) && i > 1 )
         --i;
       ackbuf[i] = '\0';
+
+      printf( "-------- HTTP ANSWER HEADER ------->\n");
+      fwrite( ackbuf, 1, i, stdout );
+      printf( "\n<------- HTTP ANSWER HEADER --------\n");
+
+      /* terminate last line and append empty line */
+      if( i+4 >= max_len )
+      {
+        error = HTTP_BUFFER_OVERRUN;
+        break;
+      }
+      strcpy( & ackbuf[i], "\r\n\r\n" );
+      i += 4;
       break;
   }
   
   if( error )
   {
-    snprintf( linebuf, HTML_MAX_STATLINE, "HTTP/1.1 %3d %s\r\n", HttpAckTable[HTTP_ACK_INTERNAL_ERROR].id, HttpAckTable[HTTP_ACK_INTERNAL_ERROR].txt );
-    len = strlen( linebuf );
-    HTTP_SOCKET_SEND( socket, linebuf, len );
-  }
-  else 
-  {
-    if( HTTP_SOCKET_SEND( socket, ackbuf, i ) != i )
-      error = HTTP_SEND_ERROR;
+    if( max_len < HTML_MAX_STATLINE )
+      return error;
     
-    printf( "-------- HTTP ANSWER HEADER ------->\n");
-    fwrite( ackbuf, 1, i, stdout );
-    printf( "\n<------- HTTP ANSWER HEADER --------\n");
+    snprintf( ackbuf, HTML_MAX_STATLINE, "HTTP/1.1 %3d %s\r\n\r\n", HttpAckTable[HTTP_ACK_INTERNAL_ERROR].id, HttpAckTable[HTTP_ACK_INTERNAL_ERROR].txt );
+    i = strlen( ackbuf );
   }
+
+  this->snd_len += i;
   
   return error;
 }
@@ -471,787 +681,2638 @@ static int _http_ack( int socket, const HTTP_ACK_KEY ack_key, const char* mime_t
 /*
  *  find CGI handler and returns handler ID if match was found, otherwise -1
  */
-static int _find_cgi_handler( HTTP_OBJ* this )
+static const ROUTER_ROUTE* _find_cgi_handler( HTTP_OBJ* this )
 {
-  HTTP_CGI_HASH*    cgi_handler_tab     = this->cgi_handler_tab;
-  const int         cgi_handler_tab_top = this->cgi_handler_tab_top;
-  char*             handler_url_path;
-  char*             url_path = this->url_path;
-  int               i, j, found, handler_id = -1;
-    
-  for( i=0; i < cgi_handler_tab_top; ++i )
-  {
-    handler_url_path = cgi_handler_tab[i].url_path;
-    for( j=0, found = 1; handler_url_path[j]!='\0'  &&  j < HTML_MAX_URL_SIZE; ++j )
-    {
-      if( url_path[j] != handler_url_path[j] )
-      {
-        found = 0;
-        break;
-      }
-    }
-    
-    if( found && ( this->method_id & cgi_handler_tab[i].method_id_mask ) )
-    {
-      handler_id = cgi_handler_tab[i].handler_id;
-      break;
-    }
-  }
-  
-  return handler_id;
+  return ROUTER_Lookup( & this->cgi_handler_obj->cgi_router, this->url_path, this->method_id, this->cgi_param_tab );
 }
 
 
-/*
- *  Invokes CGI handler of given ID and returns handlers error code
+/*!
+ *  map return code of socket adapter functions to servers error codes
  */
-static int _call_cgi_handler( HTTP_OBJ* this, int handler_id )
+static int _http_map_io_error( const long n, const int default_error )
 {
-  HTTP_CGI_HASH*    cgi_handler_tab     = this->cgi_handler_tab;
-  const int         cgi_handler_tab_top = this->cgi_handler_tab_top;
-  int               i, error;
-    
-  for( i=0; i < cgi_handler_tab_top; ++i )
-  {
-    if( handler_id == cgi_handler_tab[i].handler_id )
-      break;    
-  }
-  
-  if( i != cgi_handler_tab_top )
-  {
-    error = (*cgi_handler_tab[i].handler)( this );
-  }
+  if( n == 0 )
+    return HTTP_CONNECTION_CLOSED;
+  else if( n == HTTP_IO_AGAIN )
+    return HTTP_PENDING;
+  else if( n == HTTP_IO_TIMEOUT )
+    return HTTP_RECV_TIMEOUT;
   else 
-  {
-    /* handler id does not exist */
-    error = HTTP_CGI_HANLDER_NOT_FOUND;
-  }
-
-  return error;
+    return default_error;
 }
 
 
 /*!
- *  receice http header from socket connection
+ *  bitmap of characters allowed in tokens, all visible ASCII characters
+ *  except the separators ()<>@,;:\"/[]?={}
  */
-static int _http_receive_header( HTTP_OBJ* this )
+static const unsigned int _http_token_char_map[8] = 
 {
-  int   eoh_found = false, error;
-  char  byte;
-  int   c = 0;
+  0x00000000, 0x03ff6cfa, 0xc7fffffe, 0x57ffffff, 0x00000000, 0x00000000, 0x00000000, 0x00000000
+};
 
-  while( c < MAX_HTML_BUF_LEN  &&  ( error = HTTP_SOCKET_RECV( this->socket, &byte, 1 ) ) == 1 )
-  {
-    this->rcvbuf[c++] = byte;
-    
-    if( c > 4 && memcmp( & this->rcvbuf[c-4], "\r\n\r\n", 4 ) == 0)
-    {
-      /* end of header */
-      this->rcvbuf[c-4] = '\0';
-      eoh_found = true;
-      break;
-    }
-  }
-  
-  this->header_len = c-4;
-  this->body_ptr = & this->rcvbuf[ this->header_len + 1 ];
-  
-  if( error == -2 ) 
-    return HTTP_RECV_TIMEOUT;
-  else if ( error < 0 )
-    return error;
-  else if( eoh_found )
-    return HTTP_OK;
-  else 
-    return HTTP_HEADER_ERROR;
+
+/*!
+ *  true for characters allowed in tokens ( method, header field names )
+ */
+static inline int _http_is_token_char( const int c )
+{
+  return ( _http_token_char_map[(c >> 5) & 7] >> ( c & 31 ) ) & 1;
 }
 
 
 /*!
- *  receice http body block from socket connection ( post )
+ *  header field whose value ends at the last line termination is complete,
+ *  trim its value, terminate it in place and add the field to the table
  */
-static int _http_receive_body( HTTP_OBJ* this )
+static int _http_add_header_field( HTTP_OBJ* this )
 {
-  /* check for enough memory space before reading  */
-  if( this->body_len > MAX_HTML_BUF_LEN - this->header_len + 1)
-    HTTP_POST_DATA_TOO_BIG;
+  HTTP_PARSER*        parser = & this->parser;
+  HTTP_HEADER_TABLE*  tab    = & this->header_tab;
+  HTTP_HEADER_FIELD*  field;
+  HTTP_HEADER_FIELD*  other;
+  const unsigned int  mask   = HTTP_HEADER_INDEX_SIZE - 1;
+  const int           colon  = parser->value_pos - 1;
+  int                 start  = parser->value_pos;
+  int                 end    = parser->eol;
+  unsigned int        slot;
+  int                 id;
+
+  parser->value_pos = -1;
+  if( tab->nr_fields >= HTTP_MAX_HEADER_FIELDS )
+    return HTTP_HEADER_ERROR;
 
-  /* ensure EOL termination of body string */
-  this->body_ptr[this->body_len] = '\0';
-    
-  if( HTTP_SOCKET_RECV( this->socket, this->body_ptr, this->body_len ) != this->body_len )
-    return HTTP_POST_IO_ERROR;
-  else 
-    return HTTP_OK;
-}
+  while( start < end && ( this->rcvbuf[start] == ' ' || this->rcvbuf[start] == '\t' ) )
+    ++start;
+  while( end > start && ( this->rcvbuf[end-1] == ' ' || this->rcvbuf[end-1] == '\t' ) )
+    --end;
+  this->rcvbuf[end] = '\0';
+
+  field = & tab->field_tab[tab->nr_fields];
+  field->name_off  = parser->name_pos;
+  field->name_len  = colon - parser->name_pos;
+  field->value_off = start;
+  field->value_len = end - start;
+  field->hash      = parser->hash;
+
+  /* only the first of repeated fields is indexed */
+  for( slot = field->hash & mask; tab->index[slot] != 0; slot = ( slot + 1 ) & mask )
+  {
+    other = & tab->field_tab[tab->index[slot] - 1];
+    if( other->hash == field->hash && other->name_len == field->name_len &&
+        SCAN_CaseEqual( & this->rcvbuf[other->name_off], & this->rcvbuf[field->name_off], field->name_len ) )
+      break;
+  }
+
+  if( tab->index[slot] == 0 )
+    tab->index[slot] = tab->nr_fields + 1;
+
+  id = KEYWORD_Lookup( & KEYWORD_Headers, & this->rcvbuf[field->name_off], field->name_len, field->hash );
+  if( id >= 0 && tab->known[id] == 0 )
+    tab->known[id] = tab->nr_fields + 1;
 
+  ++tab->nr_fields;
+  return HTTP_OK;
+}
 
 
 /*!
- *  Parse HTTP header
+ *  Incremental http header parser
  *
- *  result is written to:
+ *  Consumes all bytes received into this->rcvbuf since the last invocation
+ *  and remembers where it stopped, so it can be invoked again after each 
+ *  recv() call whatever number of bytes it returned.
  *
- *    this->url_path
- *    this->search_path
- *    this->frl
- *    this->mimetyp
+ *  Returns HTTP_OK when the end of header has been found, HTTP_PENDING
+ *  when more bytes are required and HTTP_HEADER_ERROR in case of a 
+ *  malformed request.
  */
-static int http_read_header( HTTP_OBJ* this )
+static int _http_parse_header( HTTP_OBJ* this )
 {
-  const int       frl_size = HTML_MAX_URL_SIZE + HTML_MAX_PATH_LEN;
-  char            *frl;         /* absolute path within local file system for given url */
-  char            *url_path;    /* first part of the URL */
-  char            *search_path; /* search path of the URL (separated by ?) */
-  char            value_str[30]; 
-   
-  int             path_sep_idx, error;
-  int             i, j;
-  
-  /* reset internal states first */
-  this->body_ptr      = 0;
-  this->body_len      = 0;
-  this->content_len   = 0;
-  this->header_len    = 0; 
-  this->mimetyp       = HTTP_MIME_UNDEFINED;
-  this->url_path      = NULL;
-  this->search_path   = NULL;
-  this->frl           = NULL;
-  this->keep_alive    = false;
+  HTTP_PARSER*  parser = & this->parser;
+  char*         buf    = this->rcvbuf;
+  int           len    = this->rcv_len;
+  int           pos    = parser->pos;
+  int           state  = parser->state;
+  int           c, i;
+
+  for( ; pos < len && state != HTTP_PARSE_DONE; ++pos )
+  {
+    c = (unsigned char) buf[pos];
 
-  /* read header bytes */
-  error = _http_receive_header( this );
-  if( error != HTTP_OK )
-    return error;
-    
-  /* allocate temporary used memory  */
-  this->url_path      = url_path    = OBJ_STACK_ALLOC( HTML_MAX_PATH_LEN );
-  this->search_path   = search_path = OBJ_STACK_ALLOC( HTML_MAX_URL_SIZE );
-  this->frl           = frl         = OBJ_STACK_ALLOC( frl_size );
-  if( this->frl == NULL )
-    return HTTP_STACK_OVERFLOW;
-  
-  /* get http mehtod */
-  if( strncmp( this->rcvbuf, HTTP_GET, sizeof(HTTP_GET)-1 ) == 0 )
-  {
-    this->method_id = HTTP_GET_ID;
-  }
-  else if( strncmp( this->rcvbuf, HTTP_POST, sizeof(HTTP_POST)-1 ) == 0 )
-  {
-    this->method_id = HTTP_POST_ID;
-  }
-  else if( strncmp( this->rcvbuf, HTTP_HEAD, sizeof(HTTP_HEAD)-1) == 0 )
-  {
-    this->method_id = HTTP_HEAD_ID;
-  }
-  else if( strncmp( this->rcvbuf, HTTP_PUT, sizeof(HTTP_PUT)-1 ) == 0 )
-  {
-    this->method_id = HTTP_PUT_ID;
-  }
-  else if( strncmp( this->rcvbuf, HTTP_DELETE, sizeof(HTTP_DELETE)-1 ) == 0 )
-  {
-    this->method_id = HTTP_DELETE_ID;
-  }
-  else if( strncmp( this->rcvbuf, HTTP_TRACE, sizeof(HTTP_TRACE)-1 ) == 0 )
-  {
-    this->method_id = HTTP_TRACE_ID;
-  }
-  else if( strncmp( this->rcvbuf, HTTP_OPTIONS, sizeof(HTTP_OPTIONS)-1 ) == 0 )
-  {
-    this->method_id = HTTP_OPTIONS_ID;
-  }
-  else if( strncmp( this->rcvbuf, HTTP_CONNECT, sizeof(HTTP_CONNECT)-1 ) == 0 )
-  {
-    this->method_id = HTTP_CONNECT_ID;
-  }  
-  else 
-  {
-    error = HTTP_WRONG_METHOD;
-  }
-          
-  /* get url */
-  error = _http_get_url_from_request( frl, this->rcvbuf );
-  if( error != 0 )
-    return error;
-  
-  /* in case its empty use default URL */
-  if( strlen( frl) == 0 )
-    strcpy( frl, HTTP_DEFAULT_URL_PATH );
-  
-  /* extract url path */
-  path_sep_idx = _http_search_path_index_from_url( frl );
-  strncpy( url_path, this->frl, path_sep_idx );
-  url_path[path_sep_idx] = '\0';
-  
-  /* extract search path */
-  j=0;
-  if( frl[path_sep_idx] == '?' )
-  {
-    for( i=path_sep_idx+1; frl[i] !='\0' && j < HTML_MAX_URL_SIZE; ++i, j++ )
-      search_path[j] = frl[i];
-  }
-  search_path[j]='\0';
+    switch( state )
+    {
+      case HTTP_PARSE_REQ_START:
+        if( c == '\r' || c == '\n' )
+          break;
+        if( ! _http_is_token_char( c ) )
+          return HTTP_HEADER_ERROR;
 
-  /* get mime type */
-  if( HTTP_get_value_for_key( 
-    value_str, sizeof( value_str ), 
-    "MIME-TYPE", 
-    this->rcvbuf, this->header_len )
-    )
-  {
-    this->mimetyp = _http_get_mime_type_from_string( value_str );
+        /* drop empty lines preceding the request, it is read from the beginning of the buffer */
+        if( pos > 0 )
+        {
+          memmove( buf, buf + pos, len - pos );
+          this->rcv_len = len = len - pos;
+          pos = 0;
+        }
+        parser->token_len = 1;
+        state = HTTP_PARSE_METHOD;
+        break;
+
+      case HTTP_PARSE_METHOD:
+        if( c == ' ' )
+          state = HTTP_PARSE_URI;
+        else if( ! _http_is_token_char( c ) || ++parser->token_len > MAX_HTTP_COMMAND_LEN )
+          return HTTP_HEADER_ERROR;
+        break;
+
+      case HTTP_PARSE_URI:
+        if( c == ' ' )
+          state = HTTP_PARSE_VERSION;
+        else if( c < 32 || c == 127 )
+          return HTTP_HEADER_ERROR;
+        else
+          pos += SCAN_FindControlOrSpace( buf + pos, len - pos ) - 1;   /* skip to the end of URI */
+        break;
+
+      case HTTP_PARSE_VERSION:
+      case HTTP_PARSE_FIELD_VALUE:
+        if( c >= 32 && c != 127 )
+          pos += SCAN_FindControl( buf + pos, len - pos ) - 1;          /* skip to the end of line */
+        else if( c == '\r' )
+        {
+          parser->eol = pos;
+          state = HTTP_PARSE_LINE_LF;
+        }
+        else if( c == '\n' )
+        {
+          parser->eol = pos;
+          state = HTTP_PARSE_FIELD_START;
+        }
+        else if( c == 0 )
+          return HTTP_HEADER_ERROR;
+        break;
+
+      case HTTP_PARSE_LINE_LF:
+        if( c != '\n' )
+          return HTTP_HEADER_ERROR;
+        state = HTTP_PARSE_FIELD_START;
+        break;
+
+      case HTTP_PARSE_FIELD_START:
+        if( c == ' ' || c == '\t' )
+        {
+          /* obsolete line folding, the value continues behind a space */
+          if( parser->value_pos >= 0 )
+          {
+            for( i = parser->eol; i < pos; ++i )
+              buf[i] = ' ';
+          }
+          state = HTTP_PARSE_FIELD_VALUE;
+          break;
+        }
+
+        /* previous field is complete */
+        if( parser->value_pos >= 0 && _http_add_header_field( this ) != HTTP_OK )
+          return HTTP_HEADER_ERROR;
+
+        if( c == '\r' )
+          state = HTTP_PARSE_END_LF;
+        else if( c == '\n' )
+          state = HTTP_PARSE_DONE;
+        else if( _http_is_token_char( c ) )
+        {
+          parser->name_pos = pos;
+          parser->hash     = KEYWORD_HashStep( KEYWORD_HASH_INIT, c );
+          state = HTTP_PARSE_FIELD_NAME;
+        }
+        else
+          return HTTP_HEADER_ERROR;
+        break;
+
+      case HTTP_PARSE_FIELD_NAME:
+        if( c == ':' )
+        {
+          parser->value_pos = pos + 1;
+          state = HTTP_PARSE_FIELD_VALUE;
+        }
+        else if( _http_is_token_char( c ) )
+          parser->hash = KEYWORD_HashStep( parser->hash, c );
+        else
+          return HTTP_HEADER_ERROR;
+        break;
+
+      case HTTP_PARSE_END_LF:
+        if( c != '\n' )
+          return HTTP_HEADER_ERROR;
+        state = HTTP_PARSE_DONE;
+        break;
+    }
   }
-  else 
+
+  parser->pos   = pos;
+  parser->state = state;
+
+  if( state != HTTP_PARSE_DONE )
+    return HTTP_PENDING;
+
+  /* end of header, body follows right behind */
+  this->rcvbuf[parser->eol] = '\0';
+  this->header_len = parser->eol;
+  this->body_ptr   = & this->rcvbuf[pos];
+  return HTTP_OK;
+}
+
+
+/*!
+ *  receice http header from socket connection
+ *
+ *  Reads as many bytes as the socket delivers at once and feeds
+ *  them to the incremental header parser. Bytes following the
+ *  header already belong to the body.
+ */
+static int _http_receive_header( HTTP_OBJ* this )
+{
+  char* buf;
+  long  n, size;
+  int   error;
+
+  for( ;; )
   {
-    this->mimetyp = _http_get_mime_type_from_filename( url_path );
+    /* parse what has been received so far */
+    error = _http_parse_header( this );
+    if( error != HTTP_PENDING )
+      return error;
+
+    /* keep one byte for string termination */
+    size = MAX_HTML_BUF_LEN - 1 - this->rcv_len;
+    if( size <= 0 )
+      return HTTP_HEADER_ERROR;
+
+    /* more data is delivered by HTTP_CommitReceived() */
+    if( this->nonblocking == HTTP_IO_COMPLETION )
+      return HTTP_PENDING;
+
+    buf = this->rcvbuf + this->rcv_len;
+    if( this->nonblocking )
+      n = HTTP_SOCKET_RECV_NOWAIT( this->socket, buf, size );
+    else
+      n = HTTP_SOCKET_RECV( this->socket, buf, size );
+
+    if( n <= 0 )
+      return _http_map_io_error( n, HTTP_RCV_ERROR );
+
+    this->rcv_len += n;
   }
+}
 
-  printf( "URL-PATH: %s\n", url_path );
-  printf( "MIME-TYPE: %s\n", HttpMimeTypeTable[this->mimetyp].txt );
-  printf( "SEARCH-PATH: %s\n", search_path );
-  
-  /* concatenate resource file name */
-  strcpy( frl, this->ht_root_dir );
-  strncat( frl, url_path, frl_size - strlen( this->ht_root_dir ) );
-  frl[frl_size-1]='\0';
 
-  /* get keep-alive state */
-  if( HTTP_get_value_for_key( 
-    value_str, sizeof( value_str ), 
-    "Connection", 
-    this->rcvbuf, this->header_len )
-    )
+/*!
+ *  receice http body block from socket connection ( post )
+ */
+static int _http_receive_body( HTTP_OBJ* this )
+{
+  const int   body_offset = this->body_ptr - this->rcvbuf;
+  int         received    = this->rcv_len - body_offset;
+  long        n = 0;
+
+  /* check for enough memory space before reading  */
+  if( this->body_len < 0 || this->body_len > MAX_HTML_BUF_LEN - body_offset - 1 )
+    return HTTP_POST_DATA_TOO_BIG;
+
+  /* parts of the body might have been received together with the header */
+  if( received > this->body_len )
+    received = this->body_len;
+
+  if( received < this->body_len && this->nonblocking == HTTP_IO_COMPLETION )
+    return HTTP_PENDING;
+
+  while( received < this->body_len )
   {
-    if( strcasestr( value_str, "keep-alive" ) && HTTP_KEEP_ALIVE )
-        this->keep_alive = true;
-  }
+    if( this->nonblocking )
+      n = HTTP_SOCKET_RECV_NOWAIT( this->socket, this->body_ptr + received, this->body_len - received );
+    else
+      n = HTTP_SOCKET_RECV( this->socket, this->body_ptr + received, this->body_len - received );
+    
+    if( n <= 0 )
+      break;
 
-  /* get received content length */
-  if( HTTP_get_value_for_key( 
-    value_str, sizeof( value_str ), 
-    "Content-Length", 
-    this->rcvbuf, this->header_len )
-    )
+    received      += n;
+    this->rcv_len += n;
+  }
+    
+  if( received < this->body_len )
   {
-    this->body_len = atoi( value_str );
+    n = _http_map_io_error( n, HTTP_POST_IO_ERROR );
+    return ( n == HTTP_CONNECTION_CLOSED ) ? HTTP_POST_IO_ERROR : n;
   }
 
+  /* ensure EOL termination of body string, it might overwrite the first byte of a pipelined request */
+  this->req_end       = body_offset + this->body_len;
+  this->rcv_next_char = this->body_ptr[this->body_len];
+  this->body_ptr[this->body_len] = '\0';
   return HTTP_OK;
 }
 
 
 /*!
- *  Determine length of static content
+ *  find route which receives the multipart body of the current request
+ *  in pieces, NULL if the body is buffered as usual. The URL is evaluated
+ *  here already since the header is parsed after the body is received.
+ */
+static const ROUTER_ROUTE* _http_find_upload_route( HTTP_OBJ* this, const char* content_type )
+{
+  char                url[HTML_MAX_URL_SIZE];
+  ROUTER_PARAM        param_tab[ROUTER_MAX_PARAMS];
+  const ROUTER_ROUTE* route;
+  int                 method_id;
+
+  if( content_type == NULL || _http_get_mime_type_from_string( content_type ) != HTTP_MIME_MULTIPART_FORM_DATA )
+    return NULL;
+
+  method_id = KEYWORD_Lookup( & KEYWORD_Methods, this->rcvbuf, this->parser.token_len, 
+                              KEYWORD_Hash( this->rcvbuf, this->parser.token_len ) );
+  if( method_id != HTTP_POST_ID || _http_get_url_from_request( url, this->rcvbuf ) != HTTP_OK )
+    return NULL;
+
+  url[_http_search_path_index_from_url( url )] = '\0';
+  route = ROUTER_Lookup( & this->cgi_handler_obj->cgi_router, url, method_id, param_tab );
+
+  return ( route != NULL && route->upload_handler != NULL ) ? route : NULL;
+}
+
+
+/*!
+ *  receive multipart body ( post ) and pass it in pieces to the parser of
+ *  the upload route. Only the bytes the parser cannot decide about yet are
+ *  kept in the receive buffer, hence the body can exceed its size.
  */
-static void _http_set_content_length_to_file_len( HTTP_OBJ* this )
+static int _http_receive_upload( HTTP_OBJ* this )
 {
-  FILE* fp;
+  const int   body_offset = this->body_ptr - this->rcvbuf;
+  long        buffered, consumed, size;
+  long        n = 0;
+
+  if( this->body_len < 0 )
+    return HTTP_POST_DATA_TOO_BIG;
 
-  if( this->frl != NULL )
+  for( ;; )
   {
-    /* generate server response, open requested resource */
-    fp = fopen( this->frl, "r" );
-    if( fp != NULL )
+    /* bytes behind the body already belong to a pipelined request */
+    buffered = this->rcv_len - body_offset;
+    if( buffered > this->body_len - this->body_fed )
+      buffered = this->body_len - this->body_fed;
+
+    consumed = MULTIPART_Feed( & this->upload, this->body_ptr, buffered );
+    if( consumed < 0 )
+      return HTTP_UPLOAD_ERROR;
+
+    memmove( this->body_ptr, this->body_ptr + consumed, this->rcv_len - body_offset - consumed );
+    this->rcv_len  -= consumed;
+    this->body_fed += consumed;
+
+    if( this->body_fed + ( buffered - consumed ) >= this->body_len )
+      break;
+
+    /* keep one byte for string termination, a part header has to fit into the buffer */
+    size = MAX_HTML_BUF_LEN - 1 - this->rcv_len;
+    if( size <= 0 )
+      return HTTP_UPLOAD_ERROR;
+
+    /* more data is delivered by HTTP_CommitReceived() */
+    if( this->nonblocking == HTTP_IO_COMPLETION )
+      return HTTP_PENDING;
+
+    if( size > this->body_len - this->body_fed - ( buffered - consumed ) )
+      size = this->body_len - this->body_fed - ( buffered - consumed );
+
+    if( this->nonblocking )
+      n = HTTP_SOCKET_RECV_NOWAIT( this->socket, this->rcvbuf + this->rcv_len, size );
+    else
+      n = HTTP_SOCKET_RECV( this->socket, this->rcvbuf + this->rcv_len, size );
+
+    if( n <= 0 )
     {
-      /* compute the file size of the requested resource and generate ack */
-      fseek( fp, 0, SEEK_END );
-      this->content_len = ftell( fp );
-      fseek( fp, 0, SEEK_SET );
-      fclose( fp );
+      n = _http_map_io_error( n, HTTP_POST_IO_ERROR );
+      return ( n == HTTP_CONNECTION_CLOSED ) ? HTTP_POST_IO_ERROR : n;
     }
+
+    this->rcv_len += n;
   }
+
+  /* body completely received, the closing boundary has to be found */
+  if( MULTIPART_Finish( & this->upload ) != 0 )
+    return HTTP_UPLOAD_ERROR;
+
+  /* nothing of the body is left, following bytes belong to a pipelined request */
+  this->body_len      = 0;
+  this->req_end       = body_offset;
+  this->rcv_next_char = this->body_ptr[0];
+  this->body_ptr[0]   = '\0';
+  return HTTP_OK;
 }
 
 
 /*!
- *  Process HTTP HEAD command (wrapper)
+ *  receive http request ( header and body ) from socket connection,
+ *  resumes at the state where the last invocation stopped
  */
-static int http_head( HTTP_OBJ* this )
+static int _http_receive_request( HTTP_OBJ* this )
 {
-  int             error = 0;
-  int             handler_id;
-  struct stat     file_stat;
-  
-  printf("received HEAD command: %s\n", this->rcvbuf );
-    
-  /* check whether CGI handler exists */
-  if( ( handler_id = _find_cgi_handler( this ) ) >= 0 )
+  const char* value;
+  int         error = HTTP_OK;
+
+  if( this->req_state == HTTP_REQ_HEADER )
   {
-    /* but do not invoke for head method */
+    error = _http_receive_header( this );
+    if( error != HTTP_OK )
+      return error;
+
+    /* get received content length */
+    if( ( value = HTTP_GetKnownHeader( this, HTTP_HDR_CONTENT_LENGTH, NULL ) ) != NULL )
+      this->body_len = atoi( value );
+
+    /* multipart bodies of upload routes are not buffered */
+    value = HTTP_GetKnownHeader( this, HTTP_HDR_CONTENT_TYPE, NULL );
+    if( ( this->upload_route = _http_find_upload_route( this, value ) ) != NULL &&
+        MULTIPART_Init( & this->upload, value, this->upload_route->upload_handler, this ) != 0 )
+      return HTTP_UPLOAD_ERROR;
+
+    this->req_state = HTTP_REQ_BODY;
   }
-  else
+
+  if( this->req_state == HTTP_REQ_BODY )
   {
-    /* otherwise check for static content (html, javascript, jpeg, etc) */
- 
-    /* check for correct file status ( must be ordinary file, no directory ) */
-    error = stat( this->frl, & file_stat );
-    if( !error )
-    {
-      if( !( file_stat.st_mode & S_IFREG ) )
-      {
-        HTTP_SendHeader( this, HTTP_ACK_NOT_FOUND );
-        return HTTP_FILE_NOT_FOUND;
-      }
-    }    
-          
-    /* set content length in http header and always request disconnection */
-    _http_set_content_length_to_file_len( this );
-    
-    /* generate header */
-    error = HTTP_SendHeader( this, HTTP_ACK_OK );
-    if( error < 0 )
-    {
+    if( this->upload_route != NULL )
+      error = _http_receive_upload( this );
+    else
+      error = _http_receive_body( this );
+    if( error != HTTP_OK )
       return error;
-    }
+
+    this->req_state = HTTP_REQ_COMPLETE;
   }
-  
+
   return error;
 }
 
 
 /*!
- *  Process HTTP GET command
+ *  check whether the request line ends with protocol version HTTP/1.1
  */
-static int http_get( HTTP_OBJ* this )
+static int _http_is_version_1_1( const HTTP_OBJ* this )
 {
-  FILE*           fp;
-  char            buf[HTML_CHUNK_SIZE];
-  int             bytes_read, bytes_written;
-  int             error = 0;
-  int             handler_id;
-  struct stat     file_stat;
-  int             chk_cnt = 0;
-  
-  printf("received GET command: %s\n", this->rcvbuf );
-    
-  /* check whether CGI handler exists */
-  if( ( handler_id = _find_cgi_handler( this ) ) >= 0 )
+  const char* eol = memchr( this->rcvbuf, '\n', this->header_len );
+  int         len = ( eol != NULL ) ? eol - this->rcvbuf : this->header_len;
+
+  while( len > 0 && ( this->rcvbuf[len-1] == '\r' || this->rcvbuf[len-1] == ' ' ) )
+    --len;
+
+  return ( len >= 8 && strncmp( & this->rcvbuf[len-8], "HTTP/1.1", 8 ) == 0 );
+}
+
+
+/*!
+ *  reset all request specific states in order to receive the next request
+ */
+static void _http_reset_request( HTTP_OBJ* this )
+{
+  /* let the part handler release a part which has not been completed */
+  if( this->upload_route != NULL )
   {
-    /* and if so invoke it */
-    error = _call_cgi_handler( this, handler_id );
+    MULTIPART_Finish( & this->upload );
+    this->upload_route     = NULL;
+    this->upload.nr_parts  = 0;
+    this->upload.total_len = 0;
   }
-  else 
-  {
-    /* otherwise deliver static content (html, javascript, jpeg, etc) */
-    
-    /* check for correct file status ( must be ordinary file, no directory ) */
-    error = stat( this->frl, & file_stat );
-    if( !error )
-    {
-      if( !( file_stat.st_mode & S_IFREG ) )
-      {
-        HTTP_SendHeader( this, HTTP_ACK_NOT_FOUND );
-        return HTTP_FILE_NOT_FOUND;
-      }
-    }
-    
-    /* set content length in http header */
-    _http_set_content_length_to_file_len( this );
-        
 
-    /* open and copy static content from file system */
-    fp = fopen( this->frl, "r" );
-    if( fp == NULL )
-    {
-      HTTP_SendHeader( this, HTTP_ACK_NOT_FOUND );
-      return HTTP_FILE_NOT_FOUND;
-    }
-    else 
-    {
-      /* generate header */
-      error = HTTP_SendHeader( this, HTTP_ACK_OK );
-      if( error < 0 )
-      {
-        return error;
-      }
-    }
+  this->req_state     = HTTP_REQ_HEADER;
+  this->rcv_len       = 0;
+  this->parser.state  = HTTP_PARSE_REQ_START;
+  this->parser.pos    = 0;
+  this->parser.value_pos = -1;
+  this->header_tab.nr_fields = 0;
+  memset( this->header_tab.index, 0, sizeof( this->header_tab.index ) );
+  memset( this->header_tab.known, 0, sizeof( this->header_tab.known ) );
+  this->body_ptr      = this->rcvbuf;
+  this->body_len      = 0;
+  this->body_fed      = 0;
+  this->req_end       = 0;
+  this->header_len    = 0; 
+}
 
-    /* write header/content separation line */
-    if( HTTP_SOCKET_SEND( this->socket, "\r\n\r\n", 4) != 4 )
-    {
-      error = HTTP_SEND_ERROR;
-    }
-    
-    /* read file blockwise and send it to the server */
-    do {
-      bytes_read = fread( buf, sizeof(char), HTML_CHUNK_SIZE, fp );
-      bytes_written = HTTP_SOCKET_SEND( this->socket, buf, bytes_read );
-      chk_cnt += bytes_read;
-    } while( bytes_read > 0  &&  bytes_written == bytes_read );
-    
-    fclose( fp );
+
+/*!
+ *  reset request specific states after a complete request, bytes of 
+ *  pipelined requests received already are moved to the beginning of
+ *  the receive buffer and are parsed before reading from the socket
+ */
+static void _http_next_request( HTTP_OBJ* this )
+{
+  const int req_len  = this->req_end;
+  const int leftover = this->rcv_len - req_len;
+
+  _http_reset_request( this );
+
+  if( leftover > 0 )
+  {
+    this->rcvbuf[req_len] = this->rcv_next_char;
+    memmove( this->rcvbuf, this->rcvbuf + req_len, leftover );
+    this->rcv_len = leftover;
   }
-  
-  return error;
 }
 
 
 /*!
- *  Process HTTP POST command
+ *  static content in memory has been transmitted, give back its cache entry, content pack or output queue
  */
-static int http_post( HTTP_OBJ* this )
+static void _http_release_snd_mem( HTTP_OBJ* this )
 {
-  int         handler_id;
-  int         error = 0;
-   
-  printf("received POST command: %s\n", this->rcvbuf );
-
-  /* read post block */
-  error = _http_receive_body( this );
-  if( error != HTTP_OK )
-    return error;
+  if( this->snd_cache_entry != NULL )
+  {
+    FILECACHE_Unref( this->file_cache, this->snd_cache_entry );
+    this->snd_cache_entry = NULL;
+  }
 
-  /* check whether CGI handler exists */
-  if( ( handler_id = _find_cgi_handler( this ) ) >= 0 )
+  if( this->snd_pack != NULL )
   {
-    /* and if so invoke it */
-    error = _call_cgi_handler( this, handler_id );
+    PACK_Release( this->pack_store, this->snd_pack );
+    this->snd_pack = NULL;
   }
-  else 
+
+  if( this->snd_queue != NULL )
   {
-    /* when no handler exists generate page not found error */
-    HTTP_SendHeader( this, HTTP_ACK_NOT_FOUND );
-    error = HTTP_CGI_HANLDER_NOT_FOUND;
+    free( this->snd_queue );
+    this->snd_queue      = NULL;
+    this->snd_queue_size = 0;
   }
 
-  return error;
+  this->snd_mem = NULL;
 }
 
 
 /*!
- *  Process HTTP PUT command
+ *  transmit next part of static content file without copying it
+ *  through user space, returns HTTP_OK when sendfile is not supported
+ *  by transport or file. In this case the file is copied blockwise.
  */
-static int http_put( HTTP_OBJ* this )
+static int _http_sendfile_pending( HTTP_OBJ* this )
 {
-  FILE*           fp;
-  int             bytes_written;
-  int             error = 0;
-  struct stat     file_stat;
-  
-  printf("received PUT command: %s\n", this->rcvbuf );
-    
+#ifdef HTTP_SOCKET_SENDFILE
+  const int   fd = this->snd_fd;
+  const long  remaining = this->snd_file_len - this->snd_file_pos;
+  long        n;
+
+  if( this->nonblocking )
+    n = HTTP_SOCKET_SENDFILE_NOWAIT( this->socket, fd, this->snd_file_pos, remaining );
+  else
+    n = HTTP_SOCKET_SENDFILE( this->socket, fd, this->snd_file_pos, remaining );
   
-  /* otherwise store static content (html, json, etc.) */
+  if( n == HTTP_IO_UNSUPPORTED )
+  {
+    /* fall back to buffered copy */
+    this->snd_sendfile = false;
+    lseek( this->snd_fd, this->snd_file_pos, SEEK_SET );
+    return HTTP_OK;
+  }
+
+  if( n < 0 || ( n < remaining && ! this->nonblocking ) )
+    return HTTP_SEND_ERROR;
   
-  /* check for correct file status ( must be ordinary file, no directory ) */
-  error = stat( this->frl, & file_stat );
-  if( !error )
+  this->snd_file_pos += n;
+  if( this->snd_file_pos < this->snd_file_len )
+    return HTTP_PENDING;
+
+  close( this->snd_fd );
+  this->snd_fd = -1;
+#else
+  this->snd_sendfile = false;
+#endif /* #ifdef HTTP_SOCKET_SENDFILE */
+
+  return HTTP_OK;
+}
+
+
+/*!
+ *  transmit pending data of sndbuf and static content file 
+ */
+static int _http_send_pending( HTTP_OBJ* this )
+{
+  long  n;
+  int   error;
+
+  for( ;; )
   {
-    if( !( file_stat.st_mode & S_IFREG ) )
+    if( this->snd_pos < this->snd_len )
     {
-      HTTP_SendHeader( this, HTTP_ACK_NOT_FOUND );
-      return HTTP_FILE_NOT_FOUND;
+      /* when file content follows do not send out the header in a segment of its own */
+      if( ( this->snd_fd >= 0 && this->snd_sendfile ) || this->snd_mem != NULL )
+      {
+        if( this->nonblocking )
+          n = HTTP_SOCKET_SEND_MORE_NOWAIT( this->socket, this->sndbuf + this->snd_pos, this->snd_len - this->snd_pos );
+        else
+          n = HTTP_SOCKET_SEND_MORE( this->socket, this->sndbuf + this->snd_pos, this->snd_len - this->snd_pos );
+      }
+      else if( this->nonblocking )
+        n = HTTP_SOCKET_SEND_NOWAIT( this->socket, this->sndbuf + this->snd_pos, this->snd_len - this->snd_pos );
+      else
+        n = HTTP_SOCKET_SEND( this->socket, this->sndbuf + this->snd_pos, this->snd_len - this->snd_pos );
+
+      if( n < 0 || ( n < this->snd_len - this->snd_pos && ! this->nonblocking ) )
+      {
+        HTTP_DetachSocket( this );
+        return HTTP_SEND_ERROR;
+      }
+
+      this->snd_pos += n;
+      if( this->snd_pos < this->snd_len )
+        return HTTP_PENDING;
+    }
+    else if( this->snd_mem != NULL )
+    {
+      /* cached or compiled-in static content is transmitted straight from memory */
+      if( this->nonblocking )
+        n = HTTP_SOCKET_SEND_NOWAIT( this->socket, this->snd_mem + this->snd_file_pos, this->snd_file_len - this->snd_file_pos );
+      else
+        n = HTTP_SOCKET_SEND( this->socket, this->snd_mem + this->snd_file_pos, this->snd_file_len - this->snd_file_pos );
+
+      if( n < 0 || ( n < this->snd_file_len - this->snd_file_pos && ! this->nonblocking ) )
+      {
+        HTTP_DetachSocket( this );
+        return HTTP_SEND_ERROR;
+      }
+
+      this->snd_file_pos += n;
+      if( this->snd_file_pos < this->snd_file_len )
+        return HTTP_PENDING;
+
+      _http_release_snd_mem( this );
+    }
+    else if( this->snd_fd >= 0 && this->snd_sendfile )
+    {
+      /* zero copy transmission of static content */
+      error = _http_sendfile_pending( this );
+      if( error == HTTP_SEND_ERROR )
+        HTTP_DetachSocket( this );
+      if( error != HTTP_OK )
+        return error;
+    }
+    else if( this->snd_fd >= 0 )
+    {
+      /* read next chunk of static content */
+      this->snd_pos = 0;
+      this->snd_len = read( this->snd_fd, this->sndbuf, HTTP_SND_BUF_LEN );
+      if( this->snd_len <= 0 )
+      {
+        close( this->snd_fd );
+        this->snd_fd  = -1;
+        this->snd_len = 0;
+      }
+    }
+    else 
+    {
+      /* response complete, next one starts at the beginning of the buffer */
+      this->snd_len = 0;
+      this->snd_pos = 0;
+      return HTTP_OK;
     }
   }
-  
-    /* read post block */
-  error = _http_receive_body( this );
-  if( error != HTTP_OK )
-    return error;
-  
-      
+}
 
-  /* open and copy static content from file system */
-  fp = fopen( this->frl, "w" );
-  if( fp == NULL )
+
+/*!
+ *  append content which does not fit into the transmit buffer to the 
+ *  output queue, it is transmitted behind sndbuf like static content 
+ *  in memory when the socket is ready again
+ */
+static int _http_queue_content( HTTP_OBJ* this, const char* content, const long len )
+{
+  long  size = this->snd_queue_size;
+  char* queue;
+
+  if( this->snd_queue == NULL )
+    this->snd_file_pos = this->snd_file_len = 0;
+
+  if( this->snd_file_len + len > size )
   {
-    HTTP_SendHeader( this, HTTP_ACK_NOT_FOUND );
-    return HTTP_FILE_NOT_FOUND;
+    if( size == 0 )
+      size = HTTP_SND_BUF_LEN;
+    while( size < this->snd_file_len + len )
+      size *= 2;
+
+    queue = realloc( this->snd_queue, size );
+    if( queue == NULL )
+      return HTTP_HEAP_OVERFLOW;
+
+    this->snd_queue      = queue;
+    this->snd_queue_size = size;
   }
 
-  /* write file and save it to servers filesystem */
-  bytes_written = fwrite( this->body_ptr, sizeof(char), this->body_len, fp );
-  fclose( fp );
-  
-  if( bytes_written != this->body_len )
+  memcpy( this->snd_queue + this->snd_file_len, content, len );
+  this->snd_file_len += len;
+  this->snd_mem       = this->snd_queue;
+  return HTTP_OK;
+}
+
+
+/*!
+ *  queue content of response in the transmit buffer, it is transmitted 
+ *  right away when the buffer is full
+ */
+static int _http_send_content( HTTP_OBJ* this, const void* buf, const long len )
+{
+  struct iovec    iov[2];
+  const char*     content = buf;
+  long            pending, rest, n;
+
+  if( len <= 0 )
+    return HTTP_OK;
+
+  /* once content is queued everything else has to follow behind it */
+  if( this->snd_queue != NULL )
+    return _http_queue_content( this, content, len );
+
+  /* small fragments are collected in the transmit buffer */
+  if( len <= HTTP_SND_BUF_LEN - this->snd_len )
   {
-    HTTP_SendHeader( this, HTTP_ACK_INTERNAL_ERROR );
-    error = HTTP_FILE_IO_ERROR;
+    memcpy( this->sndbuf + this->snd_len, content, len );
+    this->snd_len += len;
+    return HTTP_OK;
   }
+
+  /* otherwise transmit queued bytes and fragment with one call */
+  pending = this->snd_len - this->snd_pos;
+  iov[0].iov_base = this->sndbuf + this->snd_pos;
+  iov[0].iov_len  = pending;
+  iov[1].iov_base = (void *) content;
+  iov[1].iov_len  = len;
+
+  if( this->nonblocking )
+    n = HTTP_SOCKET_SENDV_NOWAIT( this->socket, iov, 2 );
   else
-  { 
-    HTTP_SendHeader( this, HTTP_ACK_OK );
-    error = HTTP_OK;
+    n = HTTP_SOCKET_SENDV( this->socket, iov, 2 );
+
+  if( n < 0 )
+    return HTTP_SEND_ERROR;
+
+  if( n < pending )
+  {
+    this->snd_pos += n;
+    rest = len;
   }
-  
-  return error;
+  else
+  {
+    this->snd_pos = this->snd_len = 0;
+    content += n - pending;
+    rest = len - ( n - pending );
+  }
+
+  if( rest == 0 )
+    return HTTP_OK;
+
+  /* socket is full, keep the rest in the transmit buffer if possible */
+  if( this->snd_pos > 0 )
+  {
+    memmove( this->sndbuf, this->sndbuf + this->snd_pos, this->snd_len - this->snd_pos );
+    this->snd_len -= this->snd_pos;
+    this->snd_pos = 0;
+  }
+
+  if( this->nonblocking && rest <= HTTP_SND_BUF_LEN - this->snd_len )
+  {
+    memcpy( this->sndbuf + this->snd_len, content, rest );
+    this->snd_len += rest;
+    return HTTP_OK;
+  }
+
+  /* never wait for the peer in an event loop, transmission is continued by HTTP_SendPending() */
+  if( this->nonblocking )
+    return _http_queue_content( this, content, rest );
+
+  /* caller's buffer goes out of scope, we have to wait for the peer */
+  iov[0].iov_base = this->sndbuf;
+  iov[0].iov_len  = this->snd_len;
+  iov[1].iov_base = (void *) content;
+  iov[1].iov_len  = rest;
+  if( HTTP_SOCKET_SENDV( this->socket, iov, 2 ) != this->snd_len + rest )
+    return HTTP_SEND_ERROR;
+
+  this->snd_len = 0;
+  return HTTP_OK;
 }
 
 
+#ifdef HTTP_USE_ZLIB
+
 /*!
- *  Process HTTP DELETE command
+ *  Set up compression of the response generated by a CGI handler. It is 
+ *  done when the client accepts gzip or deflate coding and the content
+ *  is big enough. The compressed content is sent in chunks, hence this
+ *  requires HTTP/1.1.
  */
-static int http_delete( HTTP_OBJ* this )
+static void _http_deflate_start( HTTP_OBJ* this )
 {
-  /*
-   *  not implemented yet
-   */
-  return HTTP_NOT_IMPLEMENTED_YET;
+  z_stream* stream;
+  int       encoding, window_bits, len;
+
+  if( ! this->cgi_active || this->method_id == HTTP_HEAD_ID || this->content_encoding != HTTP_ENCODING_IDENTITY ||
+      ( this->content_len >= 0 && this->content_len < HTTP_DEFLATE_MIN_LEN ) || ! _http_is_version_1_1( this ) )
+    return;
+
+  if( this->accept_encoding & HTTP_ENCODING_MASK( HTTP_ENCODING_GZIP ) )
+  {
+    encoding    = HTTP_ENCODING_GZIP;
+    window_bits = HTTP_DEFLATE_WINDOW_BITS + 16;    /* gzip wrapper */
+  }
+  else if( this->accept_encoding & HTTP_ENCODING_MASK( HTTP_ENCODING_DEFLATE ) )
+  {
+    encoding    = HTTP_ENCODING_DEFLATE;
+    window_bits = HTTP_DEFLATE_WINDOW_BITS;         /* zlib wrapper */
+  }
+  else
+    return;
+
+  stream = calloc( 1, sizeof( z_stream ) );
+  if( stream == NULL )
+    return;
+
+  if( deflateInit2( stream, HTTP_DEFLATE_LEVEL, Z_DEFLATED, window_bits, HTTP_DEFLATE_MEM_LEVEL, Z_DEFAULT_STRATEGY ) != Z_OK )
+  {
+    free( stream );
+    return;
+  }
+
+  this->deflate_stream    = stream;
+  this->content_encoding  = encoding;
+  this->vary_encoding     = true;
+  this->content_len       = -1;
+  this->snd_chunked       = true;
+
+  /* compressed content is not byte-wise equal to the one of a strong entity tag */
+  len = strlen( this->etag );
+  if( this->etag[0] == '"' && len + 2 < HTTP_MAX_ETAG_LEN )
+  {
+    memmove( this->etag + 2, this->etag, len + 1 );
+    memcpy( this->etag, "W/", 2 );
+  }
 }
 
+
 /*!
- *  Process HTTP TRACE command
+ *  transmit one chunk of compressed content
  */
-static int http_trace( HTTP_OBJ* this )
+static int _http_send_chunk( HTTP_OBJ* this, const void* buf, const long len )
 {
-  /*
-   *  not implemented yet
-   */
-  return HTTP_NOT_IMPLEMENTED_YET;
+  char  size_line[20];
+  int   error;
+
+  snprintf( size_line, sizeof( size_line ), "%lx\r\n", len );
+
+  error = _http_send_content( this, size_line, strlen( size_line ) );
+  if( ! error )
+    error = _http_send_content( this, buf, len );
+  if( ! error )
+    error = _http_send_content( this, "\r\n", 2 );
+
+  return error;
 }
 
+
 /*!
- *  Process HTTP OPTIONS command
+ *  compress given content and transmit the compressed bytes in chunks, 
+ *  flush is passed to deflate()
  */
-static int http_options( HTTP_OBJ* this )
+static int _http_deflate( HTTP_OBJ* this, const void* buf, const long len, const int flush )
 {
-  /*
-   *  not implemented yet
-   */
-  return HTTP_NOT_IMPLEMENTED_YET;
+  z_stream*     stream = this->deflate_stream;
+  unsigned char out[HTTP_DEFLATE_CHUNK_LEN];
+  long          n;
+  int           error = HTTP_OK;
+
+  stream->next_in   = (unsigned char *) buf;
+  stream->avail_in  = len;
+
+  /* output buffer is filled completely as long as compressed bytes are pending */
+  do
+  {
+    stream->next_out  = out;
+    stream->avail_out = sizeof( out );
+    if( deflate( stream, flush ) == Z_STREAM_ERROR )
+      return HTTP_CGI_EXEC_ERROR;
+
+    n = sizeof( out ) - stream->avail_out;
+    if( n > 0 )
+      error = _http_send_chunk( this, out, n );
+  } 
+  while( error == HTTP_OK && stream->avail_out == 0 );
+
+  return error;
 }
 
+
 /*!
- *  Process HTTP CONNECT command
+ *  complete compressed response after the CGI handler has returned
+ *  with given error code, the compressor is released
  */
-static int http_connect( HTTP_OBJ* this )
+static int _http_deflate_end( HTTP_OBJ* this, int error )
 {
-  /*
-   *  not implemented yet
-   */
-  return HTTP_NOT_IMPLEMENTED_YET;
+  if( ! error )
+    error = _http_deflate( this, NULL, 0, Z_FINISH );
+
+  /* last chunk */
+  if( ! error )
+    error = _http_send_content( this, "0\r\n\r\n", 5 );
+
+  deflateEnd( this->deflate_stream );
+  free( this->deflate_stream );
+  this->deflate_stream = NULL;
+
+  /* the end of an incomplete response cannot be recognized by the client */
+  if( error )
+    this->keep_alive = false;
+
+  return error;
+}
+
+#endif /* #ifdef HTTP_USE_ZLIB */
+
+
+/*
+ *  Find caching policy for the current response, NULL if none applies
+ */
+static const HTTP_CACHE_RULE* _http_find_cache_rule( HTTP_OBJ* this )
+{
+  const HTTP_CACHE_RULE*  cache_rule_tab     = this->cgi_handler_obj->cache_rule_tab;
+  const int               cache_rule_tab_top = this->cgi_handler_obj->cache_rule_tab_top;
+  const char*             prefix;
+  int                     i;
+
+  if( this->url_path == NULL )
+    return NULL;
+
+  for( i=0; i < cache_rule_tab_top; ++i )
+  {
+    prefix = cache_rule_tab[i].url_prefix;
+    if( prefix != NULL )
+    {
+      if( strncmp( this->url_path, prefix, strlen( prefix ) ) == 0 )
+        return & cache_rule_tab[i];
+    }
+    else if( ! this->cgi_active && this->mimetyp == cache_rule_tab[i].mimetyp )
+    {
+      /* file types apply to static content only */
+      return & cache_rule_tab[i];
+    }
+  }
+
+  return NULL;
+}
+
+
+/*
+ *  Invokes CGI handler of given ID and returns handlers error code
+ */
+static int _call_cgi_handler( HTTP_OBJ* this, const ROUTER_ROUTE* route )
+{
+  int error;
+    
+  this->cgi_active = true;
+  this->cgi_route  = route;
+  error = (*route->handler)( this );
+  this->cgi_route  = NULL;
+  this->cgi_active = false;
+
+#ifdef HTTP_USE_ZLIB
+  /* complete compressed response */
+  if( this->deflate_stream != NULL )
+    error = _http_deflate_end( this, error );
+#endif
+
+  return error;
+}
+
+
+/*!
+ *  Parse HTTP header
+ *
+ *  result is written to:
+ *
+ *    this->url_path
+ *    this->search_path
+ *    this->frl
+ *    this->mimetyp
+ */
+static int http_read_header( HTTP_OBJ* this )
+{
+  const int       frl_size = HTML_MAX_URL_SIZE + HTML_MAX_PATH_LEN;
+  char            *frl;         /* absolute path within local file system for given url */
+  char            *url_path;    /* first part of the URL */
+  char            *search_path; /* search path of the URL (separated by ?) */
+  const char*     value;
+   
+  int             path_sep_idx, error;
+  int             i, j;
+  
+  /* reset internal states first */
+  this->content_len   = 0;
+  this->mimetyp       = HTTP_MIME_UNDEFINED;
+  this->url_path      = NULL;
+  this->search_path   = NULL;
+  this->frl           = NULL;
+  this->keep_alive    = false;
+  this->accept_encoding   = 0;
+  this->content_encoding  = HTTP_ENCODING_IDENTITY;
+  this->vary_encoding     = false;
+  this->snd_chunked       = false;
+  this->etag[0]           = '\0';
+  this->last_modified     = 0;
+  this->cache_rule        = NULL;
+  this->query_parsed      = false;
+  this->form_parsed       = false;
+
+  /* allocate temporary used memory  */
+  this->url_path      = url_path    = OBJ_STACK_ALLOC( HTML_MAX_PATH_LEN );
+  this->search_path   = search_path = OBJ_STACK_ALLOC( HTML_MAX_URL_SIZE );
+  this->frl           = frl         = OBJ_STACK_ALLOC( frl_size );
+  if( this->frl == NULL )
+    return HTTP_STACK_OVERFLOW;
+  
+  /* get http mehtod, the parser has left the length of the method token, 
+     unknown methods are rejected by HTTP_ProcessRequest() */
+  this->method_id = KEYWORD_Lookup( & KEYWORD_Methods, this->rcvbuf, this->parser.token_len, 
+                                    KEYWORD_Hash( this->rcvbuf, this->parser.token_len ) );
+  if( this->method_id < 0 )
+    this->method_id = 0;
+          
+  /* get url */
+  error = _http_get_url_from_request( frl, this->rcvbuf );
+  if( error != 0 )
+    return error;
+  
+  /* in case its empty use default URL */
+  if( strlen( frl) == 0 )
+    strcpy( frl, HTTP_DEFAULT_URL_PATH );
+  
+  /* extract url path */
+  path_sep_idx = _http_search_path_index_from_url( frl );
+  strncpy( url_path, this->frl, path_sep_idx );
+  url_path[path_sep_idx] = '\0';
+  
+  /* extract search path */
+  j=0;
+  if( frl[path_sep_idx] == '?' )
+  {
+    for( i=path_sep_idx+1; frl[i] !='\0' && j < HTML_MAX_URL_SIZE; ++i, j++ )
+      search_path[j] = frl[i];
+  }
+  search_path[j]='\0';
+
+  /* get mime type */
+  if( ( value = HTTP_GetKnownHeader( this, HTTP_HDR_MIME_TYPE, NULL ) ) != NULL )
+  {
+    this->mimetyp = _http_get_mime_type_from_string( value );
+  }
+  else 
+  {
+    this->mimetyp = _http_get_mime_type_from_filename( url_path );
+  }
+
+  printf( "URL-PATH: %s\n", url_path );
+  printf( "MIME-TYPE: %s\n", HttpMimeTypeTable[this->mimetyp].txt );
+  printf( "SEARCH-PATH: %s\n", search_path );
+  
+  /* concatenate resource file name */
+  strcpy( frl, this->ht_root_dir );
+  strncat( frl, url_path, frl_size - strlen( this->ht_root_dir ) );
+  frl[frl_size-1]='\0';
+
+  /* get keep-alive state, HTTP/1.1 connections are persistent by default */
+  this->keep_alive = _http_is_version_1_1( this );
+  if( ( value = HTTP_GetKnownHeader( this, HTTP_HDR_CONNECTION, NULL ) ) != NULL )
+  {
+    if( strcasestr( value, "keep-alive" ) )
+      this->keep_alive = true;
+    else if( strcasestr( value, "close" ) )
+      this->keep_alive = false;
+  }
+
+  if( ! this->keep_alive_enabled )
+    this->keep_alive = false;
+
+  /* get content codings accepted by the client */
+  if( ( value = HTTP_GetKnownHeader( this, HTTP_HDR_ACCEPT_ENCODING, NULL ) ) != NULL )
+  {
+    this->accept_encoding = _http_get_accept_encoding( value );
+  }
+
+  return HTTP_OK;
+}
+
+
+/*!
+ *  Open static content file with given name, file type, length and
+ *  modification time are taken from the descriptor.
+ *
+ *  Returns the file descriptor or -1 when there is no regular file
+ */
+static int _http_open_static_file( const char* path, struct stat* file_stat )
+{
+  int fd;
+
+  /* O_NONBLOCK: do not hang on fifos, ignored for regular files */
+  fd = open( path, O_RDONLY | O_NONBLOCK );
+  if( fd < 0 )
+    return -1;
+  
+  /* check for correct file status ( must be ordinary file, no directory ) */
+  if( fstat( fd, file_stat ) != 0 || ! S_ISREG( file_stat->st_mode ) )
+  {
+    close( fd );
+    return -1;
+  }
+
+  return fd;
+}
+
+
+/*!
+ *  Retrieve static content file with given name. The content pack and
+ *  compiled-in files are resolved first, otherwise the file is taken from
+ *  the file cache. It is opened and added to the cache in case of a miss.
+ *
+ *  Returns true when the file exists, it has to be given back by
+ *  _http_release_static_file() then.
+ */
+static int _http_get_static_file( HTTP_OBJ* this, const char* path, HTTP_STATIC_FILE* file )
+{
+  /* path starts with the root directory, pack and ROMFS hold relative paths */
+  const char*         rel_path = path + strlen( this->ht_root_dir );
+  const PACK_ENTRY*   pack_entry;
+  unsigned long       generation = 0;
+  struct stat         file_stat;
+#ifdef HTTP_USE_ROMFS
+  const ROMFS_ENTRY*  rom_entry;
+#endif
+
+  file->data  = NULL;
+  file->entry = NULL;
+  file->pack  = NULL;
+  file->fd    = -1;
+
+  if( this->pack_store != NULL )
+  {
+    file->pack = PACK_Acquire( this->pack_store );
+    pack_entry = PACK_Lookup( file->pack, rel_path );
+    if( pack_entry != NULL )
+    {
+      file->data  = file->pack->map + pack_entry->data_off;
+      file->size  = pack_entry->size;
+      file->mtime = pack_entry->mtime;
+      strcpy( file->etag, pack_entry->etag );
+      return true;
+    }
+
+    PACK_Release( this->pack_store, file->pack );
+    file->pack = NULL;
+  }
+
+#ifdef HTTP_USE_ROMFS
+  rom_entry = ROMFS_Lookup( rel_path );
+  if( rom_entry != NULL )
+  {
+    file->data  = rom_entry->data;
+    file->size  = rom_entry->size;
+    file->mtime = rom_entry->mtime;
+    strncpy( file->etag, rom_entry->etag, HTTP_MAX_ETAG_LEN );
+    file->etag[HTTP_MAX_ETAG_LEN-1] = '\0';
+    return true;
+  }
+#endif /* #ifdef HTTP_USE_ROMFS */
+
+  if( this->file_cache != NULL )
+  {
+    file->entry = FILECACHE_Lookup( this->file_cache, path, & generation );
+    if( file->entry != NULL && file->entry->missing )
+    {
+      /* looked up recently, no need to ask the file system again */
+      FILECACHE_Unref( this->file_cache, file->entry );
+      file->entry = NULL;
+      return false;
+    }
+
+    if( file->entry != NULL )
+    {
+      file_stat.st_size  = file->entry->size;
+      file_stat.st_mtime = file->entry->mtime;
+      file_stat.st_ino   = file->entry->ino;
+    }
+  }
+
+  if( file->entry == NULL )
+  {
+    file->fd = _http_open_static_file( path, & file_stat );
+    if( file->fd < 0 )
+    {
+      if( this->file_cache != NULL )
+        FILECACHE_InsertMissing( this->file_cache, path, generation );
+      return false;
+    }
+
+    if( this->file_cache != NULL )
+    {
+      file->entry = FILECACHE_Insert( this->file_cache, path, file->fd, & file_stat, generation );
+      if( file->entry != NULL )
+      {
+        close( file->fd );
+        file->fd = -1;
+      }
+    }
+  }
+
+  if( file->entry != NULL )
+    file->data = file->entry->data;
+
+  /* strong entity tag, a precompressed sibling is a file of its own */
+  file->size  = file_stat.st_size;
+  file->mtime = file_stat.st_mtime;
+  snprintf( file->etag, HTTP_MAX_ETAG_LEN, "\"%lx-%lx-%lx\"", 
+    (unsigned long) file_stat.st_ino, (unsigned long) file_stat.st_size, (unsigned long) file_stat.st_mtime );
+
+  return true;
+}
+
+
+/*!
+ *  release static content file retrieved by _http_get_static_file()
+ */
+static void _http_release_static_file( HTTP_OBJ* this, HTTP_STATIC_FILE* file )
+{
+  if( file->entry != NULL )
+    FILECACHE_Unref( this->file_cache, file->entry );
+  else if( file->pack != NULL )
+    PACK_Release( this->pack_store, file->pack );
+  else if( file->fd >= 0 )
+    close( file->fd );
+
+  file->data  = NULL;
+  file->entry = NULL;
+  file->pack  = NULL;
+  file->fd    = -1;
+}
+
+
+/*!
+ *  Retrieve static content for the current request. A precompressed 
+ *  sibling ( e.g. script.js.gz ) is delivered instead when the client
+ *  accepts its coding and it is not older than the original file.
+ *
+ *  Returns the same as _http_get_static_file(), content_len, 
+ *  content_encoding and the validators are set accordingly.
+ */
+static int _http_get_static_content( HTTP_OBJ* this, HTTP_STATIC_FILE* file )
+{
+  char              path[HTML_MAX_URL_SIZE + HTML_MAX_PATH_LEN + 4];
+  const char*       ext;
+  HTTP_STATIC_FILE  sibling;
+  int               i;
+
+  if( this->frl == NULL || ! _http_get_static_file( this, this->frl, file ) )
+    return false;
+
+  for( i = 0; i < HttpPrecompressedExtTableSize && this->accept_encoding != 0; ++i )
+  {
+    ext = HttpPrecompressedExtTable[i].txt;
+    if( ! ( this->accept_encoding & HTTP_ENCODING_MASK( HttpPrecompressedExtTable[i].id ) ) || 
+        strlen( this->frl ) + strlen( ext ) >= sizeof( path ) )
+      continue;
+
+    strcpy( path, this->frl );
+    strcat( path, ext );
+    if( ! _http_get_static_file( this, path, & sibling ) )
+      continue;
+
+    /* original file has been modified after compression */
+    if( sibling.mtime < file->mtime )
+    {
+      _http_release_static_file( this, & sibling );
+      continue;
+    }
+
+    _http_release_static_file( this, file );
+    *file = sibling;
+    this->content_encoding  = HttpPrecompressedExtTable[i].id;
+    this->vary_encoding     = true;
+    break;
+  }
+
+  strcpy( this->etag, file->etag );
+  this->last_modified = file->mtime;
+  this->content_len   = file->size;
+
+  return true;
+}
+
+
+/*!
+ *  Queue pre-serialized response for static content which does not exist
+ */
+static int _http_send_not_found( HTTP_OBJ* this )
+{
+  const char* response = this->keep_alive ? HttpNotFoundKeepAlive : HttpNotFoundClose;
+  const int   len      = this->keep_alive ? sizeof( HttpNotFoundKeepAlive ) - 1 : sizeof( HttpNotFoundClose ) - 1;
+
+  if( len > HTTP_SND_BUF_LEN - this->snd_len )
+    return HTTP_BUFFER_OVERRUN;
+
+  memcpy( this->sndbuf + this->snd_len, response, len );
+  this->snd_len += len;
+
+  return HTTP_OK;
+}
+
+
+/*!
+ *  Process HTTP HEAD command (wrapper)
+ */
+static int http_head( HTTP_OBJ* this )
+{
+  int             error = 0;
+  const ROUTER_ROUTE* route;
+  HTTP_STATIC_FILE file;
+  
+  printf("received HEAD command: %s\n", this->rcvbuf );
+    
+  /* check whether CGI handler exists */
+  if( ( route = _find_cgi_handler( this ) ) != NULL )
+  {
+    /* but do not invoke for head method, length of generated content is unknown */
+    this->content_len = -1;
+    error = HTTP_SendHeader( this, HTTP_ACK_OK );
+  }
+  else
+  {
+    /* otherwise check for static content (html, javascript, jpeg, etc) */
+    if( ! _http_get_static_content( this, & file ) )
+    {
+      _http_send_not_found( this );
+      return HTTP_FILE_NOT_FOUND;
+    }
+    _http_release_static_file( this, & file );
+          
+    /* generate header with content length of file unless client's copy is up to date */
+    error = HTTP_SendHeader( this, HTTP_IsNotModified( this ) ? HTTP_ACK_NOT_MODIFIED : HTTP_ACK_OK );
+    if( error < 0 )
+    {
+      return error;
+    }
+  }
+  
+  return error;
+}
+
+
+/*!
+ *  Process HTTP GET command
+ */
+static int http_get( HTTP_OBJ* this )
+{
+  int             error = 0;
+  const ROUTER_ROUTE* route;
+  HTTP_STATIC_FILE file;
+  
+  printf("received GET command: %s\n", this->rcvbuf );
+    
+  /* check whether CGI handler exists */
+  if( ( route = _find_cgi_handler( this ) ) != NULL )
+  {
+    /* and if so invoke it */
+    error = _call_cgi_handler( this, route );
+  }
+  else 
+  {
+    /* otherwise deliver static content (html, javascript, jpeg, etc) */
+    if( ! _http_get_static_content( this, & file ) )
+    {
+      _http_send_not_found( this );
+      return HTTP_FILE_NOT_FOUND;
+    }
+
+    /* client's copy is up to date, only the header is sent */
+    if( HTTP_IsNotModified( this ) )
+    {
+      _http_release_static_file( this, & file );
+      return HTTP_SendHeader( this, HTTP_ACK_NOT_MODIFIED );
+    }
+
+    /* generate header */
+    error = HTTP_SendHeader( this, HTTP_ACK_OK );
+    if( error < 0 )
+    {
+      _http_release_static_file( this, & file );
+      return error;
+    }
+
+    if( file.data != NULL )
+    {
+      if( this->content_len <= HTTP_SND_BUF_LEN - this->snd_len )
+      {
+        /* small files are sent together with the header in one go */
+        memcpy( this->sndbuf + this->snd_len, file.data, this->content_len );
+        this->snd_len += this->content_len;
+        _http_release_static_file( this, & file );
+      }
+      else
+      {
+        /* file is sent by _http_send_pending() straight from the cache, the pack or the ROMFS */
+        this->snd_mem         = file.data;
+        this->snd_cache_entry = file.entry;
+        this->snd_pack        = file.pack;
+        this->snd_file_pos    = 0;
+        this->snd_file_len    = this->content_len;
+      }
+    }
+    else if( this->content_len <= HTTP_SND_BUF_LEN - this->snd_len )
+    {
+      /* small files are sent together with the header in one go */
+      if( read( file.fd, this->sndbuf + this->snd_len, this->content_len ) != this->content_len )
+        error = HTTP_FILE_IO_ERROR;
+      else
+        this->snd_len += this->content_len;
+
+      _http_release_static_file( this, & file );
+    }
+    else
+    {
+      /* file is sent by _http_send_pending() from the descriptor opened above */
+      this->snd_fd        = file.fd;
+      this->snd_file_pos  = 0;
+      this->snd_file_len  = this->content_len;
+      this->snd_sendfile  = true;
+    }
+  }
+  
+  return error;
+}
+
+
+/*!
+ *  Process HTTP POST command
+ */
+static int http_post( HTTP_OBJ* this )
+{
+  const ROUTER_ROUTE* route;
+  int         error = 0;
+   
+  printf("received POST command: %s\n", this->rcvbuf );
+
+  /* check whether CGI handler exists */
+  if( ( route = _find_cgi_handler( this ) ) != NULL )
+  {
+    /* and if so invoke it */
+    error = _call_cgi_handler( this, route );
+  }
+  else 
+  {
+    /* when no handler exists generate page not found error */
+    HTTP_SendHeader( this, HTTP_ACK_NOT_FOUND );
+    error = HTTP_CGI_HANLDER_NOT_FOUND;
+  }
+
+  return error;
+}
+
+
+/*!
+ *  Process HTTP PUT command
+ */
+static int http_put( HTTP_OBJ* this )
+{
+  FILE*           fp;
+  int             bytes_written;
+  int             error = 0;
+  struct stat     file_stat;
+  
+  printf("received PUT command: %s\n", this->rcvbuf );
+    
+  
+  /* otherwise store static content (html, json, etc.) */
+  
+  /* check for correct file status ( must be ordinary file, no directory ) */
+  error = stat( this->frl, & file_stat );
+  if( !error )
+  {
+    if( !( file_stat.st_mode & S_IFREG ) )
+    {
+      HTTP_SendHeader( this, HTTP_ACK_NOT_FOUND );
+      return HTTP_FILE_NOT_FOUND;
+    }
+  }
+  
+
+  /* open and copy static content from file system */
+  fp = fopen( this->frl, "w" );
+  if( fp == NULL )
+  {
+    HTTP_SendHeader( this, HTTP_ACK_NOT_FOUND );
+    return HTTP_FILE_NOT_FOUND;
+  }
+
+  /* write file and save it to servers filesystem */
+  bytes_written = fwrite( this->body_ptr, sizeof(char), this->body_len, fp );
+  fclose( fp );
+  
+  if( bytes_written != this->body_len )
+  {
+    HTTP_SendHeader( this, HTTP_ACK_INTERNAL_ERROR );
+    error = HTTP_FILE_IO_ERROR;
+  }
+  else
+  { 
+    HTTP_SendHeader( this, HTTP_ACK_OK );
+    error = HTTP_OK;
+  }
+  
+  return error;
+}
+
+
+/*!
+ *  Process HTTP DELETE command
+ */
+static int http_delete( HTTP_OBJ* this )
+{
+  /*
+   *  not implemented yet
+   */
+  return HTTP_NOT_IMPLEMENTED_YET;
+}
+
+/*!
+ *  Process HTTP TRACE command
+ */
+static int http_trace( HTTP_OBJ* this )
+{
+  /*
+   *  not implemented yet
+   */
+  return HTTP_NOT_IMPLEMENTED_YET;
+}
+
+/*!
+ *  Process HTTP OPTIONS command
+ */
+static int http_options( HTTP_OBJ* this )
+{
+  /*
+   *  not implemented yet
+   */
+  return HTTP_NOT_IMPLEMENTED_YET;
+}
+
+/*!
+ *  Process HTTP CONNECT command
+ */
+static int http_connect( HTTP_OBJ* this )
+{
+  /*
+   *  not implemented yet
+   */
+  return HTTP_NOT_IMPLEMENTED_YET;
+}
+
+
+/*!
+ *  insert handler into the routes of the http object
+ */
+static int _http_add_route( 
+  HTTP_OBJ* this, 
+  HTTP_CGI_HANDLER handler, 
+  MULTIPART_HANDLER upload_handler, 
+  const int method_id_mask, 
+  const char* url_path,
+  const int exact )
+{
+  int error;
+
+  /* the router matches url paths without leading slash */
+  if( *url_path == '/' )
+    ++url_path;
+
+  error = ROUTER_Add( & this->cgi_router, url_path, method_id_mask, handler, upload_handler, exact );
+  if( error == ROUTER_MALFORMED_PATH )
+    return HTTP_CGI_ROUTE_ERROR;
+  if( error != 0 )
+    return HTTP_TOO_MANY_CGI_HANDLERS;
+  
+  return HTTP_OK;
+}
+
+
+
+/* -- public prototypes ----------------------------------------------------------*/
+
+
+/*******************************************************************************
+ * HTTP_ObjInit() 
+ *                                                                         */ /*!
+ * Initialize main HTTP instance. It keeps a local heap holding persistent
+ * data required for the complete lifetime of a server thread and a local
+ * stack for storing temporary information required for processing one http
+ * request.
+ *                                                                              
+ * Function parameters
+ *     - this:        pointer to HTTP object
+ *     - server_name: server name
+ *     - ht_root_dir: root directory for static web content 
+ *     - port:        port the server is listening to
+ *
+ * Returnparameter
+ *     - R: 0 in case of success, otherwise error code
+ * 
+ *******************************************************************************/
+int HTTP_ObjInit( 
+  HTTP_OBJ*   this, 
+  const char* server_name, 
+  const char* ht_root_dir,
+  const int   port
+)
+{
+  int len = strlen( ht_root_dir );
+
+  /* Initialize object internals */
+  memset( this, 0, sizeof( HTTP_OBJ ) );
+  OBJ_INIT( this );
+  ROUTER_Init( & this->cgi_router );
+  
+  /* initialize components */
+  this->server_name = OBJ_HEAP_ALLOC( strlen( server_name ) + 1 );
+  if( this->server_name == NULL )
+    return HTTP_HEAP_OVERFLOW;
+
+  strcpy( this->server_name, server_name ); 
+  this->socket = -1;
+  this->snd_fd = -1;
+  this->cgi_handler_obj = this;
+  this->cgi_route = NULL;
+  this->upload_route = NULL;
+  this->keep_alive_enabled = HTTP_KEEP_ALIVE;
+
+  /* 2: in case of trailing '/' and '\0' */
+  this->ht_root_dir = OBJ_HEAP_ALLOC( len + 2 ); 
+  if( this->ht_root_dir == NULL )
+    return HTTP_HEAP_OVERFLOW;
+  
+  strcpy( this->ht_root_dir, ht_root_dir );
+  if( this->ht_root_dir[len-1] != '/' )
+    strcpy( & this->ht_root_dir[len], "/" );
+  
+  this->port = port;
+
+  this->rcvbuf = OBJ_HEAP_ALLOC( MAX_HTML_BUF_LEN );
+  if( this->rcvbuf == NULL )
+    return HTTP_HEAP_OVERFLOW;
+
+  this->sndbuf = OBJ_HEAP_ALLOC( HTTP_SND_BUF_LEN );
+  if( this->sndbuf == NULL )
+    return HTTP_HEAP_OVERFLOW;
+    
+  _http_reset_request( this );
+  
+  return HTTP_OK;
+}
+
+
+/*******************************************************************************
+ * HTTP_ObjExit() 
+ *                                                                         */ /*!
+ * Release resources of an HTTP instance which are not kept on its local
+ * heap, i.e. the registered CGI handlers
+ *                                                                              
+ * Function parameters
+ *     - this:        pointer to HTTP object
+ * 
+ *******************************************************************************/
+void HTTP_ObjExit( HTTP_OBJ* this )
+{
+  ROUTER_Exit( & this->cgi_router );
+}
+
+
+/*******************************************************************************
+ * HTTP_ProcessRequest() 
+ *                                                                         */ /*!
+ * Possible HTTP Commands are 
+ *    GET, POST, HEAD, PUT, DELETE, TRACE, OPTIONS, CONNECT.
+ *
+ * Not all of them are implemented currently.
+ *                                                                              
+ * Function parameters
+ *     - this:   pointer to HTTP Object
+ *
+ * Returnparameter
+ *     - R: 0 in case of success, otherwise error code
+ * 
+ *******************************************************************************/
+int HTTP_ProcessRequest( HTTP_OBJ* this )
+{
+  int retcode, error;
+  
+  /* Remember stack frame for later restauration */
+  OBJ_ALLOC_STACK_FRAME( this );
+
+
+  /* read request unless already done by HTTP_ReceiveRequest() */
+  retcode = _http_receive_request( this );
+
+  /* parse header */
+  if( retcode == HTTP_OK )
+    retcode = http_read_header( this );
+  
+  /* invoke HTTP method handler */
+  if( retcode == HTTP_OK )
+  {
+    switch( this->method_id )
+    {
+      case HTTP_GET_ID:
+        retcode = http_get( this );
+        break;
+        
+      case HTTP_POST_ID:
+        retcode = http_post( this );
+        break;
+        
+      case HTTP_HEAD_ID:
+        retcode = http_head( this );
+        break;
+
+      case HTTP_PUT_ID:
+        retcode = http_put( this );
+        break;
+
+      case HTTP_DELETE_ID:
+        retcode = http_delete( this );
+        break;
+
+      case HTTP_TRACE_ID:
+        retcode = http_trace( this );
+        break;
+
+      case HTTP_OPTIONS_ID:
+        retcode = http_options( this );
+        break;
+
+      case HTTP_CONNECT_ID:
+        retcode = http_connect( this );
+        break;
+        
+      default:
+        retcode = HTTP_WRONG_METHOD;
+        break;
+    }
+  }
+  
+  /* in blocking mode transmit the response right away, error responses as well */
+  if( retcode != HTTP_PENDING && ! this->nonblocking )
+  {
+    error = _http_send_pending( this );
+    if( retcode == HTTP_OK )
+      retcode = error;
+  }
+
+  /* be ready for next request, keep pipelined ones unless receiving failed */
+  if( this->req_state == HTTP_REQ_COMPLETE && retcode != HTTP_PENDING )
+    _http_next_request( this );
+  else if( retcode != HTTP_PENDING )
+    _http_reset_request( this );
+
+  /* Check object's memory and release stack frame */
+  OBJ_CHECK( this );
+  OBJ_RELEASE_STACK_FRAME( this );
+  
+  return( retcode );
+}
+
+
+/*******************************************************************************
+ * HTTP_AttachSocket() 
+ *                                                                         */ /*!
+ * Assign a new client connection to the HTTP object and reset all request
+ * and transmit states. In non-blocking mode the object never waits for the
+ * socket. HTTP_ReceiveRequest(), HTTP_ProcessRequest() and HTTP_SendPending()
+ * have to be invoked again when the socket becomes ready.
+ *                                                                              
+ * Function parameters
+ *     - this:        pointer to HTTP Object
+ *     - socket:      connected client socket
+ *     - nonblocking: HTTP_IO_BLOCKING, HTTP_IO_NONBLOCKING or HTTP_IO_COMPLETION
+ *
+ *******************************************************************************/
+void HTTP_AttachSocket( HTTP_OBJ* this, const int socket, const int nonblocking )
+{
+  HTTP_DetachSocket( this );
+  
+  this->socket              = socket;
+  this->nonblocking         = nonblocking;
+  this->keep_alive          = false;
+  this->keep_alive_enabled  = HTTP_KEEP_ALIVE;
+}
+
+
+/*******************************************************************************
+ * HTTP_DetachSocket() 
+ *                                                                         */ /*!
+ * Release all resources of a pending response. The socket itself
+ * is not closed, this is left to the caller.
+ *                                                                              
+ * Function parameters
+ *     - this:        pointer to HTTP Object
+ *
+ *******************************************************************************/
+void HTTP_DetachSocket( HTTP_OBJ* this )
+{
+  if( this->snd_fd >= 0 )
+  {
+    close( this->snd_fd );
+    this->snd_fd = -1;
+  }
+
+  _http_release_snd_mem( this );
+  
+  this->snd_len = 0;
+  this->snd_pos = 0;
+  _http_reset_request( this );
+}
+
+
+/*******************************************************************************
+ * HTTP_ReceiveRequest() 
+ *                                                                         */ /*!
+ * Read as many bytes of the current request as available without waiting.
+ * Can be invoked repeatedly until the request has been received completely.
+ *                                                                              
+ * Function parameters
+ *     - this:   pointer to HTTP Object
+ *
+ * Returnparameter
+ *     - R: HTTP_OK when request is complete, HTTP_PENDING when more data
+ *          is required, HTTP_CONNECTION_CLOSED or error code otherwise
+ * 
+ *******************************************************************************/
+int HTTP_ReceiveRequest( HTTP_OBJ* this )
+{
+  return _http_receive_request( this );
+}
+
+
+/*******************************************************************************
+ * HTTP_SendPending() 
+ *                                                                         */ /*!
+ * Continue transmission of the response to the last processed request
+ *                                                                              
+ * Function parameters
+ *     - this:   pointer to HTTP Object
+ *
+ * Returnparameter
+ *     - R: HTTP_OK when the response is transmitted completely, HTTP_PENDING
+ *          when the socket would block, otherwise error code
+ * 
+ *******************************************************************************/
+int HTTP_SendPending( HTTP_OBJ* this )
+{
+  return _http_send_pending( this );
+}
+
+
+/*******************************************************************************
+ * HTTP_GetReceiveBuffer() 
+ *                                                                         */ /*!
+ * Get free space of the receive buffer for completion mode. Received bytes
+ * have to be announced by HTTP_CommitReceived() before HTTP_ReceiveRequest()
+ * is invoked again.
+ *                                                                              
+ * Function parameters
+ *     - this:   pointer to HTTP Object
+ *     - size:   returns number of bytes which can be received
+ *
+ * Returnparameter
+ *     - R: pointer where the next received bytes are to be stored
+ * 
+ *******************************************************************************/
+char* HTTP_GetReceiveBuffer( HTTP_OBJ* this, long* size )
+{
+  /* keep one byte for string termination */
+  *size = MAX_HTML_BUF_LEN - 1 - this->rcv_len;
+  return this->rcvbuf + this->rcv_len;
+}
+
+
+/*******************************************************************************
+ * HTTP_CommitReceived() 
+ *                                                                         */ /*!
+ * Announce bytes stored to the buffer given by HTTP_GetReceiveBuffer()
+ *                                                                              
+ * Function parameters
+ *     - this:   pointer to HTTP Object
+ *     - len:    number of received bytes
+ *
+ *******************************************************************************/
+void HTTP_CommitReceived( HTTP_OBJ* this, const long len )
+{
+  this->rcv_len += len;
+}
+
+
+/*******************************************************************************
+ * HTTP_GetPendingOutput() 
+ *                                                                         */ /*!
+ * Get next segment of the response to be transmitted in completion mode.
+ * The segment remains valid until it is confirmed by HTTP_CommitSent().
+ *                                                                              
+ * Function parameters
+ *     - this:   pointer to HTTP Object
+ *     - out:    returns the segment to transmit
+ *
+ * Returnparameter
+ *     - R: HTTP_PENDING when a segment has to be transmitted, HTTP_OK when
+ *          the response is complete, otherwise error code
+ * 
+ *******************************************************************************/
+int HTTP_GetPendingOutput( HTTP_OBJ* this, HTTP_OUTPUT* out )
+{
+  out->buf    = NULL;
+  out->fd     = -1;
+  out->offset = 0;
+  out->len    = 0;
+  out->more   = false;
+
+  /* static content which cannot be transmitted from its descriptor is copied to the buffer */
+  if( this->snd_pos >= this->snd_len && this->snd_fd >= 0 && ! this->snd_sendfile )
+  {
+    this->snd_pos = 0;
+    this->snd_len = read( this->snd_fd, this->sndbuf, HTTP_SND_BUF_LEN );
+    if( this->snd_len <= 0 )
+    {
+      close( this->snd_fd );
+      this->snd_fd  = -1;
+      this->snd_len = 0;
+    }
+  }
+
+  if( this->snd_pos < this->snd_len )
+  {
+    out->buf  = this->sndbuf + this->snd_pos;
+    out->len  = this->snd_len - this->snd_pos;
+    out->more = ( this->snd_fd >= 0 || this->snd_mem != NULL );
+    return HTTP_PENDING;
+  }
+
+  if( this->snd_mem != NULL )
+  {
+    out->buf  = this->snd_mem + this->snd_file_pos;
+    out->len  = this->snd_file_len - this->snd_file_pos;
+    return HTTP_PENDING;
+  }
+
+  if( this->snd_fd >= 0 )
+  {
+    out->fd     = this->snd_fd;
+    out->offset = this->snd_file_pos;
+    out->len    = this->snd_file_len - this->snd_file_pos;
+    return HTTP_PENDING;
+  }
+
+  /* response complete, next one starts at the beginning of the buffer */
+  this->snd_len = 0;
+  this->snd_pos = 0;
+  return HTTP_OK;
+}
+
+
+/*******************************************************************************
+ * HTTP_CommitSent() 
+ *                                                                         */ /*!
+ * Confirm transmission of bytes of the segment given by HTTP_GetPendingOutput()
+ *                                                                              
+ * Function parameters
+ *     - this:   pointer to HTTP Object
+ *     - len:    number of transmitted bytes
+ *
+ *******************************************************************************/
+void HTTP_CommitSent( HTTP_OBJ* this, const long len )
+{
+  if( this->snd_pos < this->snd_len )
+  {
+    this->snd_pos += len;
+  }
+  else if( this->snd_mem != NULL )
+  {
+    this->snd_file_pos += len;
+    if( this->snd_file_pos >= this->snd_file_len )
+      _http_release_snd_mem( this );
+  }
+  else if( this->snd_fd >= 0 )
+  {
+    this->snd_file_pos += len;
+    if( this->snd_file_pos >= this->snd_file_len )
+    {
+      close( this->snd_fd );
+      this->snd_fd = -1;
+    }
+  }
+}
+
+
+/*******************************************************************************
+ * HTTP_AddCgiHanlder() 
+ *                                                                         */ /*!
+ * Add a CGI handler to a given HTTP object. 
+ *                                                                              
+ * Function parameters
+ *     - this:      pointer to HTTP Object
+ *     - handler:   cgi handler
+ *     - method:    METHOD to trigger handler ( usually HTTP_GET_ID and/or HTTP_POST_ID )
+ *     - url_path:  trigger url, the handler of the longest matching path is served,
+ *                  there is no upper limit of the number of handlers
+ *    
+ * Returnparameter
+ *     - R: 0 in case of success, otherwise error code
+ * 
+ *******************************************************************************/
+int HTTP_AddCgiHanlder( 
+  HTTP_OBJ* this, 
+  HTTP_CGI_HANDLER handler, 
+  const int method_id_mask, 
+  const char* url_path )
+{
+  return HTTP_AddCgiRoute( this, handler, method_id_mask, url_path, false );
+}
+
+
+/*******************************************************************************
+ * HTTP_AddCgiRoute() 
+ *                                                                         */ /*!
+ * Add a CGI handler for a family of URLs to a given HTTP object. Path
+ * parameters like "sensor/{id}/history" match one path segment each
+ * and are retrieved by the handler with HTTP_GetPathParam().
+ * Literal paths take precedence over parameters.
+ *                                                                              
+ * Function parameters
+ *     - this:      pointer to HTTP Object
+ *     - handler:   cgi handler
+ *     - method:    METHOD to trigger handler ( usually HTTP_GET_ID and/or HTTP_POST_ID )
+ *     - url_path:  trigger url with up to ROUTER_MAX_PARAMS parameters, 
+ *                  the leading '/' is optional
+ *     - exact:     when true the handler serves the complete url only, otherwise
+ *                  all urls starting with it like HTTP_AddCgiHanlder()
+ *    
+ * Returnparameter
+ *     - R: 0 in case of success, otherwise error code
+ * 
+ *******************************************************************************/
+int HTTP_AddCgiRoute( 
+  HTTP_OBJ* this, 
+  HTTP_CGI_HANDLER handler, 
+  const int method_id_mask, 
+  const char* url_path,
+  const int exact )
+{
+  return _http_add_route( this, handler, NULL, method_id_mask, url_path, exact );
+}
+
+
+/*******************************************************************************
+ * HTTP_AddUploadRoute() 
+ *                                                                         */ /*!
+ * Add a CGI handler for POST requests whose multipart/form-data body is
+ * not buffered but passed in pieces to a part handler while it is
+ * received. Hence the size of the body is not limited by the receive
+ * buffer. The CGI handler is invoked afterwards to generate the response,
+ * this->upload holds the number of parts and bytes then. Bodies of other
+ * media types are buffered as usual.
+ *                                                                              
+ * Function parameters
+ *     - this:            pointer to HTTP Object
+ *     - handler:         cgi handler
+ *     - upload_handler:  part handler, its first argument is the HTTP object
+ *     - url_path:        trigger url, see HTTP_AddCgiRoute()
+ *     - exact:           when true the handler serves the complete url only
+ *    
+ * Returnparameter
+ *     - R: 0 in case of success, otherwise error code
+ * 
+ *******************************************************************************/
+int HTTP_AddUploadRoute( 
+  HTTP_OBJ* this, 
+  HTTP_CGI_HANDLER handler, 
+  MULTIPART_HANDLER upload_handler, 
+  const char* url_path,
+  const int exact )
+{
+  return _http_add_route( this, handler, upload_handler, HTTP_POST_ID, url_path, exact );
+}
+
+
+/*******************************************************************************
+ * HTTP_ShareCgiHandlers() 
+ *                                                                         */ /*!
+ * Serve requests of an HTTP object with the CGI handlers and cache rules
+ * registered at another object instead of its own ones. This avoids registering 
+ * the handlers for each connection or thread. The owner of the handler 
+ * table must stay alive and must not add handlers anymore as long as 
+ * requests are processed.
+ *                                                                              
+ * Function parameters
+ *     - this:      pointer to HTTP Object
+ *     - owner:     HTTP Object where the CGI handlers are registered
+ *    
+ *******************************************************************************/
+void HTTP_ShareCgiHandlers( HTTP_OBJ* this, const HTTP_OBJ* owner )
+{
+  this->cgi_handler_obj = owner;
+}
+
+
+/*******************************************************************************
+ * HTTP_AddCacheRule() 
+ *                                                                         */ /*!
+ * Add a caching policy to a given HTTP object. Successful responses 
+ * matching the pattern get Cache-Control and Expires headers, the first
+ * matching rule in the order of registration applies. File type rules 
+ * apply to static content only.
+ *                                                                              
+ * Function parameters
+ *     - this:      pointer to HTTP Object
+ *     - pattern:   URL prefix starting with '/' or file type like "*.css"
+ *     - max_age:   seconds the response may be cached by the client
+ *     - immutable: response never changes during max_age, e.g. for
+ *                  fingerprinted file names
+ *    
+ * Returnparameter
+ *     - R: 0 in case of success, otherwise error code
+ * 
+ *******************************************************************************/
+int HTTP_AddCacheRule( HTTP_OBJ* this, const char* pattern, const long max_age, const int immutable )
+{
+  HTTP_CACHE_RULE*  rule;
+
+  /* check for rule table overflow */
+  if( ! ( this->cache_rule_tab_top < HTTP_MAX_CACHE_RULES ) )
+    return HTTP_TOO_MANY_CACHE_RULES;
+
+  if( max_age < 0 )
+    return HTTP_CACHE_RULE_ERROR;
+
+  rule = & this->cache_rule_tab[this->cache_rule_tab_top];
+  rule->max_age     = max_age;
+  rule->immutable   = immutable;
+  rule->url_prefix  = NULL;
+  rule->mimetyp     = HTTP_MIME_UNDEFINED;
+
+  if( pattern[0] == '/' )
+  {
+    /* URL paths are compared without leading '/' */
+    rule->url_prefix = OBJ_HEAP_ALLOC( strlen( pattern ) );
+    if( rule->url_prefix == NULL )
+      return HTTP_HEAP_OVERFLOW;
+    strcpy( rule->url_prefix, pattern + 1 );
+  }
+  else if( strncmp( pattern, "*.", 2 ) == 0 )
+  {
+    /* file types are identified by their mime type */
+    rule->mimetyp = _http_get_mime_type_from_filename( pattern );
+    if( rule->mimetyp == HTTP_MIME_UNDEFINED )
+      return HTTP_CACHE_RULE_ERROR;
+  }
+  else
+    return HTTP_CACHE_RULE_ERROR;
+
+  ++this->cache_rule_tab_top;
+
+  return HTTP_OK;
+}
+
+
+/*******************************************************************************
+ * HTTP_LoadCacheRules() 
+ *                                                                         */ /*!
+ * Add caching policies from a text file. Each line holds a pattern, the
+ * maximum age in seconds and optionally the keyword immutable, separated 
+ * by blanks. Empty lines and lines starting with '#' are ignored:
+ *
+ *    /assets/    31536000    immutable
+ *    *.css       3600
+ *                                                                              
+ * Function parameters
+ *     - this:      pointer to HTTP Object
+ *     - filename:  name of rule file
+ *    
+ * Returnparameter
+ *     - R: 0 in case of success, otherwise error code
+ * 
+ *******************************************************************************/
+int HTTP_LoadCacheRules( HTTP_OBJ* this, const char* filename )
+{
+  char    line[HTML_MAX_URL_SIZE + HTML_MAX_STATLINE];
+  char    pattern[HTML_MAX_URL_SIZE];
+  char    option[HTML_MAX_STATLINE];
+  long    max_age;
+  int     n, line_nr = 0, error = HTTP_OK;
+  FILE*   fp;
+
+  fp = fopen( filename, "r" );
+  if( fp == NULL )
+    return HTTP_FILE_IO_ERROR;
+
+  while( ! error && fgets( line, sizeof( line ), fp ) != NULL )
+  {
+    ++line_nr;
+    n = sscanf( line, "%255s %ld %79s", pattern, & max_age, option );
+    if( n < 1 || pattern[0] == '#' )
+      continue;
+
+    if( n < 2 || ( n == 3 && strcmp( option, "immutable" ) != 0 ) )
+      error = HTTP_CACHE_RULE_ERROR;
+    else
+      error = HTTP_AddCacheRule( this, pattern, max_age, n == 3 );
+
+    if( error )
+      fprintf( stderr, "%s:%d: %s\n", filename, line_nr, HTTP_GetErrorMsg( error ) );
+  }
+
+  fclose( fp );
+
+  return error;
+}
+
+
+/*******************************************************************************
+ * HTTP_SendHeader() 
+ *                                                                         */ /*!
+ * Sends HTTP Header of given HTTP Object 
+ * Content of CGI handlers is compressed when the client accepts gzip or
+ * deflate coding, unless content_len is below HTTP_DEFLATE_MIN_LEN. It
+ * is transmitted in chunks then. Both requires HTTP/1.1.
+ *                                                                              
+ * Function parameters
+ *     - this:      pointer to HTTP Object
+ *     - ack_key:   acknowledge code ( HTTP_ACK_OK, HTTP_ACK_NOT_FOUND, HTTP_ACK_INTERNAL_ERROR )
+ *    
+ * Returnparameter
+ *     - R: 0 in case of success, otherwise error code
+ * 
+ *******************************************************************************/
+int HTTP_SendHeader( HTTP_OBJ* this, HTTP_ACK_KEY ack_key )
+{
+  const char*     p_ack_add_on_str;
+  int             error = HTTP_OK;
+  
+#ifdef HTTP_USE_ZLIB
+  /* compress content generated by CGI handlers */
+  if( ack_key == HTTP_ACK_OK )
+    _http_deflate_start( this );
+#endif
+
+  /* no content, a length would have to match the one of the full response */
+  if( ack_key == HTTP_ACK_NOT_MODIFIED )
+    this->content_len = -1;
+
+  /* caching policy for successful responses */
+  if( ack_key == HTTP_ACK_OK || ack_key == HTTP_ACK_NOT_MODIFIED )
+    this->cache_rule = _http_find_cache_rule( this );
+  else
+    this->cache_rule = NULL;
+
+  /* without content length only closing the connection marks the end of the content */
+  if( this->content_len < 0 && ! this->snd_chunked && this->method_id != HTTP_HEAD_ID && ack_key != HTTP_ACK_NOT_MODIFIED )
+    this->keep_alive = false;
+
+  /* determine whether we put the string "Conneciton:close" in the ack message ( mostly the case for html pages ) */
+  if( this->keep_alive )
+  {
+    p_ack_add_on_str = "Connection: Keep-Alive\r\n";
+  }
+  else
+  {
+     p_ack_add_on_str = "Connection: close\r\n";
+  }
+  
+  /* queue the ack message */
+  error = _http_ack( this, ack_key, HttpMimeTypeTable[this->mimetyp].txt, this->content_len, p_ack_add_on_str );
+  if( error )
+  {
+    return error;
+  }
+     
+  return error;
 }
 
 
+/*******************************************************************************
+ * HTTP_SendContent() 
+ *                                                                         */ /*!
+ * Sends content of a response after its header has been given to
+ * HTTP_SendHeader(). Header and content are collected and transmitted
+ * together, the buffer may be reused as soon as the function returns.
+ * Compressed content is transmitted in chunks, the last one follows when
+ * the CGI handler returns.
+ *                                                                              
+ * Function parameters
+ *     - this:      pointer to HTTP Object
+ *     - buf:       content to transmit
+ *     - len:       number of bytes in buf
+ *    
+ * Returnparameter
+ *     - R: 0 in case of success, otherwise error code
+ * 
+ *******************************************************************************/
+int HTTP_SendContent( HTTP_OBJ* this, const void* buf, const long len )
+{
+#ifdef HTTP_USE_ZLIB
+  if( this->deflate_stream != NULL )
+    return _http_deflate( this, buf, len, Z_NO_FLUSH );
+#endif
 
-/* -- public prototypes ----------------------------------------------------------*/
+  return _http_send_content( this, buf, len );
+}
 
 
 /*******************************************************************************
- * HTTP_ObjInit() 
+ * HTTP_SetValidators() 
  *                                                                         */ /*!
- * Initialize main HTTP instance. It keeps a local heap holding persistent
- * data required for the complete lifetime of a server thread and a local
- * stack for storing temporary information required for processing one http
- * request.
+ * Assign validators to the response of a CGI handler, they are sent with 
+ * its header as ETag and Last-Modified. Has to be invoked before
+ * HTTP_SendHeader(). Static content gets validators from its file.
  *                                                                              
  * Function parameters
- *     - this:        pointer to HTTP object
- *     - server_name: server name
- *     - ht_root_dir: root directory for static web content 
- *     - port:        port the server is listening to
- *
+ *     - this:          pointer to HTTP Object
+ *     - etag:          opaque entity tag without quotes, NULL if none
+ *     - weak:          entity tag is weak, i.e. equal tags indicate 
+ *                      semantically but not byte-wise equal content
+ *     - last_modified: modification time of the content, 0 if unknown
+ *    
  * Returnparameter
- *     - R: 0 in case of success, otherwise error code
+ *     - R: 0 in case of success, HTTP_BUFFER_OVERRUN if etag is too long
  * 
  *******************************************************************************/
-int HTTP_ObjInit( 
-  HTTP_OBJ*   this, 
-  const char* server_name, 
-  const char* ht_root_dir,
-  const int   port
-)
+int HTTP_SetValidators( HTTP_OBJ* this, const char* etag, const int weak, const time_t last_modified )
 {
-  int len = strlen( ht_root_dir );
+  int len;
 
-  /* Initialize object internals */
-  memset( this, 0, sizeof( HTTP_OBJ ) );
-  OBJ_INIT( this );
-  
-  /* initialize components */
-  this->server_name = OBJ_HEAP_ALLOC( strlen( server_name ) + 1 );
-  if( this->server_name == NULL )
-    return HTTP_HEAP_OVERFLOW;
+  this->last_modified = last_modified;
+  this->etag[0]       = '\0';
 
-  strcpy( this->server_name, server_name ); 
-  this->socket = -1;
+  if( etag == NULL )
+    return HTTP_OK;
 
-  /* 2: in case of trailing '/' and '\0' */
-  this->ht_root_dir = OBJ_HEAP_ALLOC( len + 2 ); 
-  if( this->ht_root_dir == NULL )
-    return HTTP_HEAP_OVERFLOW;
-  
-  strcpy( this->ht_root_dir, ht_root_dir );
-  if( this->ht_root_dir[len-1] != '/' )
-    strcpy( & this->ht_root_dir[len], "/" );
-  
-  this->port = port;
+  len = snprintf( this->etag, HTTP_MAX_ETAG_LEN, "%s\"%s\"", weak ? "W/" : "", etag );
+  if( len >= HTTP_MAX_ETAG_LEN )
+  {
+    this->etag[0] = '\0';
+    return HTTP_BUFFER_OVERRUN;
+  }
 
-  this->rcvbuf = OBJ_HEAP_ALLOC( MAX_HTML_BUF_LEN );
-  if( this->rcvbuf == NULL )
-    return HTTP_HEAP_OVERFLOW;
-    
-  
   return HTTP_OK;
 }
 
 
 /*******************************************************************************
- * HTTP_ProcessRequest() 
+ * HTTP_IsNotModified() 
  *                                                                         */ /*!
- * Possible HTTP Commands are 
- *    GET, POST, HEAD, PUT, DELETE, TRACE, OPTIONS, CONNECT.
- *
- * Not all of them are implemented currently.
+ * Evaluate If-None-Match respectively If-Modified-Since of a GET or HEAD 
+ * request against the validators of the response. When the client's copy 
+ * is still valid, the CGI handler should answer by 
+ * HTTP_SendHeader( this, HTTP_ACK_NOT_MODIFIED ) without content.
  *                                                                              
  * Function parameters
- *     - this:   pointer to HTTP Object
- *
+ *     - this:      pointer to HTTP Object
+ *    
  * Returnparameter
- *     - R: 0 in case of success, otherwise error code
+ *     - R: true when the client's copy is up to date, otherwise false
  * 
  *******************************************************************************/
-int HTTP_ProcessRequest( HTTP_OBJ* this )
+int HTTP_IsNotModified( HTTP_OBJ* this )
 {
-  int retcode;
-  
-  /* Remember stack frame for later restauration */
-  OBJ_ALLOC_STACK_FRAME( this );
+  const char* value;
+  time_t      since;
 
+  if( this->method_id != HTTP_GET_ID && this->method_id != HTTP_HEAD_ID )
+    return false;
 
-  /* read and parse header */
-  retcode = http_read_header( this );
-  
-  /* invoke HTTP method handler */
-  if( retcode == HTTP_OK )
+  /* entity tags take precedence over modification time */
+  if( ( value = HTTP_GetKnownHeader( this, HTTP_HDR_IF_NONE_MATCH, NULL ) ) != NULL )
   {
-    switch( this->method_id )
-    {
-      case HTTP_GET_ID:
-        retcode = http_get( this );
-        break;
-        
-      case HTTP_POST_ID:
-        retcode = http_post( this );
-        break;
-        
-      case HTTP_HEAD_ID:
-        retcode = http_head( this );
-        break;
-
-      case HTTP_PUT_ID:
-        retcode = http_put( this );
-        break;
+    return ( this->etag[0] != '\0' && _http_etag_matches( value, this->etag ) );
+  }
 
-      case HTTP_DELETE_ID:
-        retcode = http_delete( this );
-        break;
+  if( this->last_modified != 0 && ( value = HTTP_GetKnownHeader( this, HTTP_HDR_IF_MODIFIED_SINCE, NULL ) ) != NULL )
+  {
+    since = _http_parse_date( value );
+    return ( since != 0 && this->last_modified <= since );
+  }
 
-      case HTTP_TRACE_ID:
-        retcode = http_trace( this );
-        break;
+  return false;
+}
 
-      case HTTP_OPTIONS_ID:
-        retcode = http_options( this );
-        break;
 
-      case HTTP_CONNECT_ID:
-        retcode = http_connect( this );
-        break;
-        
-      default:
-        retcode = HTTP_WRONG_METHOD;
-        break;
+/*******************************************************************************
+ * HTTP_GetHeader() 
+ *                                                                         */ /*!
+ * retrieve value of a header field of the current request. The lookup is
+ * case-insensitive and does not depend on the number of fields.
+ * 
+ * Function parameters
+ *     - this:      pointer to HTTP object
+ *     - name:      field name without colon, e.g. "Content-Length"
+ *     - len:       length of the value is stored here, may be NULL
+ *                                                                                                                                              
+ * Returnparameter
+ *     - R:         trimmed and zero terminated value within the receive buffer,
+ *                  valid until the request is completed, NULL when the request
+ *                  has no such field. The first field is returned for repeated names.
+ * 
+ *******************************************************************************/
+const char* HTTP_GetHeader( const HTTP_OBJ* this, const char* name, int* len )
+{
+  const HTTP_HEADER_TABLE*  tab  = & this->header_tab;
+  const HTTP_HEADER_FIELD*  field;
+  const unsigned int        mask = HTTP_HEADER_INDEX_SIZE - 1;
+  const int                 name_len = strlen( name );
+  const unsigned int        hash = KEYWORD_Hash( name, name_len );
+  unsigned int              slot;
+
+  /* the index has empty slots left, hence the probing terminates */
+  for( slot = hash & mask; tab->index[slot] != 0; slot = ( slot + 1 ) & mask )
+  {
+    field = & tab->field_tab[tab->index[slot] - 1];
+    if( field->hash == hash && field->name_len == name_len &&
+        SCAN_CaseEqual( & this->rcvbuf[field->name_off], name, name_len ) )
+    {
+      if( len != NULL )
+        *len = field->value_len;
+      return & this->rcvbuf[field->value_off];
     }
   }
-  
-  /* Check object's memory and release stack frame */
-  OBJ_CHECK( this );
-  OBJ_RELEASE_STACK_FRAME( this );
-  
-  return( retcode );
+
+  return NULL;
 }
 
 
-/*
- *  helper comparison function for sorting the cgi_hash_tab
- */
-static int _cgi_hash_comp( const void* a, const void* b )
+/*******************************************************************************
+ * HTTP_GetKnownHeader() 
+ *                                                                         */ /*!
+ * retrieve value of a well-known header field of the current request
+ * ( see keywords.def ) by its id, cheaper than HTTP_GetHeader()
+ * 
+ * Function parameters
+ *     - this:      pointer to HTTP object
+ *     - id:        header field, e.g. HTTP_HDR_CONTENT_LENGTH
+ *     - len:       length of the value is stored here, may be NULL
+ *                                                                                                                                              
+ * Returnparameter
+ *     - R:         trimmed and zero terminated value within the receive buffer,
+ *                  NULL when the request has no such field
+ * 
+ *******************************************************************************/
+const char* HTTP_GetKnownHeader( const HTTP_OBJ* this, const HTTP_HDR_ID id, int* len )
 {
-  return strlen( ((HTTP_CGI_HASH *)b)->url_path ) - strlen( ((HTTP_CGI_HASH *)a)->url_path );
+  const HTTP_HEADER_FIELD* field;
+
+  if( this->header_tab.known[id] == 0 )
+    return NULL;
+
+  field = & this->header_tab.field_tab[this->header_tab.known[id] - 1];
+  if( len != NULL )
+    *len = field->value_len;
+
+  return & this->rcvbuf[field->value_off];
 }
 
 
 /*******************************************************************************
- * HTTP_AddCgiHanlder() 
+ * HTTP_GetPathParam() 
  *                                                                         */ /*!
- * Add a CGI handler to a given HTTP object. 
- *                                                                              
+ * retrieve URL path segment matched by a parameter of the route of the 
+ * active CGI handler ( see HTTP_AddCgiRoute() ). Nothing is copied.
+ * 
  * Function parameters
- *     - this:      pointer to HTTP Object
- *     - handler:   cgi handler
- *     - method:    METHOD to trigger handler ( usually HTTP_GET_ID and/or HTTP_POST_ID )
- *     - url_path:  trigger url, more specific search paths are served first
- *    
+ *     - this:      pointer to HTTP object
+ *     - name:      parameter name without braces, e.g. "id"
+ *     - len:       length of the segment is stored here
+ *                                                                                                                                              
  * Returnparameter
- *     - R: 0 in case of success, otherwise error code
+ *     - R:         segment within the URL path of the request, it is NOT zero
+ *                  terminated and valid until the request is completed. NULL
+ *                  when the route has no such parameter.
  * 
  *******************************************************************************/
-int HTTP_AddCgiHanlder( 
-  HTTP_OBJ* this, 
-  HTTP_CGI_HANDLER handler, 
-  const int method_id_mask, 
-  const char* url_path )
+const char* HTTP_GetPathParam( const HTTP_OBJ* this, const char* name, int* len )
 {
-  HTTP_CGI_HASH*  hashPtr;
-  int             handler_id = this->cgi_handler_tab_top;
+  int i;
 
-  /* check for handler table overflow */
-  if( ! ( handler_id < HTTP_MAX_CGI_HANDLERS ) )
-    return HTTP_TOO_MANY_CGI_HANDLERS;
-    
-  /* insert handler into http object */
-  hashPtr = & this->cgi_handler_tab[handler_id];
-  hashPtr->handler        = handler;
-  hashPtr->handler_id     = handler_id;
-  hashPtr->method_id_mask = method_id_mask;
-  hashPtr->url_path       = OBJ_HEAP_ALLOC( strlen( url_path ) + 1 );
-  strcpy( hashPtr->url_path, url_path );
-  ++this->cgi_handler_tab_top;
-  
-  /* sort handler table from most to least specific URL paths */
-  qsort( this->cgi_handler_tab, this->cgi_handler_tab_top, sizeof( HTTP_CGI_HASH ), _cgi_hash_comp );
-  
-  return HTTP_OK;
+  if( this->cgi_route == NULL || ( i = ROUTER_ParamIndex( this->cgi_route, name ) ) < 0 )
+    return NULL;
+
+  *len = this->cgi_param_tab[i].len;
+  return this->cgi_param_tab[i].ptr;
 }
 
 
 /*******************************************************************************
- * HTTP_SendHeader() 
+ * HTTP_GetQuery() 
  *                                                                         */ /*!
- * Sends HTTP Header of given HTTP Object 
- *                                                                              
+ * retrieve fields of the search path of the current request. The search
+ * path is decoded in place when this function is called first, thus
+ * this->search_path does not hold the raw string anymore afterwards.
+ * 
  * Function parameters
- *     - this:      pointer to HTTP Object
- *     - ack_key:   acknowledge code ( HTTP_ACK_OK, HTTP_ACK_NOT_FOUND, HTTP_ACK_INTERNAL_ERROR )
- *    
+ *     - this:      pointer to HTTP object
+ *                                                                                                                                              
  * Returnparameter
- *     - R: 0 in case of success, otherwise error code
+ *     - R:         fields, see FORM_Find(), FORM_Next(), valid until the 
+ *                  request is completed
  * 
  *******************************************************************************/
-int HTTP_SendHeader( HTTP_OBJ* this, HTTP_ACK_KEY ack_key )
+const FORM* HTTP_GetQuery( HTTP_OBJ* this )
 {
-  const char*     p_ack_add_on_str;
-  int             error = HTTP_OK;
-  
-  /* determine whether we put the string "Conneciton:close" in the ack message ( mostly the case for html pages ) */
-  if( this->keep_alive )
-  {
-    p_ack_add_on_str = "Connection: Keep-Alive\r\n";
-  }
-  else
+  if( ! this->query_parsed )
   {
-     p_ack_add_on_str = "Connection: close\r\n";
+    static char no_search_path[1];
+    char*       search_path = ( this->search_path != NULL ) ? this->search_path : no_search_path;
+
+    /* fields beyond FORM_MAX_FIELDS are ignored */
+    FORM_Parse( & this->query, search_path, strlen( search_path ) );
+
+    this->query_parsed = true;
   }
-  
-  /* send the ack message */
-  error = _http_ack( this->socket, ack_key, HttpMimeTypeTable[this->mimetyp].txt, this->content_len, p_ack_add_on_str );
-  if( error )
+
+  return & this->query;
+}
+
+
+/*******************************************************************************
+ * HTTP_GetForm() 
+ *                                                                         */ /*!
+ * retrieve fields of an application/x-www-form-urlencoded body of the 
+ * current request. The body is decoded in place when this function is
+ * called first, thus this->body_ptr does not hold the raw body anymore
+ * afterwards.
+ * 
+ * Function parameters
+ *     - this:      pointer to HTTP object
+ *                                                                                                                                              
+ * Returnparameter
+ *     - R:         fields, see FORM_Find(), FORM_Next(), valid until the 
+ *                  request is completed. NULL when the body is not urlencoded.
+ * 
+ *******************************************************************************/
+const FORM* HTTP_GetForm( HTTP_OBJ* this )
+{
+  const char* value;
+
+  if( ! this->form_parsed )
   {
-    return error;
+    value = HTTP_GetKnownHeader( this, HTTP_HDR_CONTENT_TYPE, NULL );
+    if( value == NULL || _http_get_mime_type_from_string( value ) != HTTP_MIME_APPLICATION_FORM_URLENCODED )
+      return NULL;
+
+    /* the body is terminated by a zero byte, see _http_receive_body() */
+    FORM_Parse( & this->form, this->body_ptr, this->body_len );
+    this->form_parsed = true;
   }
-     
-  return error;
+
+  return & this->form;
+}
+
+
+/*******************************************************************************
+ * HTTP_GetParam() 
+ *                                                                         */ /*!
+ * retrieve value of a parameter of the search path or, if it is not 
+ * given there, of an urlencoded body
+ * 
+ * Function parameters
+ *     - this:      pointer to HTTP object
+ *     - key:       decoded parameter name, case-sensitive
+ *     - len:       length of the value is stored here, may be NULL
+ *                                                                                                                                              
+ * Returnparameter
+ *     - R:         decoded and zero terminated value, NULL when the
+ *                  request has no such parameter
+ * 
+ *******************************************************************************/
+const char* HTTP_GetParam( HTTP_OBJ* this, const char* key, int* len )
+{
+  const FORM* form;
+  const char* value;
+
+  if( ( value = FORM_Get( HTTP_GetQuery( this ), key, len ) ) != NULL )
+    return value;
+
+  if( ( form = HTTP_GetForm( this ) ) != NULL )
+    return FORM_Get( form, key, len );
+
+  return NULL;
 }
 
 
@@ -1320,40 +3381,28 @@ int HTTP_get_value_for_key(
   const long  pbuf_len 
 )
 {
-  int         found = false;
   const int   keylen = strlen( keybuf );
-  long        i, j;
+  const char* line   = pbuf;
+  const char* end    = pbuf + pbuf_len;
+  const char* eol;
   
-  for( i=0; i < pbuf_len - keylen; ++i )
+  /* keys are only compared at the beginning of a line, not within values */
+  while( line != NULL && end - line > keylen )
   {  
-    found = true;
-    for( j=0; j<keylen; ++j )
-    {
-      if( toupper( keybuf[j] ) != toupper( pbuf[i+j] ) )
-      {
-        found = false;
-        break;
-      }
-    }
-    
-    if( found && ( pbuf[i+j]==':' ) ) 
+    if( line[keylen] == ':' && SCAN_CaseEqual( line, keybuf, keylen ) )
     {
-      strncpy( val, & pbuf[i+j+1], max_val_len );
+      strncpy( val, & line[keylen+1], max_val_len );
       val[max_val_len-1] = '\0';
       _http_trim( val, max_val_len );
-      break;
+      return true;
     }
-  }
 
-  if(!found)
-  {
-    val[0]='\0';
-    return false;
+    eol  = memchr( line, '\n', end - line );
+    line = ( eol != NULL ) ? eol + 1 : NULL;
   }
-  else 
-  {
-    return true;
-  }  
+
+  val[0]='\0';
+  return false;
 }
 
 
@@ -11,7 +11,12 @@
 #define _HTTP_H
 
 #include <stdio.h>
+#include <time.h>
 #include "objmem.h"
+#include "filecache.h"
+#include "pack.h"
+#include "router.h"
+#include "form.h"
 
 
 /* -- const definitions -----------------------------------------------------------*/
@@ -35,23 +40,66 @@
 #define MAX_HTML_BUF_LEN            10000
 
 
+/*!
+ *  Size of the transmit buffer, it collects response header
+ *  and small content in order to send them at once
+ */
+#define HTTP_SND_BUF_LEN            4096
+
+
 /*!
  *  Maximum size of memory consumed from one server instance
  */
-#define HTTP_OBJ_SIZE               ( MAX_HTML_BUF_LEN + 2000 )
+#define HTTP_OBJ_SIZE               ( MAX_HTML_BUF_LEN + HTTP_SND_BUF_LEN + 2000 )
+
+
+/*!
+ *  If 1 TCP connections are kept alive, the event loop serves
+ *  idle connections without blocking others
+ */
+#define HTTP_KEEP_ALIVE             1
+
+
+/*!
+ *  Maximum number of header fields of a request, requests with more
+ *  fields are rejected
+ */
+#define HTTP_MAX_HEADER_FIELDS      32
+
+
+/*!
+ *  Number of slots of the header field index, power of two and
+ *  twice the number of fields at least
+ */
+#define HTTP_HEADER_INDEX_SIZE      64
+
+
+/*!
+ *  Maximum allowed cache control rules
+ */
+#define HTTP_MAX_CACHE_RULES        16
+
+
+/*!
+ *  Maximum length of an entity tag including quotes and weak indicator
+ */
+#define HTTP_MAX_ETAG_LEN           64
 
 
 /*!
- *  Maximum allowed CGI handlers
+ *  Responses of CGI handlers with fewer bytes are not compressed
  */
-#define HTTP_MAX_CGI_HANDLERS       20
+#define HTTP_DEFLATE_MIN_LEN        512
 
 
 /*!
- *  If 1 TCP connections are kept alive
- *  requires several server threads for most browsers
+ *  Compression level and memory usage of CGI response compression, 
+ *  each compressed response takes about 2^(window bits + 2) plus 
+ *  2^(mem level + 9) bytes of heap ( 64KB ) while it is generated
  */
-#define HTTP_KEEP_ALIVE             0
+#define HTTP_DEFLATE_LEVEL          6
+#define HTTP_DEFLATE_WINDOW_BITS    13
+#define HTTP_DEFLATE_MEM_LEVEL      6
 
 
 /*!
@@ -80,13 +128,32 @@
 #define HTTP_WRONG_METHOD           (  -8 )   /* http method does not exist */
 #define HTTP_CGI_HANLDER_NOT_FOUND  (  -9 )   /* implementation bug if happens */
 #define HTTP_CGI_EXEC_ERROR         ( -10 )   /* error occured within cgi execution */
-#define HTTP_TOO_MANY_CGI_HANDLERS  ( -11 )   /* only HTTP_MAX_CGI_HANDLERS allowed */
+#define HTTP_TOO_MANY_CGI_HANDLERS  ( -11 )   /* no memory left for further cgi handlers */
 #define HTTP_FILE_NOT_FOUND         ( -12 )   /* static content file like html, jpeg not found */
 #define HTTP_NOT_IMPLEMENTED_YET    ( -13 )   /* http method of other feature not implmented yet */
 #define HTTP_HEADER_ERROR           ( -14 )   /* malfromed http header */
 #define HTTP_POST_DATA_TOO_BIG      ( -15 )   /* too many bytes in post block */
 #define HTTP_POST_IO_ERROR          ( -16 )   /* could not read http post data */
 #define HTTP_FILE_IO_ERROR          ( -17 )   /* error while accessing local file system */
+#define HTTP_TOO_MANY_CACHE_RULES   ( -18 )   /* only HTTP_MAX_CACHE_RULES allowed */
+#define HTTP_CACHE_RULE_ERROR       ( -19 )   /* malformed cache rule */
+#define HTTP_CGI_ROUTE_ERROR        ( -20 )   /* malformed path parameter of cgi handler */
+#define HTTP_UPLOAD_ERROR           ( -21 )   /* malformed multipart body or part handler failed */
+
+
+/*!
+ *  Servers internal status codes for non-blocking operation
+ */
+#define HTTP_PENDING                (   1 )   /* socket would block, resume when it becomes ready */
+#define HTTP_CONNECTION_CLOSED      (   2 )   /* peer has closed the connection */
+
+
+/*!
+ *  Socket i/o modes, see HTTP_AttachSocket()
+ */
+#define HTTP_IO_BLOCKING            0     /* wait until socket i/o has been completed */
+#define HTTP_IO_NONBLOCKING         1     /* return HTTP_PENDING when socket would block */
+#define HTTP_IO_COMPLETION          2     /* socket i/o is done by the caller, e.g. by io_uring */
 
 
 /*!
@@ -111,23 +178,140 @@ typedef enum {
   HTTP_MIME_AUDIO_SPEEX,
   HTTP_MIME_MULTIPART_FORM_DATA,
   HTTP_MIME_MULTIPART_ALTERNATIVE,
+  HTTP_MIME_APPLICATION_FORM_URLENCODED,
 } HTTP_MIME_TYPE;
 
 
+/*!
+ *  HTTP content codings
+ */
+typedef enum {
+  HTTP_ENCODING_IDENTITY,           /* content is not encoded */
+  HTTP_ENCODING_GZIP,               /* gzip file format (RFC 1952) */
+  HTTP_ENCODING_BR,                 /* brotli compressed data format (RFC 7932) */
+  HTTP_ENCODING_DEFLATE             /* zlib data format (RFC 1950) */
+} HTTP_CONTENT_ENCODING;
+
+
+/*!
+ *  Bit of given content coding in accept_encoding mask
+ */
+#define HTTP_ENCODING_MASK( encoding )    ( 1 << (encoding) )
+
+
+/*!
+ *  Well-known header fields, see HTTP_GetKnownHeader()
+ */
+typedef enum {
+#define KEYWORD_HEADER( key, id )   id,
+#include "keywords.def"
+  HTTP_HDR_KNOWN                    /* number of well-known header fields */
+} HTTP_HDR_ID;
+
+
 /*!
  *  HTTP Header status codes
  */
 typedef enum {
   HTTP_ACK_OK,                      /* 200 OK */
   HTTP_ACK_NOT_FOUND,               /* 404 Not Found */
-  HTTP_ACK_INTERNAL_ERROR           /* 500 Internal Server Error */
+  HTTP_ACK_INTERNAL_ERROR,          /* 500 Internal Server Error */
+  HTTP_ACK_NOT_MODIFIED             /* 304 Not Modified */
 } HTTP_ACK_KEY;
 
+
+/*!
+ *  Receive states of a request, allows to resume
+ *  reading when a non-blocking socket runs dry
+ */
+typedef enum {
+  HTTP_REQ_HEADER,                  /* waiting for end of header */
+  HTTP_REQ_BODY,                    /* waiting for Content-Length bytes of body */
+  HTTP_REQ_COMPLETE                 /* request completely received */
+} HTTP_REQ_STATE;
+
+
+/*!
+ *  States of the incremental header parser, parsing
+ *  can stop at any byte and resume when more data arrives
+ */
+typedef enum {
+  HTTP_PARSE_REQ_START,             /* skip empty lines preceding the request line */
+  HTTP_PARSE_METHOD,                /* request method token */
+  HTTP_PARSE_URI,                   /* request URI */
+  HTTP_PARSE_VERSION,               /* protocol version */
+  HTTP_PARSE_LINE_LF,               /* LF expected after CR of a header line */
+  HTTP_PARSE_FIELD_START,           /* begin of a header field line or empty line */
+  HTTP_PARSE_FIELD_NAME,            /* header field name */
+  HTTP_PARSE_FIELD_VALUE,           /* header field value */
+  HTTP_PARSE_END_LF,                /* LF expected after CR of the empty line */
+  HTTP_PARSE_DONE                   /* end of header found */
+} HTTP_PARSE_STATE;
+
+
+/*!
+ *  Incremental header parser 
+ */
+typedef struct 
+{
+  int   state;                      /* HTTP_PARSE_STATE */
+  int   pos;                        /* number of bytes of rcvbuf already parsed */
+  int   token_len;                  /* length of the token being parsed */
+  int   eol;                        /* position of the last line termination */
+  int   name_pos;                   /* position of the header field name being parsed */
+  int   value_pos;                  /* position behind the colon of the field being parsed, -1 if none */
+  unsigned int hash;                /* case-folded hash of the field name being parsed */
+} HTTP_PARSER;
+
+
+/*!
+ *  Header field, offsets refer to the beginning of rcvbuf. The value is
+ *  trimmed and zero terminated in place.
+ */
+typedef struct
+{
+  unsigned short  name_off;
+  unsigned short  name_len;
+  unsigned short  value_off;
+  unsigned short  value_len;
+  unsigned int    hash;             /* case-folded hash of the name */
+} HTTP_HEADER_FIELD;
+
+
+/*!
+ *  Header fields of the current request, built by the parser in the same
+ *  pass which finds the end of header. The index maps the hash of a name
+ *  to its first field plus one, 0 denotes an empty slot. Collisions are
+ *  resolved by linear probing. Well-known fields are found without hashing
+ *  their names again.
+ */
+typedef struct
+{
+  HTTP_HEADER_FIELD field_tab[HTTP_MAX_HEADER_FIELDS];
+  int               nr_fields;
+  unsigned char     index[HTTP_HEADER_INDEX_SIZE];
+  unsigned char     known[HTTP_HDR_KNOWN];  /* first field of each HTTP_HDR_ID plus one, 0 if none */
+} HTTP_HEADER_TABLE;
+
   
   
 /* -- public types    -----------------------------------------------------------*/
 
 
+/*!
+ *  Next segment of a pending response, see HTTP_GetPendingOutput()
+ */
+typedef struct
+{
+  const char* buf;      /* bytes to transmit, NULL when they are taken from fd */
+  int         fd;       /* static content file, -1 when bytes are taken from buf */
+  long        offset;   /* file position of first byte to transmit */
+  long        len;      /* number of bytes to transmit */
+  int         more;     /* further segments follow */
+} HTTP_OUTPUT;
+
+
+
 /*!
  *  CGI callback handler
  *
@@ -145,15 +329,15 @@ typedef int (* HTTP_CGI_HANDLER)( struct _HTTP_OBJ* this );
 
 
 /*
- *  hash type for CGI handlers
+ *  caching policy for responses matching an URL prefix or a file type
  */
-typedef struct 
+typedef struct
 {
-  int               handler_id;
-  int               method_id_mask;
-  char*             url_path;
-  HTTP_CGI_HANDLER  handler;
-} HTTP_CGI_HASH;
+  char*   url_prefix;       /* URL path prefix without leading '/', NULL if file type rule */
+  int     mimetyp;          /* mime type of file type rule ( HTTP_MIME_TYPE ) */
+  long    max_age;          /* seconds the response may be cached by the client */
+  int     immutable;        /* response never changes during max_age when not zero */
+} HTTP_CACHE_RULE;
 
 
 /*!
@@ -169,23 +353,71 @@ typedef struct _HTTP_OBJ
   char* body_ptr;       /* pointer to http body */
   int   header_len;     /* length of the http request header */
   int   body_len;       /* length of the http request body */
-  long  content_len;    /* lenght of content which is sent back to server */
+  int   body_fed;       /* number of body bytes passed to the parser of upload_route */
+  long  content_len;    /* lenght of content which is sent back to server, -1 if unknown */
   int   mimetyp;        /* mime typ */
   // int   disconnect;     /* disconnect request if not zero */
   char* ht_root_dir;    /* root directory for static web content */
+  int   keep_alive_enabled; /* connection may be kept alive after the next response, HTTP_KEEP_ALIVE by default */
+  FILECACHE* file_cache;  /* in-memory cache for static content, may be shared between objects, NULL if none */
+  PACK_STORE* pack_store; /* content pack resolved before the file system, may be shared between objects, NULL if none */
   
   /* private temporary data */
   int   method_id;      /* http method ID */
   char* url_path;       /* first part of the URL */
   char* search_path;    /* search path of the URL (separated by ?) */
   char* frl;            /* absolute path within local file system for given url */
-  int   keep_alive;     /* set to 1 when header key Connection: keep-alive given and macro HTTP_KEEP_ALIVE is true */
-  
+  int   keep_alive;     /* set to 1 for HTTP/1.1 requests or Connection: keep-alive if keep_alive_enabled is true */
+  int   accept_encoding;  /* content codings accepted by the client, mask of HTTP_ENCODING_MASK() bits */
+  int   content_encoding; /* content coding of the response ( HTTP_CONTENT_ENCODING ) */
+  int   vary_encoding;    /* response depends on Accept-Encoding when not zero */
+  int   cgi_active;       /* set while a CGI handler generates the response */
+  const ROUTER_ROUTE* cgi_route; /* route of the active CGI handler, NULL if none */
+  ROUTER_PARAM cgi_param_tab[ROUTER_MAX_PARAMS]; /* path parameters of cgi_route, see HTTP_GetPathParam() */
+  int   query_parsed;     /* query holds the fields of search_path when not zero */
+  int   form_parsed;      /* form holds the fields of the body when not zero */
+  FORM  query;            /* decoded search path, see HTTP_GetQuery() */
+  FORM  form;             /* decoded urlencoded body, see HTTP_GetForm() */
+  const ROUTER_ROUTE* upload_route; /* route receiving the body in pieces, NULL if the body is buffered */
+  MULTIPART_PARSER upload; /* parser of the body for upload_route */
+  char  etag[HTTP_MAX_ETAG_LEN]; /* entity tag of the response, empty if none */
+  time_t last_modified;   /* modification time of the response, 0 if unknown */
+  const HTTP_CACHE_RULE* cache_rule; /* caching policy of the response, NULL if none */
+  int   snd_chunked;      /* content is transmitted in chunks when not zero */
+  struct z_stream_s* deflate_stream; /* compressor of CGI response, NULL if not compressed */
+
+  /* connection state, kept across calls when served from an event loop */
+  int   nonblocking;    /* socket i/o mode, HTTP_IO_BLOCKING, HTTP_IO_NONBLOCKING or HTTP_IO_COMPLETION */
+  int   req_state;      /* receive state of current request ( HTTP_REQ_STATE ) */
+  int   rcv_len;        /* number of bytes received so far for current and pipelined requests */
+  int   req_end;        /* offset of the first byte behind the complete request within rcvbuf */
+  char  rcv_next_char;  /* first byte behind the request, replaced by the string termination of the body */
+  HTTP_PARSER parser;   /* state of the incremental header parser */
+  HTTP_HEADER_TABLE header_tab; /* header fields of the current request, see HTTP_GetHeader() */
+  int   snd_fd;         /* static content which still has to be transmitted, -1 if none */
+  long  snd_file_pos;   /* position of next byte of snd_fd or snd_mem to transmit */
+  long  snd_file_len;   /* total number of bytes of snd_fd or snd_mem to transmit */
+  int   snd_sendfile;   /* transmit snd_fd by sendfile when not zero */
+  const char* snd_mem;  /* static content in memory which still has to be transmitted, NULL if none */
+  FILECACHE_ENTRY* snd_cache_entry; /* cache entry holding snd_mem, NULL if none */
+  PACK* snd_pack;       /* content pack holding snd_mem, NULL if none */
+  char* snd_queue;      /* CGI content exceeding sndbuf in nonblocking mode, transmitted as snd_mem, NULL if none */
+  long  snd_queue_size; /* number of bytes allocated for snd_queue */
+  char* sndbuf;         /* transmit buffer for header and content */
+  int   snd_len;        /* number of valid bytes in sndbuf */
+  int   snd_pos;        /* number of bytes of sndbuf already transmitted */
   
   
-  /* cgi handler table, handlers with more specific search paths are served first */
-  HTTP_CGI_HASH    cgi_handler_tab[HTTP_MAX_CGI_HANDLERS];
-  int              cgi_handler_tab_top;
+  /* cgi handler routes, handlers with more specific search paths are served first */
+  ROUTER           cgi_router;
+
+  /* caching policy, the first matching rule applies */
+  HTTP_CACHE_RULE  cache_rule_tab[HTTP_MAX_CACHE_RULES];
+  int              cache_rule_tab_top;
+
+  /* object whose cgi handler and cache rule tables are used, itself by default. They are only read
+     while processing requests, hence they can be shared between objects of several threads */
+  const struct _HTTP_OBJ* cgi_handler_obj;
   
   /*
    * declare local memory management struct members with 
@@ -234,6 +466,19 @@ int HTTP_ObjInit(
 );
 
 
+/*******************************************************************************
+ * HTTP_ObjExit() 
+ *                                                                         */ /*!
+ * Release resources of an HTTP instance which are not kept on its local
+ * heap, i.e. the registered CGI handlers
+ *                                                                              
+ * Function parameters
+ *     - this:        pointer to HTTP object
+ * 
+ *******************************************************************************/
+void HTTP_ObjExit( HTTP_OBJ* this );
+
+
 /*******************************************************************************
  * HTTP_ProcessRequest() 
  *                                                                         */ /*!
@@ -241,6 +486,15 @@ int HTTP_ObjInit(
  *    GET, POST, HEAD, PUT, DELETE, TRACE, OPTIONS, CONNECT.
  *
  * Not all of them are implemented currently.
+ *
+ * In blocking mode the request is received and the response is transmitted
+ * completely. In non-blocking mode the request must have been received by
+ * HTTP_ReceiveRequest() before, the response is transmitted by HTTP_SendPending().
+ *
+ * Bytes of further requests pipelined by the client are kept in the receive
+ * buffer. They are served by the next invocation, which has to take place 
+ * after the current response has been transmitted in order to keep the
+ * sequence of responses.
  *                                                                              
  * Function parameters
  *     - this:   pointer to HTTP Object
@@ -252,6 +506,135 @@ int HTTP_ObjInit(
 int HTTP_ProcessRequest( HTTP_OBJ* this );
 
 
+/*******************************************************************************
+ * HTTP_AttachSocket() 
+ *                                                                         */ /*!
+ * Assign a new client connection to the HTTP object and reset all request
+ * and transmit states. In non-blocking mode the object never waits for the
+ * socket. HTTP_ReceiveRequest(), HTTP_ProcessRequest() and HTTP_SendPending()
+ * have to be invoked again when the socket becomes ready.
+ *
+ * In completion mode the request is not read from the socket, the caller
+ * receives it with the help of HTTP_GetReceiveBuffer() instead. The response
+ * is transmitted by the caller as described by HTTP_GetPendingOutput().
+ *                                                                              
+ * Function parameters
+ *     - this:        pointer to HTTP Object
+ *     - socket:      connected client socket
+ *     - nonblocking: HTTP_IO_BLOCKING, HTTP_IO_NONBLOCKING or HTTP_IO_COMPLETION
+ *
+ *******************************************************************************/
+void HTTP_AttachSocket( HTTP_OBJ* this, const int socket, const int nonblocking );
+
+
+/*******************************************************************************
+ * HTTP_DetachSocket() 
+ *                                                                         */ /*!
+ * Release all resources of a pending response. The socket itself
+ * is not closed, this is left to the caller.
+ *                                                                              
+ * Function parameters
+ *     - this:        pointer to HTTP Object
+ *
+ *******************************************************************************/
+void HTTP_DetachSocket( HTTP_OBJ* this );
+
+
+/*******************************************************************************
+ * HTTP_ReceiveRequest() 
+ *                                                                         */ /*!
+ * Read as many bytes of the current request as available without waiting.
+ * Can be invoked repeatedly until the request has been received completely.
+ *                                                                              
+ * Function parameters
+ *     - this:   pointer to HTTP Object
+ *
+ * Returnparameter
+ *     - R: HTTP_OK when request is complete, HTTP_PENDING when more data
+ *          is required, HTTP_CONNECTION_CLOSED or error code otherwise
+ * 
+ *******************************************************************************/
+int HTTP_ReceiveRequest( HTTP_OBJ* this );
+
+
+/*******************************************************************************
+ * HTTP_SendPending() 
+ *                                                                         */ /*!
+ * Continue transmission of the response to the last processed request
+ *                                                                              
+ * Function parameters
+ *     - this:   pointer to HTTP Object
+ *
+ * Returnparameter
+ *     - R: HTTP_OK when the response is transmitted completely, HTTP_PENDING
+ *          when the socket would block, otherwise error code
+ * 
+ *******************************************************************************/
+int HTTP_SendPending( HTTP_OBJ* this );
+
+
+/*******************************************************************************
+ * HTTP_GetReceiveBuffer() 
+ *                                                                         */ /*!
+ * Get free space of the receive buffer for completion mode. Received bytes
+ * have to be announced by HTTP_CommitReceived() before HTTP_ReceiveRequest()
+ * is invoked again.
+ *                                                                              
+ * Function parameters
+ *     - this:   pointer to HTTP Object
+ *     - size:   returns number of bytes which can be received
+ *
+ * Returnparameter
+ *     - R: pointer where the next received bytes are to be stored
+ * 
+ *******************************************************************************/
+char* HTTP_GetReceiveBuffer( HTTP_OBJ* this, long* size );
+
+
+/*******************************************************************************
+ * HTTP_CommitReceived() 
+ *                                                                         */ /*!
+ * Announce bytes stored to the buffer given by HTTP_GetReceiveBuffer()
+ *                                                                              
+ * Function parameters
+ *     - this:   pointer to HTTP Object
+ *     - len:    number of received bytes
+ *
+ *******************************************************************************/
+void HTTP_CommitReceived( HTTP_OBJ* this, const long len );
+
+
+/*******************************************************************************
+ * HTTP_GetPendingOutput() 
+ *                                                                         */ /*!
+ * Get next segment of the response to be transmitted in completion mode.
+ * The segment remains valid until it is confirmed by HTTP_CommitSent().
+ *                                                                              
+ * Function parameters
+ *     - this:   pointer to HTTP Object
+ *     - out:    returns the segment to transmit
+ *
+ * Returnparameter
+ *     - R: HTTP_PENDING when a segment has to be transmitted, HTTP_OK when
+ *          the response is complete, otherwise error code
+ * 
+ *******************************************************************************/
+int HTTP_GetPendingOutput( HTTP_OBJ* this, HTTP_OUTPUT* out );
+
+
+/*******************************************************************************
+ * HTTP_CommitSent() 
+ *                                                                         */ /*!
+ * Confirm transmission of bytes of the segment given by HTTP_GetPendingOutput()
+ *                                                                              
+ * Function parameters
+ *     - this:   pointer to HTTP Object
+ *     - len:    number of transmitted bytes
+ *
+ *******************************************************************************/
+void HTTP_CommitSent( HTTP_OBJ* this, const long len );
+
+
 /*******************************************************************************
  * HTTP_AddCgiHanlder() 
  *                                                                         */ /*!
@@ -261,7 +644,8 @@ int HTTP_ProcessRequest( HTTP_OBJ* this );
  *     - this:      pointer to HTTP Object
  *     - handler:   cgi handler
  *     - method:    METHOD to trigger handler ( usually HTTP_GET_ID and/or HTTP_POST_ID )
- *     - url_path:  trigger url, more specific search paths are served first
+ *     - url_path:  trigger url, the handler of the longest matching path is served,
+ *                  there is no upper limit of the number of handlers
  *    
  * Returnparameter
  *     - R: 0 in case of success, otherwise error code
@@ -274,14 +658,138 @@ int HTTP_AddCgiHanlder(
   const char* url_path );
 
 
+/*******************************************************************************
+ * HTTP_AddCgiRoute() 
+ *                                                                         */ /*!
+ * Add a CGI handler for a family of URLs to a given HTTP object. Path
+ * parameters like "sensor/{id}/history" match one path segment each
+ * and are retrieved by the handler with HTTP_GetPathParam().
+ * Literal paths take precedence over parameters.
+ *                                                                              
+ * Function parameters
+ *     - this:      pointer to HTTP Object
+ *     - handler:   cgi handler
+ *     - method:    METHOD to trigger handler ( usually HTTP_GET_ID and/or HTTP_POST_ID )
+ *     - url_path:  trigger url with up to ROUTER_MAX_PARAMS parameters, 
+ *                  the leading '/' is optional
+ *     - exact:     when true the handler serves the complete url only, otherwise
+ *                  all urls starting with it like HTTP_AddCgiHanlder()
+ *    
+ * Returnparameter
+ *     - R: 0 in case of success, otherwise error code
+ * 
+ *******************************************************************************/
+int HTTP_AddCgiRoute( 
+  HTTP_OBJ* this, 
+  HTTP_CGI_HANDLER handler, 
+  const int method_id_mask, 
+  const char* url_path,
+  const int exact );
+
+
+/*******************************************************************************
+ * HTTP_AddUploadRoute() 
+ *                                                                         */ /*!
+ * Add a CGI handler for POST requests whose multipart/form-data body is
+ * not buffered but passed in pieces to a part handler while it is
+ * received. Hence the size of the body is not limited by the receive
+ * buffer. The CGI handler is invoked afterwards to generate the response,
+ * this->upload holds the number of parts and bytes then. Bodies of other
+ * media types are buffered as usual.
+ *                                                                              
+ * Function parameters
+ *     - this:            pointer to HTTP Object
+ *     - handler:         cgi handler
+ *     - upload_handler:  part handler, its first argument is the HTTP object
+ *     - url_path:        trigger url, see HTTP_AddCgiRoute()
+ *     - exact:           when true the handler serves the complete url only
+ *    
+ * Returnparameter
+ *     - R: 0 in case of success, otherwise error code
+ * 
+ *******************************************************************************/
+int HTTP_AddUploadRoute( 
+  HTTP_OBJ* this, 
+  HTTP_CGI_HANDLER handler, 
+  MULTIPART_HANDLER upload_handler, 
+  const char* url_path,
+  const int exact );
+
+
+/*******************************************************************************
+ * HTTP_ShareCgiHandlers() 
+ *                                                                         */ /*!
+ * Serve requests of an HTTP object with the CGI handlers and cache rules
+ * registered at another object instead of its own ones. This avoids registering 
+ * the handlers for each connection or thread. The owner of the handler 
+ * table must stay alive and must not add handlers anymore as long as 
+ * requests are processed.
+ *                                                                              
+ * Function parameters
+ *     - this:      pointer to HTTP Object
+ *     - owner:     HTTP Object where the CGI handlers are registered
+ *    
+ *******************************************************************************/
+void HTTP_ShareCgiHandlers( HTTP_OBJ* this, const HTTP_OBJ* owner );
+
+
+/*******************************************************************************
+ * HTTP_AddCacheRule() 
+ *                                                                         */ /*!
+ * Add a caching policy to a given HTTP object. Successful responses 
+ * matching the pattern get Cache-Control and Expires headers, the first
+ * matching rule in the order of registration applies. File type rules 
+ * apply to static content only.
+ *                                                                              
+ * Function parameters
+ *     - this:      pointer to HTTP Object
+ *     - pattern:   URL prefix starting with '/' or file type like "*.css"
+ *     - max_age:   seconds the response may be cached by the client
+ *     - immutable: response never changes during max_age, e.g. for
+ *                  fingerprinted file names
+ *    
+ * Returnparameter
+ *     - R: 0 in case of success, otherwise error code
+ * 
+ *******************************************************************************/
+int HTTP_AddCacheRule( HTTP_OBJ* this, const char* pattern, const long max_age, const int immutable );
+
+
+/*******************************************************************************
+ * HTTP_LoadCacheRules() 
+ *                                                                         */ /*!
+ * Add caching policies from a text file. Each line holds a pattern, the
+ * maximum age in seconds and optionally the keyword immutable, separated 
+ * by blanks. Empty lines and lines starting with '#' are ignored:
+ *
+ *    /assets/    31536000    immutable
+ *    *.css       3600
+ *                                                                              
+ * Function parameters
+ *     - this:      pointer to HTTP Object
+ *     - filename:  name of rule file
+ *    
+ * Returnparameter
+ *     - R: 0 in case of success, otherwise error code
+ * 
+ *******************************************************************************/
+int HTTP_LoadCacheRules( HTTP_OBJ* this, const char* filename );
+
+
 /*******************************************************************************
  * HTTP_SendHeader() 
  *                                                                         */ /*!
- * Sends HTTP Header of given HTTP Object 
+ * Sends HTTP Header of given HTTP Object including the empty line
+ * separating it from the content. The header is queued and goes out
+ * together with the content passed to HTTP_SendContent().
+ * Content of CGI handlers is compressed when the client accepts gzip or
+ * deflate coding, unless content_len is below HTTP_DEFLATE_MIN_LEN. It
+ * is transmitted in chunks then. Both requires HTTP/1.1.
  *                                                                              
  * Function parameters
  *     - this:      pointer to HTTP Object
- *     - ack_key:   acknowledge code ( HTTP_ACK_OK, HTTP_ACK_NOT_FOUND, HTTP_ACK_INTERNAL_ERROR )
+ *     - ack_key:   acknowledge code ( HTTP_ACK_OK, HTTP_ACK_NOT_FOUND, HTTP_ACK_INTERNAL_ERROR,
+ *                  HTTP_ACK_NOT_MODIFIED )
  *    
  * Returnparameter
  *     - R: 0 in case of success, otherwise error code
@@ -290,6 +798,181 @@ int HTTP_AddCgiHanlder(
 int HTTP_SendHeader( HTTP_OBJ* this, HTTP_ACK_KEY ack_key );
 
 
+/*******************************************************************************
+ * HTTP_SendContent() 
+ *                                                                         */ /*!
+ * Sends content of a response after its header has been given to
+ * HTTP_SendHeader(). Header and content are collected and transmitted
+ * together, the buffer may be reused as soon as the function returns.
+ * Compressed content is transmitted in chunks, the last one follows when
+ * the CGI handler returns.
+ *                                                                              
+ * Function parameters
+ *     - this:      pointer to HTTP Object
+ *     - buf:       content to transmit
+ *     - len:       number of bytes in buf
+ *    
+ * Returnparameter
+ *     - R: 0 in case of success, otherwise error code
+ * 
+ *******************************************************************************/
+int HTTP_SendContent( HTTP_OBJ* this, const void* buf, const long len );
+
+
+/*******************************************************************************
+ * HTTP_SetValidators() 
+ *                                                                         */ /*!
+ * Assign validators to the response of a CGI handler, they are sent with 
+ * its header as ETag and Last-Modified. Has to be invoked before
+ * HTTP_SendHeader(). Static content gets validators from its file.
+ *                                                                              
+ * Function parameters
+ *     - this:          pointer to HTTP Object
+ *     - etag:          opaque entity tag without quotes, NULL if none
+ *     - weak:          entity tag is weak, i.e. equal tags indicate 
+ *                      semantically but not byte-wise equal content
+ *     - last_modified: modification time of the content, 0 if unknown
+ *    
+ * Returnparameter
+ *     - R: 0 in case of success, HTTP_BUFFER_OVERRUN if etag is too long
+ * 
+ *******************************************************************************/
+int HTTP_SetValidators( HTTP_OBJ* this, const char* etag, const int weak, const time_t last_modified );
+
+
+/*******************************************************************************
+ * HTTP_IsNotModified() 
+ *                                                                         */ /*!
+ * Evaluate If-None-Match respectively If-Modified-Since of a GET or HEAD 
+ * request against the validators of the response. When the client's copy 
+ * is still valid, the CGI handler should answer by 
+ * HTTP_SendHeader( this, HTTP_ACK_NOT_MODIFIED ) without content.
+ *                                                                              
+ * Function parameters
+ *     - this:      pointer to HTTP Object
+ *    
+ * Returnparameter
+ *     - R: true when the client's copy is up to date, otherwise false
+ * 
+ *******************************************************************************/
+int HTTP_IsNotModified( HTTP_OBJ* this );
+
+
+/*******************************************************************************
+ * HTTP_GetHeader() 
+ *                                                                         */ /*!
+ * retrieve value of a header field of the current request. The lookup is
+ * case-insensitive and does not depend on the number of fields.
+ * 
+ * Function parameters
+ *     - this:      pointer to HTTP object
+ *     - name:      field name without colon, e.g. "Content-Length"
+ *     - len:       length of the value is stored here, may be NULL
+ *                                                                                                                                              
+ * Returnparameter
+ *     - R:         trimmed and zero terminated value within the receive buffer,
+ *                  valid until the request is completed, NULL when the request
+ *                  has no such field. The first field is returned for repeated names.
+ * 
+ *******************************************************************************/
+const char* HTTP_GetHeader( const HTTP_OBJ* this, const char* name, int* len );
+
+
+/*******************************************************************************
+ * HTTP_GetKnownHeader() 
+ *                                                                         */ /*!
+ * retrieve value of a well-known header field of the current request
+ * ( see keywords.def ) by its id, cheaper than HTTP_GetHeader()
+ * 
+ * Function parameters
+ *     - this:      pointer to HTTP object
+ *     - id:        header field, e.g. HTTP_HDR_CONTENT_LENGTH
+ *     - len:       length of the value is stored here, may be NULL
+ *                                                                                                                                              
+ * Returnparameter
+ *     - R:         trimmed and zero terminated value within the receive buffer,
+ *                  NULL when the request has no such field
+ * 
+ *******************************************************************************/
+const char* HTTP_GetKnownHeader( const HTTP_OBJ* this, const HTTP_HDR_ID id, int* len );
+
+
+/*******************************************************************************
+ * HTTP_GetPathParam() 
+ *                                                                         */ /*!
+ * retrieve URL path segment matched by a parameter of the route of the 
+ * active CGI handler ( see HTTP_AddCgiRoute() ). Nothing is copied.
+ * 
+ * Function parameters
+ *     - this:      pointer to HTTP object
+ *     - name:      parameter name without braces, e.g. "id"
+ *     - len:       length of the segment is stored here
+ *                                                                                                                                              
+ * Returnparameter
+ *     - R:         segment within the URL path of the request, it is NOT zero
+ *                  terminated and valid until the request is completed. NULL
+ *                  when the route has no such parameter.
+ * 
+ *******************************************************************************/
+const char* HTTP_GetPathParam( const HTTP_OBJ* this, const char* name, int* len );
+
+
+/*******************************************************************************
+ * HTTP_GetQuery() 
+ *                                                                         */ /*!
+ * retrieve fields of the search path of the current request. The search
+ * path is decoded in place when this function is called first, thus
+ * this->search_path does not hold the raw string anymore afterwards.
+ * 
+ * Function parameters
+ *     - this:      pointer to HTTP object
+ *                                                                                                                                              
+ * Returnparameter
+ *     - R:         fields, see FORM_Find(), FORM_Next(), valid until the 
+ *                  request is completed
+ * 
+ *******************************************************************************/
+const FORM* HTTP_GetQuery( HTTP_OBJ* this );
+
+
+/*******************************************************************************
+ * HTTP_GetForm() 
+ *                                                                         */ /*!
+ * retrieve fields of an application/x-www-form-urlencoded body of the 
+ * current request. The body is decoded in place when this function is
+ * called first, thus this->body_ptr does not hold the raw body anymore
+ * afterwards.
+ * 
+ * Function parameters
+ *     - this:      pointer to HTTP object
+ *                                                                                                                                              
+ * Returnparameter
+ *     - R:         fields, see FORM_Find(), FORM_Next(), valid until the 
+ *                  request is completed. NULL when the body is not urlencoded.
+ * 
+ *******************************************************************************/
+const FORM* HTTP_GetForm( HTTP_OBJ* this );
+
+
+/*******************************************************************************
+ * HTTP_GetParam() 
+ *                                                                         */ /*!
+ * retrieve value of a parameter of the search path or, if it is not 
+ * given there, of an urlencoded body
+ * 
+ * Function parameters
+ *     - this:      pointer to HTTP object
+ *     - key:       decoded parameter name, case-sensitive
+ *     - len:       length of the value is stored here, may be NULL
+ *                                                                                                                                              
+ * Returnparameter
+ *     - R:         decoded and zero terminated value, NULL when the
+ *                  request has no such parameter
+ * 
+ *******************************************************************************/
+const char* HTTP_GetParam( HTTP_OBJ* this, const char* key, int* len );
+
+
 /*******************************************************************************
  * HTTP_GetErrorMsg() 
  *                                                                         */ /*!
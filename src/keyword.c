@@ -0,0 +1,51 @@
+/*
+ *  keyword.c
+ *  idefix
+ *
+ *  lookup of protocol keywords ( methods, header names, file extensions,
+ *  media types ) by perfect hash tables which are generated by mkkeywords
+ *  from keywords.def
+ *
+ *  Copyright 2010 GNU General Public Licence. All rights reserved.
+ *
+ */
+
+/* -- includes -------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "keyword.h"
+#include "scan.h"
+
+
+
+/* -- public prototypes ----------------------------------------------------------*/
+
+
+/*******************************************************************************
+ * KEYWORD_Lookup()
+ *                                                                         */ /*!
+ * Retrieve id of a keyword, there is only one slot to compare
+ *
+ * Function parameters
+ *     - table:       keyword table
+ *     - key:         keyword, does not need to be zero terminated
+ *     - len:         length of key
+ *     - hash:        KEYWORD_Hash() of key
+ *
+ * Returnparameter
+ *     - R: id of the keyword, -1 when it is not in the table
+ *
+ *******************************************************************************/
+int KEYWORD_Lookup( const KEYWORD_TABLE* table, const char* key, const long len, const unsigned int hash )
+{
+  const KEYWORD* keyword = & table->slot_tab[KEYWORD_Slot( hash, table->seed, table->bits )];
+
+  if( keyword->key == NULL || keyword->len != len )
+    return -1;
+
+  if( table->case_sensitive ? memcmp( keyword->key, key, len ) != 0 : ! SCAN_CaseEqual( keyword->key, key, len ) )
+    return -1;
+
+  return keyword->id;
+}
@@ -0,0 +1,131 @@
+/*
+ *  keyword.h
+ *  idefix
+ *
+ *  lookup of protocol keywords ( methods, header names, file extensions,
+ *  media types ) by perfect hash tables which are generated by mkkeywords
+ *  from keywords.def
+ *
+ *  Copyright 2010 GNU General Public Licence. All rights reserved.
+ *
+ */
+
+#ifndef _KEYWORD_H
+#define _KEYWORD_H
+
+
+/* -- const definitions -----------------------------------------------------------*/
+
+
+/*!
+ *  Initial value of the case-folded FNV-1a hash of keywords
+ */
+#define KEYWORD_HASH_INIT           2166136261u
+
+
+
+/* -- public types    -----------------------------------------------------------*/
+
+
+/*!
+ *  Slot of a keyword table, key is NULL for empty slots
+ */
+typedef struct
+{
+  const char*           key;
+  int                   len;          /* length of key */
+  int                   id;           /* value assigned to the keyword in keywords.def */
+} KEYWORD;
+
+
+/*!
+ *  Perfect hash table, each keyword has its own slot which is
+ *  found by KEYWORD_Slot() without probing
+ */
+typedef struct
+{
+  const KEYWORD*        slot_tab;     /* 2^bits slots */
+  unsigned int          seed;         /* mixed into the hash, chosen by mkkeywords */
+  unsigned int          bits;
+  int                   case_sensitive; /* compare keys case-sensitive when not zero */
+} KEYWORD_TABLE;
+
+
+
+/* -- public data     -----------------------------------------------------------*/
+
+
+/*!
+ *  Generated keyword tables, one for each class of keywords.def
+ */
+extern const KEYWORD_TABLE  KEYWORD_Methods;
+extern const KEYWORD_TABLE  KEYWORD_Headers;
+extern const KEYWORD_TABLE  KEYWORD_FileExts;
+extern const KEYWORD_TABLE  KEYWORD_MediaTypes;
+
+
+
+/* -- inline functions -----------------------------------------------------------*/
+
+
+/*!
+ *  fold character to lower case and add it to the hash, the header parser
+ *  hashes field names byte by byte while they are received
+ */
+static inline unsigned int KEYWORD_HashStep( unsigned int hash, int c )
+{
+  if( c >= 'A' && c <= 'Z' )
+    c += 'a' - 'A';
+
+  return ( hash ^ c ) * 16777619u;
+}
+
+
+/*!
+ *  case-folded FNV-1a hash of a keyword
+ */
+static inline unsigned int KEYWORD_Hash( const char* key, const long len )
+{
+  unsigned int  hash = KEYWORD_HASH_INIT;
+  long          i;
+
+  for( i = 0; i < len; ++i )
+    hash = KEYWORD_HashStep( hash, (unsigned char) key[i] );
+
+  return hash;
+}
+
+
+/*!
+ *  slot of a hash value within a table of 2^bits slots,
+ *  multiplicative hashing of the hash mixed with the seed
+ */
+static inline unsigned int KEYWORD_Slot( const unsigned int hash, const unsigned int seed, const unsigned int bits )
+{
+  return ( ( hash ^ seed ) * 2654435769u ) >> ( 32 - bits );
+}
+
+
+
+/* -- public prototypes ----------------------------------------------------------*/
+
+
+/*******************************************************************************
+ * KEYWORD_Lookup()
+ *                                                                         */ /*!
+ * Retrieve id of a keyword, there is only one slot to compare
+ *
+ * Function parameters
+ *     - table:       keyword table
+ *     - key:         keyword, does not need to be zero terminated
+ *     - len:         length of key
+ *     - hash:        KEYWORD_Hash() of key
+ *
+ * Returnparameter
+ *     - R: id of the keyword, -1 when it is not in the table
+ *
+ *******************************************************************************/
+int KEYWORD_Lookup( const KEYWORD_TABLE* table, const char* key, const long len, const unsigned int hash );
+
+
+#endif /* #ifndef _KEYWORD_H */
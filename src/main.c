@@ -24,6 +24,42 @@
 #define HTML_SERVER_DEFAULT_PORT    80
 
 
+/*!
+ *  Number of worker threads serving client connections
+ */
+#define HTML_SERVER_DEFAULT_THREADS 1
+
+
+/*!
+ *  Upper limit of worker threads
+ */
+#define HTML_SERVER_MAX_THREADS     64
+
+
+/*!
+ *  Upper limit of worker processes
+ */
+#define HTML_SERVER_MAX_WORKERS     64
+
+
+/*!
+ *  Seconds an idle persistent connection is kept open
+ */
+#define HTML_SERVER_DEFAULT_KEEP_ALIVE_TIME_OUT   15
+
+
+/*!
+ *  Seconds after which a persistent connection is closed following the current response
+ */
+#define HTML_SERVER_DEFAULT_MAX_CONN_TIME         300
+
+
+/*!
+ *  Kilobytes of static content cached in memory
+ */
+#define HTML_SERVER_DEFAULT_CACHE_SIZE            1024
+
+
 /*!
  *  This base directory of all HTML pages
  */
@@ -50,6 +86,32 @@ static void help( void )
   printf("--rootdir\n-r\n");
   printf("\tSpecifies the root directory where static files are searched\n");
   printf("\tfrom. For empty URL's index.html is retrieved per default.\n\n");
+  printf("--threads\n-t\n");
+  printf("\tSpecifies the number of worker threads serving client connections.\n");
+  printf("\tOne thread is used in case nothing is specified.\n\n");
+  printf("--keep-alive\n-k\n");
+  printf("\tSeconds an idle persistent connection is kept open, 15 per default.\n");
+  printf("\t0 closes each connection after the response.\n\n");
+  printf("--max-conn-time\n-m\n");
+  printf("\tSeconds after which a persistent connection is closed following\n");
+  printf("\tthe current response, 300 per default. 0 for unlimited.\n\n");
+  printf("--cache-size\n-c\n");
+  printf("\tKilobytes of static content cached in memory, 1024 per default.\n");
+  printf("\t0 disables the cache.\n\n");
+  printf("--cache-rules\n-e\n");
+  printf("\tFile with caching policies, each line holds an URL prefix like\n");
+  printf("\t/assets/ or a file type like *.css, the max-age in seconds and\n");
+  printf("\toptionally the keyword immutable.\n\n");
+  printf("--pack\n-a\n");
+  printf("\tContent pack generated by mkromfs -p which is served before the\n");
+  printf("\troot directory. SIGHUP swaps in a new version of the file.\n\n");
+  printf("--upload-dir\n-u\n");
+  printf("\tEnables the sample upload route /upload which stores posted files\n");
+  printf("\tin the given directory. It is created when missing and must not be\n");
+  printf("\tlocated within the root directory.\n\n");
+  printf("--workers\n-w\n");
+  printf("\tPre-forks the given number of worker processes, each pinned to\n");
+  printf("\tone core. Without this option the server runs in one process.\n\n");
   printf("--version\n-v\n");
   printf("\tPrints version information.\n\n");
   printf("\t--help\n-h\n");
@@ -75,7 +137,16 @@ static void version( void )
 int main( int argc, char* argv[] )
 {
   char          root_dir[HTML_MAX_PATH_LEN];
+  SOCK_CONFIG   config;
   int           port     = HTML_SERVER_DEFAULT_PORT;
+  int           threads  = HTML_SERVER_DEFAULT_THREADS;
+  int           workers  = 0;
+  int           keep_alive_timeout = HTML_SERVER_DEFAULT_KEEP_ALIVE_TIME_OUT;
+  int           max_conn_time      = HTML_SERVER_DEFAULT_MAX_CONN_TIME;
+  long          cache_size         = HTML_SERVER_DEFAULT_CACHE_SIZE;
+  const char*   cache_rules        = NULL;
+  const char*   pack_file          = NULL;
+  const char*   upload_dir         = NULL;
   int           optindex, optchar, error = 0;
   struct stat   root_dir_stat;
   const struct  option long_options[] = 
@@ -84,6 +155,14 @@ int main( int argc, char* argv[] )
     { "version",  no_argument,        NULL,   'v' },
     { "rootdir",  required_argument,  NULL,   'r' },
     { "port",     required_argument,  NULL,   'p' },
+    { "threads",  required_argument,  NULL,   't' },
+    { "workers",  required_argument,  NULL,   'w' },
+    { "keep-alive",     required_argument,  NULL,   'k' },
+    { "max-conn-time",  required_argument,  NULL,   'm' },
+    { "cache-size",     required_argument,  NULL,   'c' },
+    { "cache-rules",    required_argument,  NULL,   'e' },
+    { "pack",           required_argument,  NULL,   'a' },
+    { "upload-dir",     required_argument,  NULL,   'u' },
     { NULL }
   };
 
@@ -93,7 +172,7 @@ int main( int argc, char* argv[] )
 
   /* setup options */
   strcpy( root_dir, HTML_DEFAULT_ROOT_DIR );
-  while( ( optchar = getopt_long( argc, argv, "hvr:p:", long_options, &optindex ) ) != -1 )
+  while( ( optchar = getopt_long( argc, argv, "hvr:p:t:w:k:m:c:e:a:u:", long_options, &optindex ) ) != -1 )
   {
     switch( optchar )
     {
@@ -116,6 +195,63 @@ int main( int argc, char* argv[] )
         }
         break;
       
+      case 't':
+        threads = atoi( optarg );
+        if( threads < 1 || threads > HTML_SERVER_MAX_THREADS )
+        {
+          fprintf( stderr, "wrong number of threads specified error!\n");
+          return(-1);
+        }
+        break;
+      
+      case 'w':
+        workers = atoi( optarg );
+        if( workers < 1 || workers > HTML_SERVER_MAX_WORKERS )
+        {
+          fprintf( stderr, "wrong number of worker processes specified error!\n");
+          return(-1);
+        }
+        break;
+      
+      case 'k':
+        keep_alive_timeout = atoi( optarg );
+        if( keep_alive_timeout < 0 )
+        {
+          fprintf( stderr, "wrong keep-alive time out specified error!\n");
+          return(-1);
+        }
+        break;
+      
+      case 'm':
+        max_conn_time = atoi( optarg );
+        if( max_conn_time < 0 )
+        {
+          fprintf( stderr, "wrong maximum connection time specified error!\n");
+          return(-1);
+        }
+        break;
+      
+      case 'c':
+        cache_size = atol( optarg );
+        if( cache_size < 0 )
+        {
+          fprintf( stderr, "wrong cache size specified error!\n");
+          return(-1);
+        }
+        break;
+      
+      case 'e':
+        cache_rules = optarg;
+        break;
+      
+      case 'a':
+        pack_file = optarg;
+        break;
+      
+      case 'u':
+        upload_dir = optarg;
+        break;
+      
       case 'r':
         strncpy( root_dir, optarg, HTML_MAX_PATH_LEN );
         root_dir[HTML_MAX_PATH_LEN-1] = '\0';
@@ -140,10 +276,23 @@ int main( int argc, char* argv[] )
   if( !error )
   {
     /* prints basic configuration info */
-    printf("Starting Webserver at port %d and root directory %s ...\n\n", port, root_dir );
+    printf("Starting Webserver at port %d and root directory %s with %d thread(s) ...\n\n", port, root_dir, threads );
     
-    /* start single thread server */
-    error = service_socket_loop( root_dir, port );
+    /* start server */
+    config.ht_root_dir        = root_dir;
+    config.port               = port;
+    config.nr_threads         = threads;
+    config.keep_alive_timeout = keep_alive_timeout;
+    config.max_conn_time      = max_conn_time;
+    config.cache_size         = cache_size * 1024;
+    config.cache_rules        = cache_rules;
+    config.pack_file          = pack_file;
+    config.upload_dir         = upload_dir;
+
+    if( workers > 0 )
+      error = service_worker_processes( &config, workers );
+    else
+      error = service_socket_loop( &config );
   }
 
   return error;
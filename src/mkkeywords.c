@@ -0,0 +1,213 @@
+/*
+ *  mkkeywords.c
+ *  idefix
+ *
+ *  generates the C source of the perfect hash tables of the keywords
+ *  listed in keywords.def ( see keyword.h ). Invocation:
+ *
+ *    mkkeywords > keyword_tab.c
+ *
+ *  Copyright 2010 GNU General Public Licence. All rights reserved.
+ *
+ */
+
+/* -- includes -------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "keyword.h"
+
+
+/* -- const definitions -----------------------------------------------------------*/
+
+
+/*!
+ *  Number of seeds tried until a table is considered impossible
+ */
+#define MKKEYWORDS_MAX_SEEDS        1000000
+
+
+/*!
+ *  Upper limit of the number of slots of a table
+ */
+#define MKKEYWORDS_MAX_BITS         12
+
+
+
+/* -- local types ---------------------------------------------------------------*/
+
+
+/*!
+ *  Keyword of keywords.def, the id is kept as symbol for the generated source
+ */
+typedef struct
+{
+  const char*   key;
+  const char*   id;
+} MKKEYWORDS_KEY;
+
+
+
+/* -- local data -----------------------------------------------------------------*/
+
+
+static const MKKEYWORDS_KEY _mkkeywords_methods[] =
+{
+#define KEYWORD_METHOD( key, id )       { key, #id },
+#include "keywords.def"
+};
+
+
+static const MKKEYWORDS_KEY _mkkeywords_headers[] =
+{
+#define KEYWORD_HEADER( key, id )       { key, #id },
+#include "keywords.def"
+};
+
+
+static const MKKEYWORDS_KEY _mkkeywords_file_exts[] =
+{
+#define KEYWORD_FILE_EXT( key, id )     { key, #id },
+#include "keywords.def"
+};
+
+
+static const MKKEYWORDS_KEY _mkkeywords_media_types[] =
+{
+#define KEYWORD_MEDIA_TYPE( key, id )   { key, #id },
+#include "keywords.def"
+};
+
+
+#define MKKEYWORDS_SIZE( tab )      ( (int) ( sizeof( tab ) / sizeof( MKKEYWORDS_KEY ) ) )
+
+
+
+/* -- local functions -------------------------------------------------------------*/
+
+
+/*!
+ *  search seed which maps each keyword to a slot of its own, returns the seed
+ *  and fills slot_tab with the index of the keyword plus one, 0 if empty
+ */
+static long _mkkeywords_find_seed( const MKKEYWORDS_KEY* key_tab, const int nr_keys, const unsigned int bits, int* slot_tab )
+{
+  unsigned int  slot;
+  long          seed;
+  int           i;
+
+  for( seed = 0; seed < MKKEYWORDS_MAX_SEEDS; ++seed )
+  {
+    memset( slot_tab, 0, ( 1 << bits ) * sizeof( int ) );
+
+    for( i = 0; i < nr_keys; ++i )
+    {
+      slot = KEYWORD_Slot( KEYWORD_Hash( key_tab[i].key, strlen( key_tab[i].key ) ), seed, bits );
+      if( slot_tab[slot] != 0 )
+        break;
+      slot_tab[slot] = i + 1;
+    }
+
+    if( i == nr_keys )
+      return seed;
+  }
+
+  return -1;
+}
+
+
+/*!
+ *  write perfect hash table of one keyword class, the table has at least twice
+ *  as many slots as keywords which lets the seed be found after a few trials
+ */
+static int _mkkeywords_write_table(
+  FILE*                 out,
+  const char*           name,
+  const MKKEYWORDS_KEY* key_tab,
+  const int             nr_keys,
+  const int             case_sensitive
+)
+{
+  int           slot_tab[1 << MKKEYWORDS_MAX_BITS];
+  const char*   key;
+  unsigned int  bits;
+  long          seed;
+  int           i;
+
+  for( i = 0; i < nr_keys; ++i )
+  {
+    if( strpbrk( key_tab[i].key, "\"\\" ) != NULL || key_tab[i].key[0] == '\0' )
+    {
+      fprintf( stderr, "mkkeywords: invalid keyword \"%s\"!\n", key_tab[i].key );
+      return -1;
+    }
+  }
+
+  for( bits = 1; ( 1 << bits ) < 2 * nr_keys; ++bits )
+    ;
+
+  /* grow the table when no seed is found, e.g. for very many keywords */
+  seed = -1;
+  for( ; bits <= MKKEYWORDS_MAX_BITS && seed < 0; ++bits )
+    seed = _mkkeywords_find_seed( key_tab, nr_keys, bits, slot_tab );
+  --bits;
+
+  if( seed < 0 )
+  {
+    fprintf( stderr, "mkkeywords: no perfect hash found for %s, duplicate keyword?\n", name );
+    return -1;
+  }
+
+  fprintf( out, "static const KEYWORD _keyword%sTab[%d] =\n{\n", name, 1 << bits );
+  for( i = 0; i < ( 1 << bits ); ++i )
+  {
+    if( slot_tab[i] == 0 )
+      continue;
+    key = key_tab[slot_tab[i] - 1].key;
+    fprintf( out, "  [%d] = { \"%s\", %d, %s },\n", i, key, (int) strlen( key ), key_tab[slot_tab[i] - 1].id );
+  }
+  fprintf( out, "};\n\n" );
+
+  fprintf( out, "const KEYWORD_TABLE KEYWORD_%s =\n{\n", name );
+  fprintf( out, "  _keyword%sTab, %ldu, %u, %d\n};\n\n\n", name, seed, bits, case_sensitive );
+
+  return 0;
+}
+
+
+
+/* -- main -----------------------------------------------------------------------*/
+
+
+int main( int argc, char* argv[] )
+{
+  int error = 0;
+
+  if( argc != 1 )
+  {
+    fprintf( stderr, "Invocation: %s > keyword_tab.c\n", argv[0] );
+    return -1;
+  }
+
+  printf( "/*\n *  keyword tables generated by mkkeywords from keywords.def, do not edit\n */\n\n" );
+  printf( "#include \"http.h\"\n#include \"keyword.h\"\n\n\n" );
+
+  if( ! error )
+    error = _mkkeywords_write_table( stdout, "Methods", _mkkeywords_methods, MKKEYWORDS_SIZE( _mkkeywords_methods ), 1 );
+  if( ! error )
+    error = _mkkeywords_write_table( stdout, "Headers", _mkkeywords_headers, MKKEYWORDS_SIZE( _mkkeywords_headers ), 0 );
+  if( ! error )
+    error = _mkkeywords_write_table( stdout, "FileExts", _mkkeywords_file_exts, MKKEYWORDS_SIZE( _mkkeywords_file_exts ), 0 );
+  if( ! error )
+    error = _mkkeywords_write_table( stdout, "MediaTypes", _mkkeywords_media_types, MKKEYWORDS_SIZE( _mkkeywords_media_types ), 0 );
+
+  if( ! error && fflush( stdout ) != 0 )
+  {
+    fprintf( stderr, "mkkeywords: write error!\n" );
+    error = -1;
+  }
+
+  return error ? 1 : 0;
+}
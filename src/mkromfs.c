@@ -0,0 +1,433 @@
+/*
+ *  mkromfs.c
+ *  idefix
+ *
+ *  generates the C source of the read-only file system ( see romfs.h )
+ *  respectively a content pack ( see pack.h ) from a directory tree of 
+ *  static content. Invocation:
+ *
+ *    mkromfs <root directory> > romfs_data.c
+ *    mkromfs -p <root directory> > content.pack
+ *
+ *  Copyright 2010 GNU General Public Licence. All rights reserved.
+ *
+ */
+
+/* -- includes -------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "pack.h"
+
+
+/* -- const definitions -----------------------------------------------------------*/
+
+
+/*!
+ *  Maximum length of a file path
+ */
+#define MKROMFS_MAX_PATH_LEN        1024
+
+
+/*!
+ *  Maximum depth of subdirectories of the root directory
+ */
+#define MKROMFS_MAX_DEPTH           8
+
+
+/*!
+ *  Number of content bytes per line of generated source
+ */
+#define MKROMFS_BYTES_PER_LINE      16
+
+
+
+/* -- local types ---------------------------------------------------------------*/
+
+
+/*!
+ *  File found below the root directory
+ */
+typedef struct
+{
+  char*         path;         /* path relative to the root directory */
+  long          size;         /* file length in bytes */
+  time_t        mtime;        /* time of last modification */
+  unsigned long long hash;    /* FNV-1a hash of the content */
+} MKROMFS_FILE;
+
+
+/*!
+ *  All files found below the root directory
+ */
+typedef struct
+{
+  MKROMFS_FILE* file_tab;
+  int           nr_files;
+  int           max_files;
+} MKROMFS_TREE;
+
+
+
+/* -- local functions -------------------------------------------------------------*/
+
+
+/*!
+ *  append file to the tree, returns -1 when out of memory
+ */
+static int _mkromfs_add_file( MKROMFS_TREE* tree, const char* path, const struct stat* file_stat )
+{
+  MKROMFS_FILE* file_tab;
+
+  if( tree->nr_files == tree->max_files )
+  {
+    tree->max_files = tree->max_files ? 2 * tree->max_files : 64;
+    file_tab = realloc( tree->file_tab, tree->max_files * sizeof( MKROMFS_FILE ) );
+    if( file_tab == NULL )
+      return -1;
+    tree->file_tab = file_tab;
+  }
+
+  tree->file_tab[tree->nr_files].path = strdup( path );
+  if( tree->file_tab[tree->nr_files].path == NULL )
+    return -1;
+
+  tree->file_tab[tree->nr_files].size  = file_stat->st_size;
+  tree->file_tab[tree->nr_files].mtime = file_stat->st_mtime;
+  ++tree->nr_files;
+
+  return 0;
+}
+
+
+/*!
+ *  collect regular files of the given subdirectory ( relative path, empty
+ *  for the root directory ) recursively, hidden files are skipped
+ */
+static int _mkromfs_scan_dir( MKROMFS_TREE* tree, const char* root_dir, const char* subdir, const int depth )
+{
+  char            path[MKROMFS_MAX_PATH_LEN];
+  char            rel_path[MKROMFS_MAX_PATH_LEN];
+  DIR*            dir;
+  struct dirent*  dir_entry;
+  struct stat     file_stat;
+  int             error = 0;
+
+  snprintf( path, sizeof( path ), "%s/%s", root_dir, subdir );
+  dir = opendir( path );
+  if( dir == NULL )
+  {
+    fprintf( stderr, "mkromfs: cannot open directory %s\n", path );
+    return -1;
+  }
+
+  while( ! error && ( dir_entry = readdir( dir ) ) != NULL )
+  {
+    if( dir_entry->d_name[0] == '.' )
+      continue;
+
+    if( (unsigned) snprintf( rel_path, sizeof( rel_path ), "%s%s", subdir, dir_entry->d_name ) >= sizeof( rel_path ) ||
+        (unsigned) snprintf( path, sizeof( path ), "%s/%s", root_dir, rel_path ) >= sizeof( path ) )
+    {
+      fprintf( stderr, "mkromfs: path %s/%s too long\n", root_dir, rel_path );
+      error = -1;
+    }
+    else if( stat( path, & file_stat ) != 0 )
+    {
+      fprintf( stderr, "mkromfs: cannot access %s\n", path );
+      error = -1;
+    }
+    else if( S_ISDIR( file_stat.st_mode ) )
+    {
+      if( depth < MKROMFS_MAX_DEPTH && strlen( rel_path ) + 1 < sizeof( rel_path ) )
+      {
+        strcat( rel_path, "/" );
+        error = _mkromfs_scan_dir( tree, root_dir, rel_path, depth + 1 );
+      }
+    }
+    else if( S_ISREG( file_stat.st_mode ) )
+    {
+      error = _mkromfs_add_file( tree, rel_path, & file_stat );
+      if( error )
+        fprintf( stderr, "mkromfs: out of memory error!\n" );
+    }
+  }
+
+  closedir( dir );
+  return error;
+}
+
+
+/*!
+ *  order of the index, has to match the binary search of ROMFS_Lookup()
+ */
+static int _mkromfs_comp( const void* a, const void* b )
+{
+  return strcmp( ( (const MKROMFS_FILE*) a )->path, ( (const MKROMFS_FILE*) b )->path );
+}
+
+
+/*!
+ *  write string as C string literal
+ */
+static void _mkromfs_write_string( FILE* out, const char* string )
+{
+  fputc( '"', out );
+  for( ; *string; ++string )
+  {
+    if( *string == '"' || *string == '\\' )
+      fputc( '\\', out );
+    fputc( *string, out );
+  }
+  fputc( '"', out );
+}
+
+
+/*!
+ *  read content of given file, returns NULL in case of error
+ */
+static char* _mkromfs_read_file( const char* root_dir, const MKROMFS_FILE* file )
+{
+  char  path[MKROMFS_MAX_PATH_LEN];
+  char* data;
+  FILE* in;
+  long  n;
+
+  snprintf( path, sizeof( path ), "%s/%s", root_dir, file->path );
+  in = fopen( path, "rb" );
+  if( in == NULL )
+  {
+    fprintf( stderr, "mkromfs: cannot open %s\n", path );
+    return NULL;
+  }
+
+  /* one more byte for detecting files which have grown since scanning */
+  data = malloc( file->size + 1 );
+  if( data == NULL )
+  {
+    fprintf( stderr, "mkromfs: out of memory error!\n" );
+  }
+  else
+  {
+    n = fread( data, 1, file->size + 1, in );
+    if( n != file->size )
+    {
+      fprintf( stderr, "mkromfs: size of %s has changed\n", path );
+      free( data );
+      data = NULL;
+    }
+  }
+
+  fclose( in );
+  return data;
+}
+
+
+/*!
+ *  read all files of the tree and compute the hash of their content
+ */
+static int _mkromfs_hash_files( const char* root_dir, MKROMFS_TREE* tree )
+{
+  MKROMFS_FILE* file;
+  char*         data;
+  long          n;
+  int           i;
+
+  for( i = 0; i < tree->nr_files; ++i )
+  {
+    file = & tree->file_tab[i];
+    data = _mkromfs_read_file( root_dir, file );
+    if( data == NULL )
+      return -1;
+
+    /* FNV-1a */
+    file->hash = 14695981039346656037ULL;
+    for( n = 0; n < file->size; ++n )
+    {
+      file->hash ^= (unsigned char) data[n];
+      file->hash *= 1099511628211ULL;
+    }
+
+    free( data );
+  }
+
+  return 0;
+}
+
+
+/*!
+ *  write generated C source of all files of the tree, see romfs.h
+ */
+static int _mkromfs_write_source( FILE* out, const char* root_dir, MKROMFS_TREE* tree )
+{
+  char* data;
+  long  n;
+  int   i;
+
+  fprintf( out, "/*\n *  generated by mkromfs from %s, do not edit\n */\n\n", root_dir );
+  fprintf( out, "#include <stddef.h>\n#include \"romfs.h\"\n\n\n" );
+
+  for( i = 0; i < tree->nr_files; ++i )
+  {
+    data = _mkromfs_read_file( root_dir, & tree->file_tab[i] );
+    if( data == NULL )
+      return -1;
+
+    fprintf( out, "static const char romfs_data_%d[] =\n  \"", i );
+    for( n = 0; n < tree->file_tab[i].size; ++n )
+    {
+      if( n > 0 && n % MKROMFS_BYTES_PER_LINE == 0 )
+        fprintf( out, "\"\n  \"" );
+      fprintf( out, "\\%03o", (unsigned char) data[n] );
+    }
+    fprintf( out, "\";\n\n" );
+
+    free( data );
+  }
+
+  fprintf( out, "\nconst ROMFS_ENTRY ROMFS_Index[] =\n{\n" );
+  for( i = 0; i < tree->nr_files; ++i )
+  {
+    fprintf( out, "  { " );
+    _mkromfs_write_string( out, tree->file_tab[i].path );
+    fprintf( out, ", romfs_data_%d, %ldL, %ldL, \"\\\"%016llx\\\"\" },\n",
+      i, tree->file_tab[i].size, (long) tree->file_tab[i].mtime, tree->file_tab[i].hash );
+  }
+
+  /* C does not allow empty arrays */
+  if( tree->nr_files == 0 )
+    fprintf( out, "  { NULL, NULL, 0L, 0L, NULL }\n" );
+
+  fprintf( out, "};\n\nconst int ROMFS_IndexSize = %d;\n", tree->nr_files );
+
+  return 0;
+}
+
+
+/*!
+ *  write content pack of all files of the tree, see pack.h
+ */
+static int _mkromfs_write_pack( FILE* out, const char* root_dir, MKROMFS_TREE* tree )
+{
+  PACK_HEADER   header;
+  PACK_ENTRY    entry;
+  uint32_t*     hash_tab;
+  uint32_t      slot;
+  uint64_t      path_off, offset;
+  char*         data;
+  int           i;
+
+  memset( & header, 0, sizeof( header ) );
+  memcpy( header.magic, PACK_MAGIC, sizeof( header.magic ) );
+  header.version    = PACK_VERSION;
+  header.nr_entries = tree->nr_files;
+
+  /* load factor of at most 1/2, at least one slot stays empty */
+  for( header.hash_size = 2; header.hash_size < 2 * header.nr_entries; header.hash_size *= 2 )
+    ;
+
+  hash_tab = calloc( header.hash_size, sizeof( uint32_t ) );
+  if( hash_tab == NULL )
+  {
+    fprintf( stderr, "mkromfs: out of memory error!\n" );
+    return -1;
+  }
+
+  for( i = 0; i < tree->nr_files; ++i )
+  {
+    for( slot = PACK_Hash( tree->file_tab[i].path ) & ( header.hash_size - 1 ); hash_tab[slot] != 0; 
+         slot = ( slot + 1 ) & ( header.hash_size - 1 ) )
+      ;
+    hash_tab[slot] = i + 1;
+  }
+
+  fwrite( & header, sizeof( header ), 1, out );
+  fwrite( hash_tab, sizeof( uint32_t ), header.hash_size, out );
+  free( hash_tab );
+
+  /* paths follow the entry table, file contents follow the paths */
+  path_off = sizeof( header ) + header.hash_size * sizeof( uint32_t ) + header.nr_entries * sizeof( PACK_ENTRY );
+  offset   = path_off;
+  for( i = 0; i < tree->nr_files; ++i )
+    offset += strlen( tree->file_tab[i].path ) + 1;
+
+  for( i = 0; i < tree->nr_files; ++i )
+  {
+    memset( & entry, 0, sizeof( entry ) );
+    entry.hash      = PACK_Hash( tree->file_tab[i].path );
+    entry.path_off  = path_off;
+    entry.data_off  = offset;
+    entry.size      = tree->file_tab[i].size;
+    entry.mtime     = tree->file_tab[i].mtime;
+    snprintf( entry.etag, PACK_ETAG_LEN, "\"%016llx\"", tree->file_tab[i].hash );
+    path_off += strlen( tree->file_tab[i].path ) + 1;
+    offset   += entry.size;
+
+    fwrite( & entry, sizeof( entry ), 1, out );
+  }
+
+  for( i = 0; i < tree->nr_files; ++i )
+    fwrite( tree->file_tab[i].path, strlen( tree->file_tab[i].path ) + 1, 1, out );
+
+  for( i = 0; i < tree->nr_files; ++i )
+  {
+    data = _mkromfs_read_file( root_dir, & tree->file_tab[i] );
+    if( data == NULL )
+      return -1;
+
+    fwrite( data, 1, tree->file_tab[i].size, out );
+    free( data );
+  }
+
+  return 0;
+}
+
+
+
+/* -- main ------------------------------------------------------------------------*/
+
+
+int main( int argc, char* argv[] )
+{
+  MKROMFS_TREE  tree;
+  const char*   root_dir;
+  int           pack, error;
+
+  pack = ( argc == 3 && strcmp( argv[1], "-p" ) == 0 );
+  if( argc != 2 + pack )
+  {
+    fprintf( stderr, "Invocation: %s <root directory> > romfs_data.c\n", argv[0] );
+    fprintf( stderr, "            %s -p <root directory> > content.pack\n", argv[0] );
+    return -1;
+  }
+  root_dir = argv[1 + pack];
+
+  memset( & tree, 0, sizeof( tree ) );
+  error = _mkromfs_scan_dir( & tree, root_dir, "", 0 );
+  if( ! error )
+  {
+    qsort( tree.file_tab, tree.nr_files, sizeof( MKROMFS_FILE ), _mkromfs_comp );
+    error = _mkromfs_hash_files( root_dir, & tree );
+  }
+
+  if( ! error )
+  {
+    if( pack )
+      error = _mkromfs_write_pack( stdout, root_dir, & tree );
+    else
+      error = _mkromfs_write_source( stdout, root_dir, & tree );
+  }
+
+  if( ! error && fflush( stdout ) != 0 )
+  {
+    fprintf( stderr, "mkromfs: write error!\n" );
+    error = -1;
+  }
+
+  return error ? 1 : 0;
+}
@@ -0,0 +1,387 @@
+/*
+ *  multipart.c
+ *  idefix
+ *
+ *  incremental parser of multipart/form-data bodies ( RFC 7578 ). The
+ *  body is fed in pieces as it is received, the data of each part is
+ *  passed to a handler or written to a file right away. Hence the
+ *  memory needed does not depend on the size of the upload.
+ *
+ *  Copyright 2010 GNU General Public Licence. All rights reserved.
+ *
+ */
+
+/* -- includes -------------------------------------------------------------------*/
+
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "multipart.h"
+#include "scan.h"
+
+
+/* -- const definitions -----------------------------------------------------------*/
+
+
+/*!
+ *  Maximum number of bytes between a boundary and its line break
+ */
+#define MULTIPART_MAX_PADDING       256
+
+
+#define MIN(x,y) ( (x)<(y) ? (x) : (y) )
+#define MAX(x,y) ( (x)>(y) ? (x) : (y) )
+
+
+
+/* -- local types ---------------------------------------------------------------*/
+
+
+/*!
+ *  Parser states
+ */
+typedef enum
+{
+  MULTIPART_STATE_PREAMBLE,         /* searching for the first boundary */
+  MULTIPART_STATE_BOUNDARY_END,     /* waiting for line break or "--" behind a boundary */
+  MULTIPART_STATE_HEADER,           /* waiting for the end of a part header */
+  MULTIPART_STATE_DATA,             /* passing data until the next boundary */
+  MULTIPART_STATE_DONE,             /* closing boundary found, ignoring the epilogue */
+  MULTIPART_STATE_FAILED
+} MULTIPART_STATE;
+
+
+
+/* -- local functions -------------------------------------------------------------*/
+
+
+/*!
+ *  copy value of parameter key of a header field value like
+ *  'form-data; name="file"; filename="a.bin"' to out, the value is
+ *  truncated to size - 1 bytes. Returns the length of the copied value,
+ *  -1 when the parameter is not given.
+ */
+static int _multipart_param( const char* value, const long len, const char* key, char* out, const int size )
+{
+  const char*   end = value + len;
+  const char*   p   = value;
+  const int     key_len = strlen( key );
+  int           n = 0;
+
+  for( ;; )
+  {
+    /* parameters follow a semicolon */
+    p = memchr( p, ';', end - p );
+    if( p == NULL )
+      return -1;
+
+    for( ++p; p < end && ( *p == ' ' || *p == '\t' ); ++p )
+      ;
+
+    if( end - p > key_len && p[key_len] == '=' && SCAN_CaseEqual( p, key, key_len ) )
+      break;
+  }
+
+  p += key_len + 1;
+  if( p < end && *p == '"' )
+  {
+    /* quoted string, backslash escapes the next character */
+    for( ++p; p < end && *p != '"'; ++p )
+    {
+      if( *p == '\\' && p + 1 < end )
+        ++p;
+      if( n < size - 1 )
+        out[n++] = *p;
+    }
+  }
+  else
+  {
+    for( ; p < end && *p != ';' && *p != ' ' && *p != '\t'; ++p )
+    {
+      if( n < size - 1 )
+        out[n++] = *p;
+    }
+  }
+
+  out[n] = '\0';
+  return n;
+}
+
+
+/*!
+ *  take name, filename and media type of the next part out of its header
+ *  and announce it to the handler
+ */
+static long _multipart_begin( MULTIPART_PARSER* parser, const char* header, const long len )
+{
+  static const char   disposition[] = "Content-Disposition:";
+  static const char   type[]        = "Content-Type:";
+  MULTIPART_PART*     part = & parser->part;
+  const char*         end  = header + len;
+  const char*         eol;
+  long                n;
+
+  memset( part, 0, sizeof( MULTIPART_PART ) );
+  part->fd = -1;
+
+  for( ; header < end; header = eol + 2 )
+  {
+    eol = header + SCAN_FindString( header, end - header, "\r\n", 2 );
+    n   = eol - header;
+
+    if( n > (long) sizeof( disposition ) - 1 && SCAN_CaseEqual( header, disposition, sizeof( disposition ) - 1 ) )
+    {
+      _multipart_param( header, n, "name", part->name, sizeof( part->name ) );
+      _multipart_param( header, n, "filename", part->filename, sizeof( part->filename ) );
+    }
+    else if( n > (long) sizeof( type ) - 1 && SCAN_CaseEqual( header, type, sizeof( type ) - 1 ) )
+    {
+      for( header += sizeof( type ) - 1; header < eol && ( *header == ' ' || *header == '\t' ); ++header )
+        ;
+      n = MIN( eol - header, (long) sizeof( part->content_type ) - 1 );
+      memcpy( part->content_type, header, n );
+    }
+  }
+
+  parser->in_part = true;
+  if( (*parser->handler)( parser->arg, part, MULTIPART_PART_BEGIN, NULL, 0 ) != 0 )
+    return MULTIPART_HANDLER_ERROR;
+
+  return 0;
+}
+
+
+/*!
+ *  pass data of the current part to its file or to the handler
+ */
+static long _multipart_data( MULTIPART_PARSER* parser, const char* data, const long len )
+{
+  MULTIPART_PART* part = & parser->part;
+  long            n, written;
+
+  if( part->fd >= 0 )
+  {
+    for( written = 0; written < len; written += n )
+    {
+      n = write( part->fd, data + written, len - written );
+      if( n < 0 && errno == EINTR )
+        n = 0;
+      else if( n <= 0 )
+        return MULTIPART_WRITE_ERROR;
+    }
+  }
+  else if( (*parser->handler)( parser->arg, part, MULTIPART_PART_DATA, data, len ) != 0 )
+  {
+    return MULTIPART_HANDLER_ERROR;
+  }
+
+  part->len         += len;
+  parser->total_len += len;
+  return 0;
+}
+
+
+/*!
+ *  advance parser by the bytes at the beginning of buf, returns the number
+ *  of consumed bytes, 0 when more bytes are required, or an error code
+ */
+static long _multipart_step( MULTIPART_PARSER* parser, const char* buf, const long len )
+{
+  const char* eol;
+  long        pos, error;
+
+  switch( parser->state )
+  {
+    case MULTIPART_STATE_PREAMBLE:
+      /* the first boundary might start the body without a preceding line break */
+      pos = SCAN_FindString( buf, len, parser->delimiter + 2, parser->delimiter_len - 2 );
+      if( pos == len )
+        return MAX( len - ( parser->delimiter_len - 3 ), 0 );
+
+      parser->state = MULTIPART_STATE_BOUNDARY_END;
+      return pos + parser->delimiter_len - 2;
+
+    case MULTIPART_STATE_BOUNDARY_END:
+      if( len < 2 )
+        return 0;
+
+      if( buf[0] == '-' && buf[1] == '-' )
+      {
+        parser->state = MULTIPART_STATE_DONE;
+        return 2;
+      }
+
+      /* line break might be preceded by white space */
+      eol = memchr( buf, '\n', len );
+      if( eol == NULL )
+        return ( len > MULTIPART_MAX_PADDING ) ? MULTIPART_MALFORMED : 0;
+
+      parser->state = MULTIPART_STATE_HEADER;
+      return eol - buf + 1;
+
+    case MULTIPART_STATE_HEADER:
+      if( len < 2 )
+        return 0;
+
+      if( buf[0] == '\r' && buf[1] == '\n' )
+      {
+        /* part without header fields */
+        pos = 0;
+      }
+      else
+      {
+        pos = SCAN_FindString( buf, MIN( len, MULTIPART_MAX_HEADER ), "\r\n\r\n", 4 );
+        if( pos == MIN( len, MULTIPART_MAX_HEADER ) )
+          return ( len >= MULTIPART_MAX_HEADER ) ? MULTIPART_MALFORMED : 0;
+        pos += 2;
+      }
+
+      if( ( error = _multipart_begin( parser, buf, pos ) ) != 0 )
+        return error;
+
+      parser->state = MULTIPART_STATE_DATA;
+      return pos + 2;
+
+    case MULTIPART_STATE_DATA:
+      pos = SCAN_FindString( buf, len, parser->delimiter, parser->delimiter_len );
+      if( pos == len )
+      {
+        /* the last bytes might be the beginning of the delimiter */
+        pos = len - ( parser->delimiter_len - 1 );
+        if( pos <= 0 )
+          return 0;
+
+        error = _multipart_data( parser, buf, pos );
+        return ( error != 0 ) ? error : pos;
+      }
+
+      if( pos > 0 && ( error = _multipart_data( parser, buf, pos ) ) != 0 )
+        return error;
+
+      parser->in_part = false;
+      ++parser->nr_parts;
+      if( (*parser->handler)( parser->arg, & parser->part, MULTIPART_PART_END, NULL, 0 ) != 0 )
+        return MULTIPART_HANDLER_ERROR;
+
+      parser->state = MULTIPART_STATE_BOUNDARY_END;
+      return pos + parser->delimiter_len;
+
+    case MULTIPART_STATE_DONE:
+      return len;
+
+    default:
+      return MULTIPART_MALFORMED;
+  }
+}
+
+
+
+/* -- public prototypes ----------------------------------------------------------*/
+
+
+/*******************************************************************************
+ * MULTIPART_Init()
+ *                                                                         */ /*!
+ * Prepare parser for a body
+ *
+ * Function parameters
+ *     - parser:        parser state
+ *     - content_type:  value of the Content-Type header field, holds the boundary
+ *     - handler:       part handler
+ *     - arg:           first argument of handler
+ *
+ * Returnparameter
+ *     - R: 0 in case of success, MULTIPART_MALFORMED when the boundary is
+ *          missing or too long
+ *
+ *******************************************************************************/
+int MULTIPART_Init( MULTIPART_PARSER* parser, const char* content_type, MULTIPART_HANDLER handler, void* arg )
+{
+  char  boundary[MULTIPART_MAX_BOUNDARY + 2];
+  int   len;
+
+  memset( parser, 0, sizeof( MULTIPART_PARSER ) );
+  parser->part.fd = -1;
+  parser->handler = handler;
+  parser->arg     = arg;
+  parser->state   = MULTIPART_STATE_FAILED;
+
+  len = _multipart_param( content_type, strlen( content_type ), "boundary", boundary, sizeof( boundary ) );
+  if( len < 1 || len > MULTIPART_MAX_BOUNDARY )
+    return MULTIPART_MALFORMED;
+
+  memcpy( parser->delimiter, "\r\n--", 4 );
+  memcpy( parser->delimiter + 4, boundary, len );
+  parser->delimiter_len = len + 4;
+  parser->state = MULTIPART_STATE_PREAMBLE;
+
+  return 0;
+}
+
+
+/*******************************************************************************
+ * MULTIPART_Feed()
+ *                                                                         */ /*!
+ * Parse next piece of the body. Bytes which might belong to a boundary or
+ * to an incomplete part header are not consumed, they have to be fed again
+ * together with the following bytes.
+ *
+ * Function parameters
+ *     - parser:      parser state
+ *     - buf:         received bytes
+ *     - len:         number of received bytes
+ *
+ * Returnparameter
+ *     - R: number of consumed bytes, negative error code on failure
+ *
+ *******************************************************************************/
+long MULTIPART_Feed( MULTIPART_PARSER* parser, const char* buf, const long len )
+{
+  long  pos = 0, n;
+
+  while( ( n = _multipart_step( parser, buf + pos, len - pos ) ) > 0 )
+    pos += n;
+
+  if( n < 0 )
+  {
+    parser->state = MULTIPART_STATE_FAILED;
+    return n;
+  }
+
+  return pos;
+}
+
+
+/*******************************************************************************
+ * MULTIPART_Finish()
+ *                                                                         */ /*!
+ * Complete parsing after the last byte of the body has been fed. The
+ * handler gets MULTIPART_PART_ABORT for a part which has not been
+ * completed. It is safe to call this function more than once.
+ *
+ * Function parameters
+ *     - parser:      parser state
+ *
+ * Returnparameter
+ *     - R: 0 when the closing boundary has been found, otherwise
+ *          MULTIPART_MALFORMED
+ *
+ *******************************************************************************/
+int MULTIPART_Finish( MULTIPART_PARSER* parser )
+{
+  if( parser->in_part )
+  {
+    parser->in_part = false;
+    (*parser->handler)( parser->arg, & parser->part, MULTIPART_PART_ABORT, NULL, 0 );
+  }
+
+  if( parser->state != MULTIPART_STATE_DONE )
+  {
+    parser->state = MULTIPART_STATE_FAILED;
+    return MULTIPART_MALFORMED;
+  }
+
+  return 0;
+}
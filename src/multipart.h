@@ -0,0 +1,172 @@
+/*
+ *  multipart.h
+ *  idefix
+ *
+ *  incremental parser of multipart/form-data bodies ( RFC 7578 ). The
+ *  body is fed in pieces as it is received, the data of each part is
+ *  passed to a handler or written to a file right away. Hence the
+ *  memory needed does not depend on the size of the upload.
+ *
+ *  Copyright 2010 GNU General Public Licence. All rights reserved.
+ *
+ */
+
+#ifndef _MULTIPART_H
+#define _MULTIPART_H
+
+
+/* -- const definitions -----------------------------------------------------------*/
+
+
+/*!
+ *  Maximum length of the boundary ( RFC 2046 )
+ */
+#define MULTIPART_MAX_BOUNDARY      70
+
+
+/*!
+ *  Maximum length of the header of a part, it has to be received
+ *  completely before the part is announced to the handler
+ */
+#define MULTIPART_MAX_HEADER        2048
+
+
+/*!
+ *  Size of the fields of MULTIPART_PART, longer values are truncated
+ */
+#define MULTIPART_MAX_NAME          64
+#define MULTIPART_MAX_FILENAME      128
+#define MULTIPART_MAX_TYPE          64
+
+
+/*!
+ *  Error codes
+ */
+#define MULTIPART_MALFORMED         ( -1 )    /* missing boundary, truncated body or oversized part header */
+#define MULTIPART_HANDLER_ERROR     ( -2 )    /* part handler failed */
+#define MULTIPART_WRITE_ERROR       ( -3 )    /* part data could not be written to file */
+
+
+
+/* -- public types    -----------------------------------------------------------*/
+
+
+/*!
+ *  Events passed to the part handler
+ */
+typedef enum
+{
+  MULTIPART_PART_BEGIN,             /* header of a part received, no data yet */
+  MULTIPART_PART_DATA,              /* next piece of data of the part */
+  MULTIPART_PART_END,               /* all data of the part received */
+  MULTIPART_PART_ABORT              /* body ended or failed within the part */
+} MULTIPART_EVENT;
+
+
+/*!
+ *  Part of the body, the fields are taken from its Content-Disposition
+ *  and Content-Type header and are empty when not given
+ */
+typedef struct _MULTIPART_PART
+{
+  char                name[MULTIPART_MAX_NAME];
+  char                filename[MULTIPART_MAX_FILENAME];
+  char                content_type[MULTIPART_MAX_TYPE];
+  long                len;          /* number of data bytes received so far */
+  int                 fd;           /* when set by the handler on MULTIPART_PART_BEGIN, data is
+                                       written to this file instead of being passed to the handler */
+} MULTIPART_PART;
+
+
+/*!
+ *  Part handler, data and len are only given for MULTIPART_PART_DATA.
+ *  The handler has to close part->fd on MULTIPART_PART_END and
+ *  MULTIPART_PART_ABORT. Returns 0 to continue, otherwise the body
+ *  is rejected.
+ */
+typedef int (* MULTIPART_HANDLER)(
+  void*               arg,
+  MULTIPART_PART*     part,
+  const int           event,
+  const char*         data,
+  const long          len );
+
+
+/*!
+ *  Parser state
+ */
+typedef struct
+{
+  char                delimiter[4 + MULTIPART_MAX_BOUNDARY]; /* CR LF "--" boundary */
+  int                 delimiter_len;
+  int                 state;
+  int                 in_part;      /* a part has been announced but not completed yet */
+  int                 nr_parts;     /* number of completed parts */
+  long                total_len;    /* number of data bytes of all parts */
+  MULTIPART_PART      part;         /* current part */
+  MULTIPART_HANDLER   handler;
+  void*               arg;          /* first argument of handler */
+} MULTIPART_PARSER;
+
+
+
+/* -- public prototypes ----------------------------------------------------------*/
+
+
+/*******************************************************************************
+ * MULTIPART_Init()
+ *                                                                         */ /*!
+ * Prepare parser for a body
+ *
+ * Function parameters
+ *     - parser:        parser state
+ *     - content_type:  value of the Content-Type header field, holds the boundary
+ *     - handler:       part handler
+ *     - arg:           first argument of handler
+ *
+ * Returnparameter
+ *     - R: 0 in case of success, MULTIPART_MALFORMED when the boundary is
+ *          missing or too long
+ *
+ *******************************************************************************/
+int MULTIPART_Init( MULTIPART_PARSER* parser, const char* content_type, MULTIPART_HANDLER handler, void* arg );
+
+
+/*******************************************************************************
+ * MULTIPART_Feed()
+ *                                                                         */ /*!
+ * Parse next piece of the body. Bytes which might belong to a boundary or
+ * to an incomplete part header are not consumed, they have to be fed again
+ * together with the following bytes.
+ *
+ * Function parameters
+ *     - parser:      parser state
+ *     - buf:         received bytes
+ *     - len:         number of received bytes
+ *
+ * Returnparameter
+ *     - R: number of consumed bytes, negative error code on failure
+ *
+ *******************************************************************************/
+long MULTIPART_Feed( MULTIPART_PARSER* parser, const char* buf, const long len );
+
+
+/*******************************************************************************
+ * MULTIPART_Finish()
+ *                                                                         */ /*!
+ * Complete parsing after the last byte of the body has been fed. The
+ * handler gets MULTIPART_PART_ABORT for a part which has not been
+ * completed. It is safe to call this function more than once.
+ *
+ * Function parameters
+ *     - parser:      parser state
+ *
+ * Returnparameter
+ *     - R: 0 when the closing boundary has been found, otherwise
+ *          MULTIPART_MALFORMED
+ *
+ *******************************************************************************/
+int MULTIPART_Finish( MULTIPART_PARSER* parser );
+
+
+#endif /* #ifndef _MULTIPART_H */
@@ -0,0 +1,374 @@
+/*
+ *  pack.c
+ *  idefix
+ *
+ *  static content served from one memory mapped archive ( pack ) which
+ *  is generated by mkromfs -p. A new version of the archive is swapped
+ *  in on request while pending transmissions keep the old mapping.
+ *
+ *  Copyright 2010 GNU General Public Licence. All rights reserved.
+ *
+ */
+
+/* -- includes -------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "pack.h"
+
+
+/* -- local functions -------------------------------------------------------------*/
+
+
+/*!
+ *  set up the tables of the mapped archive and check that it does not refer to
+ *  anything beyond the mapping, hence lookups do not need to validate offsets
+ */
+static int _pack_setup( PACK* pack )
+{
+  const PACK_HEADER*  header = (const PACK_HEADER*) pack->map;
+  const PACK_ENTRY*   entry;
+  uint64_t            tables_len;
+  uint32_t            i;
+
+  if( pack->map_len < sizeof( PACK_HEADER ) ||
+      memcmp( header->magic, PACK_MAGIC, sizeof( header->magic ) ) != 0 ||
+      header->version != PACK_VERSION ||
+      header->hash_size == 0 || ( header->hash_size & ( header->hash_size - 1 ) ) != 0 ||
+      header->nr_entries >= header->hash_size )
+    return false;
+
+  tables_len = sizeof( PACK_HEADER ) + (uint64_t) header->hash_size * sizeof( uint32_t )
+             + (uint64_t) header->nr_entries * sizeof( PACK_ENTRY );
+  if( tables_len > pack->map_len )
+    return false;
+
+  pack->header    = header;
+  pack->hash_tab  = (const uint32_t*) ( pack->map + sizeof( PACK_HEADER ) );
+  pack->entry_tab = (const PACK_ENTRY*) ( pack->hash_tab + header->hash_size );
+
+  for( i = 0; i < header->hash_size; ++i )
+  {
+    if( pack->hash_tab[i] > header->nr_entries )
+      return false;
+  }
+
+  for( i = 0; i < header->nr_entries; ++i )
+  {
+    entry = & pack->entry_tab[i];
+    if( entry->path_off >= pack->map_len ||
+        memchr( pack->map + entry->path_off, '\0', pack->map_len - entry->path_off ) == NULL ||
+        entry->data_off > pack->map_len || entry->size > pack->map_len - entry->data_off ||
+        memchr( entry->etag, '\0', PACK_ETAG_LEN ) == NULL )
+      return false;
+  }
+
+  return true;
+}
+
+
+/*!
+ *  map archive, returns NULL in case of error
+ */
+static PACK* _pack_map( const char* filename )
+{
+  PACK*       pack;
+  struct stat file_stat;
+  int         fd;
+
+  fd = open( filename, O_RDONLY );
+  if( fd < 0 )
+    return NULL;
+
+  pack = calloc( 1, sizeof( PACK ) );
+  if( pack != NULL && fstat( fd, & file_stat ) == 0 && file_stat.st_size > 0 )
+  {
+    pack->map_len = file_stat.st_size;
+    pack->map     = mmap( NULL, pack->map_len, PROT_READ, MAP_SHARED, fd, 0 );
+    if( pack->map == MAP_FAILED )
+      pack->map = NULL;
+  }
+  close( fd );
+
+  if( pack == NULL || pack->map == NULL )
+  {
+    free( pack );
+    return NULL;
+  }
+
+  pack->refcnt = 1;
+  if( ! _pack_setup( pack ) )
+  {
+    munmap( pack->map, pack->map_len );
+    free( pack );
+    return NULL;
+  }
+
+  return pack;
+}
+
+
+/*!
+ *  drop reference, the archive is unmapped by the last user. Mutex must be locked.
+ */
+static void _pack_unref( PACK* pack )
+{
+  if( --pack->refcnt == 0 )
+  {
+    munmap( pack->map, pack->map_len );
+    free( pack );
+  }
+}
+
+
+/*!
+ *  map archive again for each reload request until the pipe is closed
+ */
+static void* _pack_reloader( void* arg )
+{
+  PACK_STORE* store = arg;
+  PACK*       pack;
+  char        request;
+  long        n;
+
+  while( ( n = read( store->reload_pipe[0], & request, 1 ) ) != 0 )
+  {
+    if( n < 0 )
+    {
+      if( errno == EINTR )
+        continue;
+      break;
+    }
+
+    pack = _pack_map( store->filename );
+    if( pack == NULL )
+    {
+      fprintf( stderr, "Could not reload content pack %s, keep the previous one!\n", store->filename );
+      continue;
+    }
+
+    pthread_mutex_lock( & store->mutex );
+    _pack_unref( store->current );
+    store->current = pack;
+    pthread_mutex_unlock( & store->mutex );
+
+    printf("Content pack %s reloaded\n", store->filename );
+  }
+
+  return NULL;
+}
+
+
+/* -- public prototypes ----------------------------------------------------------*/
+
+
+/*******************************************************************************
+ * PACK_Init()
+ *                                                                         */ /*!
+ * Map archive, check its consistency and start thread for reloading it
+ *
+ * Function parameters
+ *     - store:       pointer to pack store
+ *     - filename:    archive generated by mkromfs -p
+ *
+ * Returnparameter
+ *     - R: 0 in case of success, -1 when the archive cannot be mapped
+ *          or is corrupt
+ *
+ *******************************************************************************/
+int PACK_Init( PACK_STORE* store, const char* filename )
+{
+  memset( store, 0, sizeof( PACK_STORE ) );
+  pthread_mutex_init( & store->mutex, NULL );
+  store->reload_pipe[0] = store->reload_pipe[1] = -1;
+
+  store->filename = strdup( filename );
+  if( store->filename == NULL )
+    return -1;
+
+  store->current = _pack_map( filename );
+  if( store->current == NULL )
+    return -1;
+
+  /* requests are dropped rather than blocking the signal handler when the pipe is full */
+  if( pipe( store->reload_pipe ) != 0 )
+  {
+    store->reload_pipe[0] = store->reload_pipe[1] = -1;
+    return -1;
+  }
+  fcntl( store->reload_pipe[1], F_SETFL, O_NONBLOCK );
+
+  if( pthread_create( & store->reloader, NULL, _pack_reloader, store ) != 0 )
+  {
+    close( store->reload_pipe[0] );
+    close( store->reload_pipe[1] );
+    store->reload_pipe[0] = store->reload_pipe[1] = -1;
+    return -1;
+  }
+
+  return 0;
+}
+
+
+/*******************************************************************************
+ * PACK_Exit()
+ *                                                                         */ /*!
+ * Stop reloading and unmap archive, it must not be referenced anymore
+ *
+ * Function parameters
+ *     - store:       pointer to pack store
+ *
+ *******************************************************************************/
+void PACK_Exit( PACK_STORE* store )
+{
+  /* reloader terminates when the pipe is closed */
+  if( store->reload_pipe[1] >= 0 )
+  {
+    close( store->reload_pipe[1] );
+    pthread_join( store->reloader, NULL );
+    close( store->reload_pipe[0] );
+    store->reload_pipe[0] = store->reload_pipe[1] = -1;
+  }
+
+  if( store->current != NULL )
+  {
+    _pack_unref( store->current );
+    store->current = NULL;
+  }
+
+  free( store->filename );
+  store->filename = NULL;
+  pthread_mutex_destroy( & store->mutex );
+}
+
+
+/*******************************************************************************
+ * PACK_RequestReload()
+ *                                                                         */ /*!
+ * Request to map the archive again, e.g. after it has been replaced by a new
+ * version. The new archive is swapped in by the reloading thread, the old one
+ * is unmapped when it is not referenced anymore. When the new archive cannot
+ * be mapped the old one is kept. Can be invoked from a signal handler.
+ *
+ * Function parameters
+ *     - store:       pointer to pack store
+ *
+ *******************************************************************************/
+void PACK_RequestReload( PACK_STORE* store )
+{
+  const int saved_errno = errno;
+
+  /* fails only when the pipe is full, then a reload is pending anyway */
+  if( write( store->reload_pipe[1], "r", 1 ) < 0 )
+    errno = saved_errno;
+}
+
+
+/*******************************************************************************
+ * PACK_Acquire()
+ *                                                                         */ /*!
+ * Reference currently served archive, it has to be given back by PACK_Release()
+ *
+ * Function parameters
+ *     - store:       pointer to pack store
+ *
+ * Returnparameter
+ *     - R: referenced archive
+ *
+ *******************************************************************************/
+PACK* PACK_Acquire( PACK_STORE* store )
+{
+  PACK* pack;
+
+  pthread_mutex_lock( & store->mutex );
+  pack = store->current;
+  ++pack->refcnt;
+
+  pthread_mutex_unlock( & store->mutex );
+
+  return pack;
+}
+
+
+/*******************************************************************************
+ * PACK_Release()
+ *                                                                         */ /*!
+ * Give back archive retrieved by PACK_Acquire()
+ *
+ * Function parameters
+ *     - store:       pointer to pack store
+ *     - pack:        archive which is not used anymore
+ *
+ *******************************************************************************/
+void PACK_Release( PACK_STORE* store, PACK* pack )
+{
+  pthread_mutex_lock( & store->mutex );
+  _pack_unref( pack );
+  pthread_mutex_unlock( & store->mutex );
+}
+
+
+/*******************************************************************************
+ * PACK_Lookup()
+ *                                                                         */ /*!
+ * Retrieve archived file by its hash
+ *
+ * Function parameters
+ *     - pack:        referenced archive
+ *     - path:        path relative to the root directory without leading '/'
+ *
+ * Returnparameter
+ *     - R: entry, NULL when there is no such file
+ *
+ *******************************************************************************/
+const PACK_ENTRY* PACK_Lookup( const PACK* pack, const char* path )
+{
+  const uint32_t    hash = PACK_Hash( path );
+  const uint32_t    mask = pack->header->hash_size - 1;
+  const PACK_ENTRY* entry;
+  uint32_t          slot;
+
+  /* the table has at least one empty slot, hence the probing terminates */
+  for( slot = hash & mask; pack->hash_tab[slot] != 0; slot = ( slot + 1 ) & mask )
+  {
+    entry = & pack->entry_tab[pack->hash_tab[slot] - 1];
+    if( entry->hash == hash && strcmp( pack->map + entry->path_off, path ) == 0 )
+      return entry;
+  }
+
+  return NULL;
+}
+
+
+/*******************************************************************************
+ * PACK_Hash()
+ *                                                                         */ /*!
+ * FNV-1a hash of a path as used by the hash table of the archive
+ *
+ * Function parameters
+ *     - path:        path relative to the root directory without leading '/'
+ *
+ * Returnparameter
+ *     - R: hash value
+ *
+ *******************************************************************************/
+uint32_t PACK_Hash( const char* path )
+{
+  uint32_t hash = 2166136261u;
+
+  while( *path )
+  {
+    hash ^= (unsigned char) *path++;
+    hash *= 16777619u;
+  }
+
+  return hash;
+}
@@ -0,0 +1,209 @@
+/*
+ *  pack.h
+ *  idefix
+ *
+ *  static content served from one memory mapped archive ( pack ) which
+ *  is generated by mkromfs -p. A new version of the archive is swapped
+ *  in on request while pending transmissions keep the old mapping.
+ *
+ *  Copyright 2010 GNU General Public Licence. All rights reserved.
+ *
+ */
+
+#ifndef _PACK_H
+#define _PACK_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+
+/* -- const definitions -----------------------------------------------------------*/
+
+
+/*!
+ *  Identification of a pack file
+ */
+#define PACK_MAGIC                  "IDFXPACK"
+
+
+/*!
+ *  Format version, it also detects archives of a different byte order
+ */
+#define PACK_VERSION                1
+
+
+/*!
+ *  Maximum length of an entity tag of an entry including quotes and termination
+ */
+#define PACK_ETAG_LEN               24
+
+
+
+/* -- public types    -----------------------------------------------------------*/
+
+
+/*!
+ *  Archive header at offset 0, followed by the hash table and the entry table.
+ *  The hash table maps the FNV-1a hash of a path to the index of its entry
+ *  plus one, 0 denotes an empty slot. Collisions are resolved by linear probing.
+ */
+typedef struct
+{
+  char                  magic[8];     /* PACK_MAGIC without termination */
+  uint32_t              version;      /* PACK_VERSION */
+  uint32_t              nr_entries;   /* number of files */
+  uint32_t              hash_size;    /* number of slots of the hash table, power of two */
+  uint32_t              reserved;
+} PACK_HEADER;
+
+
+/*!
+ *  Archived file, offsets refer to the beginning of the archive. Precompressed
+ *  siblings ( e.g. script.js.gz ) are files of their own.
+ */
+typedef struct
+{
+  uint32_t              hash;         /* FNV-1a hash of the path */
+  uint32_t              path_off;     /* path relative to the root directory, zero terminated */
+  uint64_t              data_off;     /* file content */
+  uint64_t              size;         /* file length in bytes */
+  int64_t               mtime;        /* time of last modification when the archive was generated */
+  char                  etag[PACK_ETAG_LEN]; /* strong entity tag including quotes, zero terminated */
+} PACK_ENTRY;
+
+
+/*!
+ *  Mapped archive, it stays valid as long as it is referenced
+ */
+typedef struct
+{
+  char*                 map;          /* mapped archive */
+  size_t                map_len;      /* length of the mapping */
+  const PACK_HEADER*    header;
+  const uint32_t*       hash_tab;
+  const PACK_ENTRY*     entry_tab;
+  int                   refcnt;       /* number of pending users including the store */
+} PACK;
+
+
+/*!
+ *  Currently served archive, shared by all threads of a process
+ */
+typedef struct
+{
+  char*                 filename;     /* archive which is mapped on reload */
+  PACK*                 current;      /* currently served archive */
+  pthread_mutex_t       mutex;        /* protects current and the reference counters */
+  int                   reload_pipe[2]; /* reload requests, -1 if not open */
+  pthread_t             reloader;     /* maps the archive on request */
+} PACK_STORE;
+
+
+
+/* -- public prototypes ----------------------------------------------------------*/
+
+
+/*******************************************************************************
+ * PACK_Init()
+ *                                                                         */ /*!
+ * Map archive, check its consistency and start thread for reloading it
+ *
+ * Function parameters
+ *     - store:       pointer to pack store
+ *     - filename:    archive generated by mkromfs -p
+ *
+ * Returnparameter
+ *     - R: 0 in case of success, -1 when the archive cannot be mapped
+ *          or is corrupt
+ *
+ *******************************************************************************/
+int PACK_Init( PACK_STORE* store, const char* filename );
+
+
+/*******************************************************************************
+ * PACK_Exit()
+ *                                                                         */ /*!
+ * Stop reloading and unmap archive, it must not be referenced anymore
+ *
+ * Function parameters
+ *     - store:       pointer to pack store
+ *
+ *******************************************************************************/
+void PACK_Exit( PACK_STORE* store );
+
+
+/*******************************************************************************
+ * PACK_RequestReload()
+ *                                                                         */ /*!
+ * Request to map the archive again, e.g. after it has been replaced by a new
+ * version. The new archive is swapped in by the reloading thread, the old one
+ * is unmapped when it is not referenced anymore. When the new archive cannot
+ * be mapped the old one is kept. Can be invoked from a signal handler.
+ *
+ * Function parameters
+ *     - store:       pointer to pack store
+ *
+ *******************************************************************************/
+void PACK_RequestReload( PACK_STORE* store );
+
+
+/*******************************************************************************
+ * PACK_Acquire()
+ *                                                                         */ /*!
+ * Reference currently served archive, it has to be given back by PACK_Release()
+ *
+ * Function parameters
+ *     - store:       pointer to pack store
+ *
+ * Returnparameter
+ *     - R: referenced archive
+ *
+ *******************************************************************************/
+PACK* PACK_Acquire( PACK_STORE* store );
+
+
+/*******************************************************************************
+ * PACK_Release()
+ *                                                                         */ /*!
+ * Give back archive retrieved by PACK_Acquire()
+ *
+ * Function parameters
+ *     - store:       pointer to pack store
+ *     - pack:        archive which is not used anymore
+ *
+ *******************************************************************************/
+void PACK_Release( PACK_STORE* store, PACK* pack );
+
+
+/*******************************************************************************
+ * PACK_Lookup()
+ *                                                                         */ /*!
+ * Retrieve archived file by its hash
+ *
+ * Function parameters
+ *     - pack:        referenced archive
+ *     - path:        path relative to the root directory without leading '/'
+ *
+ * Returnparameter
+ *     - R: entry, NULL when there is no such file
+ *
+ *******************************************************************************/
+const PACK_ENTRY* PACK_Lookup( const PACK* pack, const char* path );
+
+
+/*******************************************************************************
+ * PACK_Hash()
+ *                                                                         */ /*!
+ * FNV-1a hash of a path as used by the hash table of the archive
+ *
+ * Function parameters
+ *     - path:        path relative to the root directory without leading '/'
+ *
+ * Returnparameter
+ *     - R: hash value
+ *
+ *******************************************************************************/
+uint32_t PACK_Hash( const char* path );
+
+
+#endif /* #ifndef _PACK_H */
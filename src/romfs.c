@@ -0,0 +1,51 @@
+/*
+ *  romfs.c
+ *  idefix
+ *
+ *  read-only file system of static content compiled into the server,
+ *  the index and the file contents are generated by mkromfs
+ *
+ *  Copyright 2010 GNU General Public Licence. All rights reserved.
+ *
+ */
+
+/* -- includes -------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "romfs.h"
+
+
+/* -- local functions -------------------------------------------------------------*/
+
+
+/*!
+ *  compare search key with path of index entry
+ */
+static int _romfs_comp( const void* key, const void* entry )
+{
+  return strcmp( (const char*) key, ( (const ROMFS_ENTRY*) entry )->path );
+}
+
+
+
+/* -- public prototypes ----------------------------------------------------------*/
+
+
+/*******************************************************************************
+ * ROMFS_Lookup() 
+ *                                                                         */ /*!
+ * Retrieve compiled-in file by binary search of the index
+ *                                                                              
+ * Function parameters
+ *     - path:        path relative to the root directory without leading '/'
+ *
+ * Returnparameter
+ *     - R: entry, NULL when there is no such file
+ *
+ *******************************************************************************/
+const ROMFS_ENTRY* ROMFS_Lookup( const char* path )
+{
+  return bsearch( path, ROMFS_Index, ROMFS_IndexSize, sizeof( ROMFS_ENTRY ), _romfs_comp );
+}
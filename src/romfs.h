@@ -0,0 +1,69 @@
+/*
+ *  romfs.h
+ *  idefix
+ *
+ *  read-only file system of static content compiled into the server,
+ *  the index and the file contents are generated by mkromfs
+ *
+ *  Copyright 2010 GNU General Public Licence. All rights reserved.
+ *
+ */
+
+#ifndef _ROMFS_H
+#define _ROMFS_H
+
+#include <time.h>
+
+
+/* -- public types    -----------------------------------------------------------*/
+
+
+/*!
+ *  Compiled-in file, precompressed siblings ( e.g. script.js.gz ) are files of their own
+ */
+typedef struct
+{
+  const char*           path;         /* path relative to the root directory, key of the index */
+  const char*           data;         /* file content */
+  long                  size;         /* file length in bytes */
+  time_t                mtime;        /* time of last modification when the index was generated */
+  const char*           etag;         /* strong entity tag of the content including quotes */
+} ROMFS_ENTRY;
+
+
+
+/* -- public data     -----------------------------------------------------------*/
+
+
+/*!
+ *  Index of all compiled-in files sorted by path ( strcmp ), generated by mkromfs
+ */
+extern const ROMFS_ENTRY  ROMFS_Index[];
+
+
+/*!
+ *  Number of entries of ROMFS_Index
+ */
+extern const int          ROMFS_IndexSize;
+
+
+
+/* -- public prototypes ----------------------------------------------------------*/
+
+
+/*******************************************************************************
+ * ROMFS_Lookup() 
+ *                                                                         */ /*!
+ * Retrieve compiled-in file by binary search of the index
+ *                                                                              
+ * Function parameters
+ *     - path:        path relative to the root directory without leading '/'
+ *
+ * Returnparameter
+ *     - R: entry, NULL when there is no such file
+ *
+ *******************************************************************************/
+const ROMFS_ENTRY* ROMFS_Lookup( const char* path );
+
+
+#endif /* #ifndef _ROMFS_H */
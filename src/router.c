@@ -0,0 +1,379 @@
+/*
+ *  router.c
+ *  idefix
+ *
+ *  routing of request URL paths to CGI handlers by a compressed radix
+ *  tree. Each edge holds a common part of the registered paths, hence
+ *  a lookup is linear in the length of the URL path whatever the number
+ *  of routes. Paths may contain parameters like "sensor/{id}/history"
+ *  which match one path segment each.
+ *
+ *  Copyright 2010 GNU General Public Licence. All rights reserved.
+ *
+ */
+
+/* -- includes -------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "router.h"
+
+
+/* -- local functions -------------------------------------------------------------*/
+
+
+/*!
+ *  allocate node with given label, returns NULL when out of memory
+ */
+static ROUTER_NODE* _router_node_alloc( const char* label, const int label_len )
+{
+  ROUTER_NODE* node = calloc( 1, sizeof( ROUTER_NODE ) + label_len );
+
+  if( node != NULL )
+  {
+    node->label     = (char*) ( node + 1 );
+    node->label_len = label_len;
+    memcpy( node->label, label, label_len );
+  }
+
+  return node;
+}
+
+
+/*!
+ *  release all routes and descendants of a node
+ */
+static void _router_node_free( ROUTER_NODE* node )
+{
+  ROUTER_NODE*  child;
+  ROUTER_ROUTE* route;
+
+  while( ( route = node->route_list ) != NULL )
+  {
+    node->route_list = route->next;
+    free( route );
+  }
+
+  while( ( child = node->child_list ) != NULL )
+  {
+    node->child_list = child->next;
+    _router_node_free( child );
+    free( child );
+  }
+
+  if( node->param_child != NULL )
+  {
+    _router_node_free( node->param_child );
+    free( node->param_child );
+    node->param_child = NULL;
+  }
+}
+
+
+/*!
+ *  number of parameters of a path, -1 if a parameter is malformed
+ */
+static int _router_count_params( const char* path )
+{
+  const char* end;
+  int         nr_params = 0;
+
+  while( ( path = strchr( path, '{' ) ) != NULL )
+  {
+    end = path + 1 + strcspn( path + 1, "{}/" );
+
+    /* names must not be empty, a parameter consumes the rest of its segment */
+    if( *end != '}' || end == path + 1 || ( end[1] != '/' && end[1] != '\0' ) || ++nr_params > ROUTER_MAX_PARAMS )
+      return -1;
+
+    path = end + 1;
+  }
+
+  return nr_params;
+}
+
+
+/*!
+ *  first route of a node for the given method, NULL if none
+ */
+static const ROUTER_ROUTE* _router_node_route( const ROUTER_NODE* node, const int method_id, const int complete )
+{
+  const ROUTER_ROUTE* route;
+
+  if( ! ( node->method_id_mask & method_id ) )
+    return NULL;
+
+  for( route = node->route_list; route != NULL; route = route->next )
+  {
+    if( ( route->method_id_mask & method_id ) && ( complete || ! route->exact ) )
+      return route;
+  }
+
+  return NULL;
+}
+
+
+/*!
+ *  search route for the rest of the URL path below a node, literal children
+ *  are tried before the parameter child and the routes of the node itself
+ *  are the last resort. Parameter segments are stored from param_tab[nr_params].
+ */
+static const ROUTER_ROUTE* _router_node_lookup( 
+  const ROUTER_NODE*  node, 
+  const char*         path, 
+  const int           method_id, 
+  ROUTER_PARAM*       param_tab, 
+  const int           nr_params )
+{
+  const ROUTER_NODE*  child;
+  const ROUTER_ROUTE* route;
+  int                 len;
+
+  if( *path != '\0' )
+  {
+    for( child = node->child_list; child != NULL && child->label[0] < *path; child = child->next )
+      ;
+
+    /* the label is not zero terminated but differs from the end of path */
+    if( child != NULL && strncmp( child->label, path, child->label_len ) == 0 )
+    {
+      route = _router_node_lookup( child, path + child->label_len, method_id, param_tab, nr_params );
+      if( route != NULL )
+        return route;
+    }
+
+    if( node->param_child != NULL && ( len = strcspn( path, "/" ) ) > 0 )
+    {
+      param_tab[nr_params].ptr = path;
+      param_tab[nr_params].len = len;
+      route = _router_node_lookup( node->param_child, path + len, method_id, param_tab, nr_params + 1 );
+      if( route != NULL )
+        return route;
+    }
+  }
+
+  return _router_node_route( node, method_id, *path == '\0' );
+}
+
+
+
+/* -- public prototypes ----------------------------------------------------------*/
+
+
+/*******************************************************************************
+ * ROUTER_Init()
+ *                                                                         */ /*!
+ * Initialize empty router
+ *
+ * Function parameters
+ *     - router:      pointer to router
+ *
+ *******************************************************************************/
+void ROUTER_Init( ROUTER* router )
+{
+  memset( router, 0, sizeof( ROUTER ) );
+  router->root.label = "";
+}
+
+
+/*******************************************************************************
+ * ROUTER_Exit()
+ *                                                                         */ /*!
+ * Release all routes
+ *
+ * Function parameters
+ *     - router:      pointer to router
+ *
+ *******************************************************************************/
+void ROUTER_Exit( ROUTER* router )
+{
+  _router_node_free( & router->root );
+  ROUTER_Init( router );
+}
+
+
+/*******************************************************************************
+ * ROUTER_Add()
+ *                                                                         */ /*!
+ * Register handler for an URL path. A parameter "{name}" within the path
+ * matches a non-empty path segment, i.e. all characters up to the next '/'.
+ *
+ * Function parameters
+ *     - router:          pointer to router
+ *     - path:            URL path without leading '/', at most ROUTER_MAX_PARAMS
+ *                        parameters
+ *     - method_id_mask:  methods triggering the handler ( HTTP_GET_ID, ... )
+ *     - handler:         CGI handler
+ *     - upload_handler:  part handler of multipart bodies which are not buffered,
+ *                        NULL if none
+ *     - exact:           when zero the handler serves all URL paths starting with
+ *                        path, otherwise only path itself
+ *
+ * Returnparameter
+ *     - R: 0 in case of success, ROUTER_NO_MEMORY or ROUTER_MALFORMED_PATH
+ *
+ *******************************************************************************/
+int ROUTER_Add( 
+  ROUTER* router, 
+  const char* path, 
+  const int method_id_mask, 
+  ROUTER_HANDLER handler, 
+  MULTIPART_HANDLER upload_handler, 
+  const int exact )
+{
+  ROUTER_NODE*    node = & router->root;
+  ROUTER_NODE*    child;
+  ROUTER_NODE*    inner;
+  ROUTER_NODE**   link;
+  ROUTER_ROUTE*   route;
+  ROUTER_ROUTE**  tail;
+  int             common, len, nr_params;
+
+  /* check the path before the tree is modified */
+  if( ( nr_params = _router_count_params( path ) ) < 0 )
+    return ROUTER_MALFORMED_PATH;
+
+  route = calloc( 1, sizeof( ROUTER_ROUTE ) + strlen( path ) + 1 );
+  if( route == NULL )
+    return ROUTER_NO_MEMORY;
+
+  route->handler        = handler;
+  route->upload_handler = upload_handler;
+  route->method_id_mask = method_id_mask;
+  route->exact          = exact;
+  route->path           = strcpy( (char*) ( route + 1 ), path );
+  route->nr_params      = nr_params;
+
+  while( *path != '\0' )
+  {
+    if( *path == '{' )
+    {
+      /* all parameters at the same position share one node, their names are kept by the routes */
+      if( node->param_child == NULL && ( node->param_child = _router_node_alloc( "", 0 ) ) == NULL )
+      {
+        free( route );
+        return ROUTER_NO_MEMORY;
+      }
+      node = node->param_child;
+      path = strchr( path, '}' ) + 1;
+      continue;
+    }
+
+    /* siblings are sorted by the first character of their labels */
+    for( link = & node->child_list; *link != NULL && (*link)->label[0] < *path; link = & (*link)->next )
+      ;
+    child = *link;
+
+    if( child == NULL || child->label[0] != *path )
+    {
+      /* no common prefix with any child, the path up to the next parameter becomes a new leaf */
+      len = strcspn( path, "{" );
+      inner = _router_node_alloc( path, len );
+      if( inner == NULL )
+      {
+        free( route );
+        return ROUTER_NO_MEMORY;
+      }
+      inner->next = child;
+      *link = inner;
+      node  = inner;
+      path += len;
+      continue;
+    }
+
+    for( common = 1; common < child->label_len && path[common] == child->label[common]; ++common )
+      ;
+
+    if( common < child->label_len )
+    {
+      /* path leaves the edge in between, split it at the end of the common part */
+      inner = _router_node_alloc( child->label, common );
+      if( inner == NULL )
+      {
+        free( route );
+        return ROUTER_NO_MEMORY;
+      }
+      child->label_len -= common;
+      memmove( child->label, child->label + common, child->label_len );
+      inner->next       = child->next;
+      inner->child_list = child;
+      child->next       = NULL;
+      *link = inner;
+      child = inner;
+    }
+
+    node  = child;
+    path += common;
+  }
+
+  for( tail = & node->route_list; *tail != NULL; tail = & (*tail)->next )
+    ;
+  *tail = route;
+  node->method_id_mask |= method_id_mask;
+  ++router->nr_routes;
+
+  return 0;
+}
+
+
+/*******************************************************************************
+ * ROUTER_Lookup()
+ *                                                                         */ /*!
+ * Retrieve route for an URL path and method. The route of the longest
+ * matching path is preferred, of several routes of the same path the
+ * first registered one. Literal path characters take precedence over
+ * parameters.
+ *
+ * Function parameters
+ *     - router:      pointer to router
+ *     - path:        URL path without leading '/'
+ *     - method_id:   method of the request
+ *     - param_tab:   segments matched by the parameters of the route are
+ *                    stored here in the order of the registered path
+ *
+ * Returnparameter
+ *     - R: route, NULL when no handler is registered for path and method
+ *
+ *******************************************************************************/
+const ROUTER_ROUTE* ROUTER_Lookup( 
+  const ROUTER* router, 
+  const char* path, 
+  const int method_id, 
+  ROUTER_PARAM param_tab[ROUTER_MAX_PARAMS] )
+{
+  return _router_node_lookup( & router->root, path, method_id, param_tab, 0 );
+}
+
+
+/*******************************************************************************
+ * ROUTER_ParamIndex()
+ *                                                                         */ /*!
+ * Retrieve position of a parameter within the path of a route
+ *
+ * Function parameters
+ *     - route:       route
+ *     - name:        parameter name without braces
+ *
+ * Returnparameter
+ *     - R: index into the param_tab of ROUTER_Lookup(), -1 when the
+ *          route has no such parameter
+ *
+ *******************************************************************************/
+int ROUTER_ParamIndex( const ROUTER_ROUTE* route, const char* name )
+{
+  const char* path = route->path;
+  const char* end;
+  const int   len = strlen( name );
+  int         i;
+
+  for( i = 0; ( path = strchr( path, '{' ) ) != NULL; ++i )
+  {
+    end = strchr( path, '}' );
+    if( end - path - 1 == len && strncmp( path + 1, name, len ) == 0 )
+      return i;
+    path = end + 1;
+  }
+
+  return -1;
+}
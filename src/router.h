@@ -0,0 +1,204 @@
+/*
+ *  router.h
+ *  idefix
+ *
+ *  routing of request URL paths to CGI handlers by a compressed radix
+ *  tree. Each edge holds a common part of the registered paths, hence
+ *  a lookup is linear in the length of the URL path whatever the number
+ *  of routes. Paths may contain parameters like "sensor/{id}/history"
+ *  which match one path segment each.
+ *
+ *  Copyright 2010 GNU General Public Licence. All rights reserved.
+ *
+ */
+
+#ifndef _ROUTER_H
+#define _ROUTER_H
+
+#include "multipart.h"
+
+
+/* -- const definitions -----------------------------------------------------------*/
+
+
+/*!
+ *  Maximum number of parameters of a route path
+ */
+#define ROUTER_MAX_PARAMS           8
+
+
+/*!
+ *  Error codes of ROUTER_Add()
+ */
+#define ROUTER_NO_MEMORY            ( -1 )
+#define ROUTER_MALFORMED_PATH       ( -2 )
+
+
+
+/* -- public types    -----------------------------------------------------------*/
+
+
+/*!
+ *  CGI handler, same type as HTTP_CGI_HANDLER
+ */
+struct _HTTP_OBJ;
+typedef int (* ROUTER_HANDLER)( struct _HTTP_OBJ* this );
+
+
+/*!
+ *  Handler registered for a path, several routes of the same
+ *  path are distinguished by their methods
+ */
+typedef struct _ROUTER_ROUTE
+{
+  ROUTER_HANDLER          handler;
+  MULTIPART_HANDLER       upload_handler; /* receives multipart bodies in pieces, NULL if bodies are buffered */
+  int                     method_id_mask; /* methods triggering the handler */
+  int                     exact;          /* matches the complete URL path only when not zero */
+  const char*             path;           /* registered path, allocated with the route, names the parameters */
+  int                     nr_params;
+  struct _ROUTER_ROUTE*   next;           /* next route of the same path, in order of registration */
+} ROUTER_ROUTE;
+
+
+/*!
+ *  Node of the radix tree, the path of a node is the concatenation of the
+ *  labels from the root. Siblings differ in the first character of their
+ *  labels and are sorted by it.
+ */
+typedef struct _ROUTER_NODE
+{
+  char*                   label;          /* edge from the parent, allocated with the node, not zero terminated */
+  int                     label_len;
+  int                     method_id_mask; /* union of the methods of route_list */
+  ROUTER_ROUTE*           route_list;     /* routes of the path of this node, NULL if none */
+  struct _ROUTER_NODE*    child_list;
+  struct _ROUTER_NODE*    param_child;    /* matches one path segment, tried after child_list, NULL if none */
+  struct _ROUTER_NODE*    next;           /* next sibling */
+} ROUTER_NODE;
+
+
+/*!
+ *  Path segment matched by a parameter, points into the looked up
+ *  URL path and is not zero terminated
+ */
+typedef struct
+{
+  const char*             ptr;
+  int                     len;
+} ROUTER_PARAM;
+
+
+/*!
+ *  Radix tree of all routes
+ */
+typedef struct
+{
+  ROUTER_NODE             root;           /* empty path */
+  int                     nr_routes;
+} ROUTER;
+
+
+
+/* -- public prototypes ----------------------------------------------------------*/
+
+
+/*******************************************************************************
+ * ROUTER_Init()
+ *                                                                         */ /*!
+ * Initialize empty router
+ *
+ * Function parameters
+ *     - router:      pointer to router
+ *
+ *******************************************************************************/
+void ROUTER_Init( ROUTER* router );
+
+
+/*******************************************************************************
+ * ROUTER_Exit()
+ *                                                                         */ /*!
+ * Release all routes
+ *
+ * Function parameters
+ *     - router:      pointer to router
+ *
+ *******************************************************************************/
+void ROUTER_Exit( ROUTER* router );
+
+
+/*******************************************************************************
+ * ROUTER_Add()
+ *                                                                         */ /*!
+ * Register handler for an URL path. A parameter "{name}" within the path
+ * matches a non-empty path segment, i.e. all characters up to the next '/'.
+ * Hence it has to be followed by '/' or the end of the path.
+ *
+ * Function parameters
+ *     - router:          pointer to router
+ *     - path:            URL path without leading '/', at most ROUTER_MAX_PARAMS
+ *                        parameters
+ *     - method_id_mask:  methods triggering the handler ( HTTP_GET_ID, ... )
+ *     - handler:         CGI handler
+ *     - upload_handler:  part handler of multipart bodies which are not buffered,
+ *                        NULL if none
+ *     - exact:           when zero the handler serves all URL paths starting with
+ *                        path, otherwise only path itself
+ *
+ * Returnparameter
+ *     - R: 0 in case of success, ROUTER_NO_MEMORY or ROUTER_MALFORMED_PATH
+ *
+ *******************************************************************************/
+int ROUTER_Add( 
+  ROUTER* router, 
+  const char* path, 
+  const int method_id_mask, 
+  ROUTER_HANDLER handler, 
+  MULTIPART_HANDLER upload_handler, 
+  const int exact );
+
+
+/*******************************************************************************
+ * ROUTER_Lookup()
+ *                                                                         */ /*!
+ * Retrieve route for an URL path and method. The route of the longest
+ * matching path is preferred, of several routes of the same path the
+ * first registered one. Literal path characters take precedence over
+ * parameters.
+ *
+ * Function parameters
+ *     - router:      pointer to router
+ *     - path:        URL path without leading '/'
+ *     - method_id:   method of the request
+ *     - param_tab:   segments matched by the parameters of the route are
+ *                    stored here in the order of the registered path
+ *
+ * Returnparameter
+ *     - R: route, NULL when no handler is registered for path and method
+ *
+ *******************************************************************************/
+const ROUTER_ROUTE* ROUTER_Lookup( 
+  const ROUTER* router, 
+  const char* path, 
+  const int method_id, 
+  ROUTER_PARAM param_tab[ROUTER_MAX_PARAMS] );
+
+
+/*******************************************************************************
+ * ROUTER_ParamIndex()
+ *                                                                         */ /*!
+ * Retrieve position of a parameter within the path of a route
+ *
+ * Function parameters
+ *     - route:       route
+ *     - name:        parameter name without braces
+ *
+ * Returnparameter
+ *     - R: index into the param_tab of ROUTER_Lookup(), -1 when the
+ *          route has no such parameter
+ *
+ *******************************************************************************/
+int ROUTER_ParamIndex( const ROUTER_ROUTE* route, const char* name );
+
+
+#endif /* #ifndef _ROUTER_H */
@@ -0,0 +1,324 @@
+/*
+ *  scan.c
+ *  idefix
+ *
+ *  byte scanning kernels of the request parser, vectorised with
+ *  SSE2 / AVX2 on x86 and NEON on ARM. The instruction set is chosen
+ *  at compile time, portable scalar code is used for other targets.
+ *
+ *  Copyright 2010 GNU General Public Licence. All rights reserved.
+ *
+ */
+
+/* -- includes -------------------------------------------------------------------*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined( __AVX2__ )
+#include <immintrin.h>
+#endif
+
+#if defined( __SSE2__ )
+#include <emmintrin.h>
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#include <arm_neon.h>
+#define SCAN_USE_NEON
+#endif
+
+#include "scan.h"
+
+
+/* -- local functions -------------------------------------------------------------*/
+
+
+/*!
+ *  scalar fold of ASCII letters to lower case
+ */
+static inline int _scan_fold( const int c )
+{
+  return ( c >= 'A' && c <= 'Z' ) ? c + ( 'a' - 'A' ) : c;
+}
+
+
+#if defined( SCAN_USE_NEON )
+/*!
+ *  condense comparison result to 4 bits per byte, the first matching
+ *  byte is found by counting the trailing zeros divided by 4
+ */
+static inline uint64_t _scan_neon_mask( const uint8x16_t match )
+{
+  return vget_lane_u64( vreinterpret_u64_u8( vshrn_n_u16( vreinterpretq_u16_u8( match ), 4 ) ), 0 );
+}
+#endif
+
+
+/*!
+ *  search for the first byte not above limit or DEL, unsigned comparison
+ *  is done by the minimum of byte and limit which equals the byte if so
+ */
+static long _scan_find( const char* buf, const long len, const unsigned char limit )
+{
+  long i = 0;
+
+#if defined( __AVX2__ )
+  const __m256i limit32 = _mm256_set1_epi8( (char) limit );
+  const __m256i del32   = _mm256_set1_epi8( 127 );
+
+  for( ; i + 32 <= len; i += 32 )
+  {
+    const __m256i v     = _mm256_loadu_si256( (const __m256i*) ( buf + i ) );
+    const __m256i match = _mm256_or_si256(
+      _mm256_cmpeq_epi8( _mm256_min_epu8( v, limit32 ), v ),
+      _mm256_cmpeq_epi8( v, del32 ) );
+    const unsigned int bits = _mm256_movemask_epi8( match );
+
+    if( bits != 0 )
+      return i + __builtin_ctz( bits );
+  }
+#endif
+
+#if defined( __SSE2__ )
+  const __m128i limit16 = _mm_set1_epi8( (char) limit );
+  const __m128i del16   = _mm_set1_epi8( 127 );
+
+  for( ; i + 16 <= len; i += 16 )
+  {
+    const __m128i v     = _mm_loadu_si128( (const __m128i*) ( buf + i ) );
+    const __m128i match = _mm_or_si128(
+      _mm_cmpeq_epi8( _mm_min_epu8( v, limit16 ), v ),
+      _mm_cmpeq_epi8( v, del16 ) );
+    const unsigned int bits = _mm_movemask_epi8( match );
+
+    if( bits != 0 )
+      return i + __builtin_ctz( bits );
+  }
+#elif defined( SCAN_USE_NEON )
+  const uint8x16_t limit16 = vdupq_n_u8( limit );
+  const uint8x16_t del16   = vdupq_n_u8( 127 );
+
+  for( ; i + 16 <= len; i += 16 )
+  {
+    const uint8x16_t v     = vld1q_u8( (const uint8_t*) ( buf + i ) );
+    const uint8x16_t match = vorrq_u8( vcleq_u8( v, limit16 ), vceqq_u8( v, del16 ) );
+    const uint64_t   bits  = _scan_neon_mask( match );
+
+    if( bits != 0 )
+      return i + ( __builtin_ctzll( bits ) >> 2 );
+  }
+#endif
+
+  /* remaining bytes and targets without vector instructions */
+  for( ; i < len; ++i )
+  {
+    const unsigned char c = buf[i];
+    if( c <= limit || c == 127 )
+      return i;
+  }
+
+  return len;
+}
+
+
+
+/* -- public prototypes ----------------------------------------------------------*/
+
+
+/*******************************************************************************
+ * SCAN_FindControl()
+ *                                                                         */ /*!
+ * Search for the first control character ( below 32 or DEL ), e.g. the end
+ * of a header line
+ *
+ * Function parameters
+ *     - buf:         buffer to search
+ *     - len:         number of bytes to search
+ *
+ * Returnparameter
+ *     - R: index of the first control character, len if there is none
+ *
+ *******************************************************************************/
+long SCAN_FindControl( const char* buf, const long len )
+{
+  return _scan_find( buf, len, 31 );
+}
+
+
+/*******************************************************************************
+ * SCAN_FindControlOrSpace()
+ *                                                                         */ /*!
+ * Search for the first control character or space, e.g. the end of the URI
+ * within the request line
+ *
+ * Function parameters
+ *     - buf:         buffer to search
+ *     - len:         number of bytes to search
+ *
+ * Returnparameter
+ *     - R: index of the first control character or space, len if there is none
+ *
+ *******************************************************************************/
+long SCAN_FindControlOrSpace( const char* buf, const long len )
+{
+  return _scan_find( buf, len, ' ' );
+}
+
+
+/*******************************************************************************
+ * SCAN_CaseEqual()
+ *                                                                         */ /*!
+ * Compare two strings of the same length ignoring the case of ASCII letters,
+ * unlike strncasecmp() it does not depend on the locale and does not stop
+ * at zero bytes
+ *
+ * Function parameters
+ *     - a:           first string
+ *     - b:           second string
+ *     - len:         number of bytes to compare
+ *
+ * Returnparameter
+ *     - R: true when both strings are equal, otherwise false
+ *
+ *******************************************************************************/
+int SCAN_CaseEqual( const char* a, const char* b, const long len )
+{
+  long i = 0;
+
+#if defined( __SSE2__ )
+  /* letters are moved to the bottom of the signed range, which allows
+     to detect them with one signed comparison */
+  const __m128i bias  = _mm_set1_epi8( (char) ( 0x80 - 'A' ) );
+  const __m128i range = _mm_set1_epi8( (char) ( -128 + 26 ) );
+  const __m128i bit   = _mm_set1_epi8( 'a' - 'A' );
+
+  for( ; i + 16 <= len; i += 16 )
+  {
+    __m128i va = _mm_loadu_si128( (const __m128i*) ( a + i ) );
+    __m128i vb = _mm_loadu_si128( (const __m128i*) ( b + i ) );
+
+    va = _mm_or_si128( va, _mm_and_si128( _mm_cmplt_epi8( _mm_add_epi8( va, bias ), range ), bit ) );
+    vb = _mm_or_si128( vb, _mm_and_si128( _mm_cmplt_epi8( _mm_add_epi8( vb, bias ), range ), bit ) );
+
+    if( _mm_movemask_epi8( _mm_cmpeq_epi8( va, vb ) ) != 0xFFFF )
+      return false;
+  }
+#elif defined( SCAN_USE_NEON )
+  const uint8x16_t first = vdupq_n_u8( 'A' );
+  const uint8x16_t range = vdupq_n_u8( 'Z' - 'A' );
+  const uint8x16_t bit   = vdupq_n_u8( 'a' - 'A' );
+
+  for( ; i + 16 <= len; i += 16 )
+  {
+    uint8x16_t va = vld1q_u8( (const uint8_t*) ( a + i ) );
+    uint8x16_t vb = vld1q_u8( (const uint8_t*) ( b + i ) );
+
+    va = vorrq_u8( va, vandq_u8( vcleq_u8( vsubq_u8( va, first ), range ), bit ) );
+    vb = vorrq_u8( vb, vandq_u8( vcleq_u8( vsubq_u8( vb, first ), range ), bit ) );
+
+    if( _scan_neon_mask( vceqq_u8( va, vb ) ) != UINT64_MAX )
+      return false;
+  }
+#endif
+
+  for( ; i < len; ++i )
+  {
+    if( _scan_fold( (unsigned char) a[i] ) != _scan_fold( (unsigned char) b[i] ) )
+      return false;
+  }
+
+  return true;
+}
+
+
+/*******************************************************************************
+ * SCAN_FindString()
+ *                                                                         */ /*!
+ * Search for the first occurrence of a string, e.g. a multipart boundary.
+ * Candidates are positions where the first and the last byte of the
+ * string match, only they are compared completely.
+ *
+ * Function parameters
+ *     - buf:         buffer to search
+ *     - len:         number of bytes to search
+ *     - str:         string to search for, does not need to be zero terminated
+ *     - str_len:     length of str, at least 1
+ *
+ * Returnparameter
+ *     - R: index of the first occurrence, len if there is none
+ *
+ *******************************************************************************/
+long SCAN_FindString( const char* buf, const long len, const char* str, const long str_len )
+{
+  const long  last = len - str_len;   /* last position where str fits */
+  long        i = 0;
+
+  /* bytes between first and last one are compared for candidates only */
+#define SCAN_MATCHES( pos ) ( str_len < 3 || memcmp( buf + (pos) + 1, str + 1, str_len - 2 ) == 0 )
+
+#if defined( __AVX2__ )
+  const __m256i first32 = _mm256_set1_epi8( str[0] );
+  const __m256i last32  = _mm256_set1_epi8( str[str_len - 1] );
+
+  for( ; i + 32 <= last + 1; i += 32 )
+  {
+    const __m256i vf   = _mm256_loadu_si256( (const __m256i*) ( buf + i ) );
+    const __m256i vl   = _mm256_loadu_si256( (const __m256i*) ( buf + i + str_len - 1 ) );
+    unsigned int  bits = _mm256_movemask_epi8( 
+      _mm256_and_si256( _mm256_cmpeq_epi8( vf, first32 ), _mm256_cmpeq_epi8( vl, last32 ) ) );
+
+    for( ; bits != 0; bits &= bits - 1 )
+    {
+      if( SCAN_MATCHES( i + __builtin_ctz( bits ) ) )
+        return i + __builtin_ctz( bits );
+    }
+  }
+#endif
+
+#if defined( __SSE2__ )
+  const __m128i first16 = _mm_set1_epi8( str[0] );
+  const __m128i last16  = _mm_set1_epi8( str[str_len - 1] );
+
+  for( ; i + 16 <= last + 1; i += 16 )
+  {
+    const __m128i vf   = _mm_loadu_si128( (const __m128i*) ( buf + i ) );
+    const __m128i vl   = _mm_loadu_si128( (const __m128i*) ( buf + i + str_len - 1 ) );
+    unsigned int  bits = _mm_movemask_epi8( 
+      _mm_and_si128( _mm_cmpeq_epi8( vf, first16 ), _mm_cmpeq_epi8( vl, last16 ) ) );
+
+    for( ; bits != 0; bits &= bits - 1 )
+    {
+      if( SCAN_MATCHES( i + __builtin_ctz( bits ) ) )
+        return i + __builtin_ctz( bits );
+    }
+  }
+#elif defined( SCAN_USE_NEON )
+  const uint8x16_t first16 = vdupq_n_u8( str[0] );
+  const uint8x16_t last16  = vdupq_n_u8( str[str_len - 1] );
+
+  for( ; i + 16 <= last + 1; i += 16 )
+  {
+    const uint8x16_t vf   = vld1q_u8( (const uint8_t*) ( buf + i ) );
+    const uint8x16_t vl   = vld1q_u8( (const uint8_t*) ( buf + i + str_len - 1 ) );
+    uint64_t         bits = _scan_neon_mask( vandq_u8( vceqq_u8( vf, first16 ), vceqq_u8( vl, last16 ) ) );
+
+    /* 4 bits per byte, the lowest one of each group is tested */
+    for( bits &= 0x1111111111111111ull; bits != 0; bits &= bits - 1 )
+    {
+      if( SCAN_MATCHES( i + ( __builtin_ctzll( bits ) >> 2 ) ) )
+        return i + ( __builtin_ctzll( bits ) >> 2 );
+    }
+  }
+#endif
+
+  /* remaining positions and targets without vector instructions */
+  for( ; i <= last; ++i )
+  {
+    if( buf[i] == str[0] && buf[i + str_len - 1] == str[str_len - 1] && SCAN_MATCHES( i ) )
+      return i;
+  }
+
+#undef SCAN_MATCHES
+
+  return len;
+}
@@ -0,0 +1,93 @@
+/*
+ *  scan.h
+ *  idefix
+ *
+ *  byte scanning kernels of the request parser, vectorised with
+ *  SSE2 / AVX2 on x86 and NEON on ARM. The instruction set is chosen
+ *  at compile time, portable scalar code is used for other targets.
+ *
+ *  Copyright 2010 GNU General Public Licence. All rights reserved.
+ *
+ */
+
+#ifndef _SCAN_H
+#define _SCAN_H
+
+
+/* -- public prototypes ----------------------------------------------------------*/
+
+
+/*******************************************************************************
+ * SCAN_FindControl()
+ *                                                                         */ /*!
+ * Search for the first control character ( below 32 or DEL ), e.g. the end
+ * of a header line
+ *
+ * Function parameters
+ *     - buf:         buffer to search
+ *     - len:         number of bytes to search
+ *
+ * Returnparameter
+ *     - R: index of the first control character, len if there is none
+ *
+ *******************************************************************************/
+long SCAN_FindControl( const char* buf, const long len );
+
+
+/*******************************************************************************
+ * SCAN_FindControlOrSpace()
+ *                                                                         */ /*!
+ * Search for the first control character or space, e.g. the end of the URI
+ * within the request line
+ *
+ * Function parameters
+ *     - buf:         buffer to search
+ *     - len:         number of bytes to search
+ *
+ * Returnparameter
+ *     - R: index of the first control character or space, len if there is none
+ *
+ *******************************************************************************/
+long SCAN_FindControlOrSpace( const char* buf, const long len );
+
+
+/*******************************************************************************
+ * SCAN_CaseEqual()
+ *                                                                         */ /*!
+ * Compare two strings of the same length ignoring the case of ASCII letters,
+ * unlike strncasecmp() it does not depend on the locale and does not stop
+ * at zero bytes
+ *
+ * Function parameters
+ *     - a:           first string
+ *     - b:           second string
+ *     - len:         number of bytes to compare
+ *
+ * Returnparameter
+ *     - R: true when both strings are equal, otherwise false
+ *
+ *******************************************************************************/
+int SCAN_CaseEqual( const char* a, const char* b, const long len );
+
+
+/*******************************************************************************
+ * SCAN_FindString()
+ *                                                                         */ /*!
+ * Search for the first occurrence of a string, e.g. a multipart boundary.
+ * Candidates are positions where the first and the last byte of the
+ * string match, only they are compared completely.
+ *
+ * Function parameters
+ *     - buf:         buffer to search
+ *     - len:         number of bytes to search
+ *     - str:         string to search for, does not need to be zero terminated
+ *     - str_len:     length of str, at least 1
+ *
+ * Returnparameter
+ *     - R: index of the first occurrence, len if there is none
+ *
+ *******************************************************************************/
+long SCAN_FindString( const char* buf, const long len, const char* str, const long str_len );
+
+
+#endif /* #ifndef _SCAN_H */
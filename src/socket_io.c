@@ -13,6 +13,12 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <poll.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <string.h>
+#include "socket_io.h"
 
 
 /*******************************************************************************
@@ -36,9 +42,20 @@ long http_send_all( int socket, const void* buffer, long length, int flags )
     int bytesleft = length; /* how many we have left to send */
     int n;
 
+    struct pollfd pfd;
+
     while(total < length) {
         n = send( socket, buffer + total, bytesleft, flags );
-        if (n == -1) { break; }
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) break;
+
+            /* non-blocking socket is full, wait until peer has taken data */
+            pfd.fd = socket;
+            pfd.events = POLLOUT;
+            if (poll( &pfd, 1, HTTP_SND_TIME_OUT * 1000 ) <= 0) break;
+            continue;
+        }
         total += n;
         bytesleft -= n;
     }
@@ -89,6 +106,266 @@ long http_recv_timedout( int socket, void* buffer, long length,
     if (n == -1) return -1; // error
 
     /* data must be here, so do a normal recv() */
-    return recv( socket, buffer, length, 0);
+    return recv( socket, buffer, length, flags );
 }
 
+
+
+
+/*******************************************************************************
+ * http_send_nowait() 
+ *                                                                         */ /*!
+ * adapter function for sending as many bytes as the socket accepts 
+ * without blocking
+ *                                                                              
+ * Function parameters
+ *     - socket:    socket to send to
+ *     - buffer:    buffer with bytes to send
+ *     - length:    number of bytes to send
+ *     - flags:     transfered to original UNIX send call
+ *    
+ * Returnparameter
+ *     - R:         number of transmitted bytes, 0 when the socket would block
+ *                  or -1 in case of error
+ * 
+ *******************************************************************************/
+long http_send_nowait( int socket, const void* buffer, long length, int flags ) 
+{
+    long total = 0;
+    long n;
+
+    while(total < length) {
+        n = send( socket, buffer + total, length - total, flags | MSG_DONTWAIT );
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return HTTP_IO_ERROR;
+        }
+        total += n;
+    }
+
+    return total; 
+}
+
+
+
+/*******************************************************************************
+ * http_recv_nowait() 
+ *                                                                         */ /*!
+ * adapter function for receiving already available data without blocking
+ *                                                                              
+ * Function parameters
+ *     - socket:    socket to receive from
+ *     - buffer:    buffer where received bytes are stored to
+ *     - length:    maximum number of bytes to receive
+ *     - flags:     transfered to original UNIX recv call
+ *    
+ * Returnparameter
+ *     - R:         number of received bytes, 0 when peer closed connection,
+ *                  -3 when no data is available or -1 in case of other error
+ * 
+ *******************************************************************************/
+long http_recv_nowait( int socket, void* buffer, long length, int flags )
+{
+    long n;
+
+    do {
+        n = recv( socket, buffer, length, flags | MSG_DONTWAIT );
+    } while (n == -1 && errno == EINTR);
+
+    if (n == -1)
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? HTTP_IO_AGAIN : HTTP_IO_ERROR;
+
+    return n;
+}
+
+
+
+/*!
+ *  transmit several buffers by one sendmsg call each round,
+ *  waits for the peer when wait is not zero
+ */
+static long _http_sendv( int socket, const struct iovec* iov, int iovcnt, int flags, int wait )
+{
+    struct iovec    vec[HTTP_MAX_IOV];
+    struct msghdr   msg;
+    struct pollfd   pfd;
+    long            total = 0, length = 0;
+    ssize_t         n;
+    int             i, first = 0;
+
+    if (iovcnt > HTTP_MAX_IOV) return HTTP_IO_ERROR;
+
+    for (i = 0; i < iovcnt; ++i) {
+        vec[i] = iov[i];
+        length += iov[i].iov_len;
+    }
+
+    while (total < length) {
+        memset( &msg, 0, sizeof(msg) );
+        msg.msg_iov = &vec[first];
+        msg.msg_iovlen = iovcnt - first;
+
+        n = sendmsg( socket, &msg, flags | MSG_DONTWAIT );
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                return total > 0 ? total : HTTP_IO_ERROR;
+            if (!wait) break;
+
+            /* socket is full, wait until peer has taken data */
+            pfd.fd = socket;
+            pfd.events = POLLOUT;
+            if (poll( &pfd, 1, HTTP_SND_TIME_OUT * 1000 ) <= 0) break;
+            continue;
+        }
+
+        /* skip transmitted buffers */
+        total += n;
+        while (first < iovcnt && (size_t) n >= vec[first].iov_len) {
+            n -= vec[first].iov_len;
+            ++first;
+        }
+        if (first < iovcnt) {
+            vec[first].iov_base = (char *) vec[first].iov_base + n;
+            vec[first].iov_len -= n;
+        }
+    }
+
+    return total;
+}
+
+
+
+/*******************************************************************************
+ * http_sendv_all() 
+ *                                                                         */ /*!
+ * adapter function for sending out ALL bytes of several buffers
+ *                                                                              
+ * Function parameters
+ *     - socket:    socket to send to
+ *     - iov:       buffers with bytes to send
+ *     - iovcnt:    number of buffers
+ *     - flags:     transfered to original UNIX sendmsg call
+ *    
+ * Returnparameter
+ *     - R:         number of successfully transmitted bytes
+ * 
+ *******************************************************************************/
+long http_sendv_all( int socket, const struct iovec* iov, int iovcnt, int flags )
+{
+    long n = _http_sendv( socket, iov, iovcnt, flags, 1 );
+
+    return ( n < 0 ) ? 0 : n;
+}
+
+
+
+/*******************************************************************************
+ * http_sendv_nowait() 
+ *                                                                         */ /*!
+ * adapter function for sending as many bytes of several buffers as the 
+ * socket accepts without blocking
+ *                                                                              
+ * Function parameters
+ *     - socket:    socket to send to
+ *     - iov:       buffers with bytes to send
+ *     - iovcnt:    number of buffers
+ *     - flags:     transfered to original UNIX sendmsg call
+ *    
+ * Returnparameter
+ *     - R:         number of transmitted bytes, 0 when the socket would block
+ *                  or -1 in case of error
+ * 
+ *******************************************************************************/
+long http_sendv_nowait( int socket, const struct iovec* iov, int iovcnt, int flags )
+{
+    return _http_sendv( socket, iov, iovcnt, flags, 0 );
+}
+
+
+
+/*!
+ *  transmit file section by sendfile, returns number of transmitted
+ *  bytes and HTTP_IO_UNSUPPORTED when sendfile cannot be used
+ */
+static long _http_sendfile( int socket, int fd, long offset, long length, int wait )
+{
+    off_t   pos = offset;
+    long    total = 0;
+    ssize_t n;
+    struct pollfd pfd;
+
+    while (total < length) {
+        n = sendfile( socket, fd, &pos, length - total );
+        if (n > 0) {
+            total += n;
+            continue;
+        }
+        if (n == 0)                 /* file is shorter than expected */
+            return total > 0 ? total : HTTP_IO_ERROR;
+        if (errno == EINTR) continue;
+        if ((errno == EINVAL || errno == ENOSYS) && total == 0)
+            return HTTP_IO_UNSUPPORTED;
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            return total > 0 ? total : HTTP_IO_ERROR;
+        if (!wait) break;
+
+        /* non-blocking socket is full, wait until peer has taken data */
+        pfd.fd = socket;
+        pfd.events = POLLOUT;
+        if (poll( &pfd, 1, HTTP_SND_TIME_OUT * 1000 ) <= 0) break;
+    }
+
+    return total;
+}
+
+
+
+/*******************************************************************************
+ * http_sendfile_all() 
+ *                                                                         */ /*!
+ * adapter function for sending out ALL bytes of a file section
+ *                                                                              
+ * Function parameters
+ *     - socket:    socket to send to
+ *     - fd:        file descriptor of file to transmit
+ *     - offset:    file position of first byte to send
+ *     - length:    number of bytes to send
+ *    
+ * Returnparameter
+ *     - R:         number of successfully transmitted bytes or -4 when
+ *                  file or socket does not support sendfile at all
+ * 
+ *******************************************************************************/
+long http_sendfile_all( int socket, int fd, long offset, long length )
+{
+    long n = _http_sendfile( socket, fd, offset, length, 1 );
+
+    return ( n == HTTP_IO_ERROR ) ? 0 : n;
+}
+
+
+
+/*******************************************************************************
+ * http_sendfile_nowait() 
+ *                                                                         */ /*!
+ * adapter function for sending as many bytes of a file section as the
+ * socket accepts without blocking
+ *                                                                              
+ * Function parameters
+ *     - socket:    socket to send to
+ *     - fd:        file descriptor of file to transmit
+ *     - offset:    file position of first byte to send
+ *     - length:    number of bytes to send
+ *    
+ * Returnparameter
+ *     - R:         number of transmitted bytes, 0 when the socket would block,
+ *                  -4 when file or socket does not support sendfile at all
+ *                  or -1 in case of other error
+ * 
+ *******************************************************************************/
+long http_sendfile_nowait( int socket, int fd, long offset, long length )
+{
+    return _http_sendfile( socket, fd, offset, length, 0 );
+}
@@ -13,12 +13,36 @@
 #ifndef _SOCKET_IO
 #define _SOCKET_IO
 
+#include <sys/socket.h>
+#include <sys/uio.h>
+
 /*!
  *  Time out when waiting for incoming data
  */
 #define HTTP_RCV_TIME_OUT           3
 
 
+/*!
+ *  Time out when waiting for the peer to accept outgoing data
+ */
+#define HTTP_SND_TIME_OUT           3
+
+
+/*!
+ *  Maximum number of buffers transmitted by one HTTP_SOCKET_SENDV call
+ */
+#define HTTP_MAX_IOV                8
+
+
+/*
+ *  Return codes of the adapter functions below in case of failure
+ */
+#define HTTP_IO_ERROR               -1
+#define HTTP_IO_TIMEOUT             -2
+#define HTTP_IO_AGAIN               -3
+#define HTTP_IO_UNSUPPORTED         -4
+
+
 /*
  *  Abstraction from UNIX funciton send
  *  Can be replaced against any other function for sending bytes 
@@ -35,6 +59,39 @@
 #define HTTP_SOCKET_RECV( socket, buffer, len )        http_recv_timedout( (socket), (buffer), (len), 0, HTTP_RCV_TIME_OUT ) 
 
 
+/*
+ *  Non-blocking variants of the above used when served from an event loop,
+ *  they return immediately when the socket is not ready
+ */
+#define HTTP_SOCKET_SEND_NOWAIT( socket, buffer, len ) http_send_nowait( (socket), (buffer), (len), 0 ) 
+#define HTTP_SOCKET_RECV_NOWAIT( socket, buffer, len ) http_recv_nowait( (socket), (buffer), (len), 0 ) 
+
+
+/*
+ *  Variants of the above telling the transport that more data follows
+ *  immediately, in order to avoid sending out small TCP segments
+ */
+#define HTTP_SOCKET_SEND_MORE( socket, buffer, len )        http_send_all( (socket), (buffer), (len), MSG_MORE ) 
+#define HTTP_SOCKET_SEND_MORE_NOWAIT( socket, buffer, len ) http_send_nowait( (socket), (buffer), (len), MSG_MORE ) 
+
+
+/*
+ *  Abstraction from UNIX function writev, sends several buffers at once
+ */
+#define HTTP_SOCKET_SENDV( socket, iov, iovcnt )        http_sendv_all( (socket), (iov), (iovcnt), 0 ) 
+#define HTTP_SOCKET_SENDV_NOWAIT( socket, iov, iovcnt ) http_sendv_nowait( (socket), (iov), (iovcnt), 0 ) 
+
+
+/*
+ *  Abstraction from Linux function sendfile, transmits file content
+ *  without copying it through user space. Remove these definitions
+ *  when the transport ( e.g. a serial line ) cannot take a file 
+ *  descriptor, static content is copied blockwise then.
+ */
+#define HTTP_SOCKET_SENDFILE( socket, fd, offset, len )        http_sendfile_all( (socket), (fd), (offset), (len) ) 
+#define HTTP_SOCKET_SENDFILE_NOWAIT( socket, fd, offset, len ) http_sendfile_nowait( (socket), (fd), (offset), (len) ) 
+
+
 
 
 /*******************************************************************************
@@ -79,5 +136,128 @@ long http_recv_timedout( int socket, void* buffer, long length,
 
 
 
+/*******************************************************************************
+ * http_send_nowait() 
+ *                                                                         */ /*!
+ * adapter function for sending as many bytes as the socket accepts 
+ * without blocking
+ *                                                                              
+ * Function parameters
+ *     - socket:    socket to send to
+ *     - buffer:    buffer with bytes to send
+ *     - length:    number of bytes to send
+ *     - flags:     transfered to original UNIX send call
+ *    
+ * Returnparameter
+ *     - R:         number of transmitted bytes, 0 when the socket would block
+ *                  or -1 in case of error
+ * 
+ *******************************************************************************/
+long http_send_nowait( int socket, const void* buffer, long length, int flags );
+
+
+
+/*******************************************************************************
+ * http_recv_nowait() 
+ *                                                                         */ /*!
+ * adapter function for receiving already available data without blocking
+ *                                                                              
+ * Function parameters
+ *     - socket:    socket to receive from
+ *     - buffer:    buffer where received bytes are stored to
+ *     - length:    maximum number of bytes to receive
+ *     - flags:     transfered to original UNIX recv call
+ *    
+ * Returnparameter
+ *     - R:         number of received bytes, 0 when peer closed connection,
+ *                  -3 when no data is available or -1 in case of other error
+ * 
+ *******************************************************************************/
+long http_recv_nowait( int socket, void* buffer, long length, int flags );
+
+
+
+/*******************************************************************************
+ * http_sendv_all() 
+ *                                                                         */ /*!
+ * adapter function for sending out ALL bytes of several buffers
+ *                                                                              
+ * Function parameters
+ *     - socket:    socket to send to
+ *     - iov:       buffers with bytes to send
+ *     - iovcnt:    number of buffers
+ *     - flags:     transfered to original UNIX sendmsg call
+ *    
+ * Returnparameter
+ *     - R:         number of successfully transmitted bytes
+ * 
+ *******************************************************************************/
+long http_sendv_all( int socket, const struct iovec* iov, int iovcnt, int flags );
+
+
+
+/*******************************************************************************
+ * http_sendv_nowait() 
+ *                                                                         */ /*!
+ * adapter function for sending as many bytes of several buffers as the 
+ * socket accepts without blocking
+ *                                                                              
+ * Function parameters
+ *     - socket:    socket to send to
+ *     - iov:       buffers with bytes to send
+ *     - iovcnt:    number of buffers
+ *     - flags:     transfered to original UNIX sendmsg call
+ *    
+ * Returnparameter
+ *     - R:         number of transmitted bytes, 0 when the socket would block
+ *                  or -1 in case of error
+ * 
+ *******************************************************************************/
+long http_sendv_nowait( int socket, const struct iovec* iov, int iovcnt, int flags );
+
+
+
+/*******************************************************************************
+ * http_sendfile_all() 
+ *                                                                         */ /*!
+ * adapter function for sending out ALL bytes of a file section
+ *                                                                              
+ * Function parameters
+ *     - socket:    socket to send to
+ *     - fd:        file descriptor of file to transmit
+ *     - offset:    file position of first byte to send
+ *     - length:    number of bytes to send
+ *    
+ * Returnparameter
+ *     - R:         number of successfully transmitted bytes or -4 when
+ *                  file or socket does not support sendfile at all
+ * 
+ *******************************************************************************/
+long http_sendfile_all( int socket, int fd, long offset, long length );
+
+
+
+/*******************************************************************************
+ * http_sendfile_nowait() 
+ *                                                                         */ /*!
+ * adapter function for sending as many bytes of a file section as the
+ * socket accepts without blocking
+ *                                                                              
+ * Function parameters
+ *     - socket:    socket to send to
+ *     - fd:        file descriptor of file to transmit
+ *     - offset:    file position of first byte to send
+ *     - length:    number of bytes to send
+ *    
+ * Returnparameter
+ *     - R:         number of transmitted bytes, 0 when the socket would block,
+ *                  -4 when file or socket does not support sendfile at all
+ *                  or -1 in case of other error
+ * 
+ *******************************************************************************/
+long http_sendfile_nowait( int socket, int fd, long offset, long length );
+
+
+
 
 #endif
@@ -9,6 +9,8 @@
 
 /* -- includes -------------------------------------------------------------------*/
 
+#define _GNU_SOURCE     /* for CPU affinity */
+
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -16,116 +18,1436 @@
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <stdbool.h>
+#include <sys/epoll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/wait.h>
+#ifdef HTTP_USE_IO_URING
+#include <stdint.h>
+#include <liburing.h>
+#endif
 
 #include "http.h"
 #include "socket_io.h"
 #include "objmem.h"
 #include "cgi.h"
+#include "timerwheel.h"
+#include "sockserver.h"
 
-/* -- public prototypes ----------------------------------------------------------*/
+/* -- const definitions -----------------------------------------------------------*/
 
 
-/*******************************************************************************
- * service_socket_loop() 
- *                                                                         */ /*!
- * Reads incoming HTTP requests from socket, and reacts appropriately
- *
- * Function parameters
- *     - ht_root_dir: root directory for static web content 
- *     - port:        port the server is listening to
- *
- * Returnparameter
- *     - R: 0 in case of success, otherwise error code
- * 
- *******************************************************************************/
-int service_socket_loop( const char* ht_root_dir, const int port ) 
+/*!
+ *  Maximum number of simultaneously served client connections
+ */
+#define SOCK_MAX_CONNECTIONS        4096
+
+
+/*!
+ *  Maximum number of events handled per epoll_wait() call
+ */
+#define SOCK_MAX_EVENTS             64
+
+
+/*!
+ *  Length of the queue for pending connections
+ */
+#define SOCK_LISTEN_BACKLOG         128
+
+
+/*!
+ *  Time in seconds after which a connection is dropped when a request 
+ *  is received or answered without any i/o progress
+ */
+#define SOCK_IO_TIME_OUT            HTTP_RCV_TIME_OUT
+
+
+/*!
+ *  Resolution of the connection timers
+ */
+#define SOCK_TICKS_PER_SEC          4
+
+
+/*!
+ *  A worker process crashing within this number of seconds after its start
+ *  is restarted with a delay of one second, doubled for each further crash
+ */
+#define SOCK_WORKER_MIN_UPTIME      10
+
+
+/*!
+ *  Number of crashes in a row after which a worker process is not restarted
+ */
+#define SOCK_WORKER_MAX_RESTARTS    5
+
+
+#ifdef HTTP_USE_IO_URING
+
+/*!
+ *  Number of submission queue entries of each worker's io_uring
+ */
+#define SOCK_URING_ENTRIES          1024
+
+
+/*!
+ *  Maximum number of bytes spliced at once, default capacity of a pipe
+ */
+#define SOCK_SPLICE_CHUNK           65536
+
+
+/*!
+ *  Operation encoded in the lower bits of the submission's user data, 
+ *  the upper bits keep the connection's address
+ */
+#define SOCK_OP_ACCEPT              0
+#define SOCK_OP_RECV                1
+#define SOCK_OP_SEND                2
+#define SOCK_OP_SPLICE_IN           3
+#define SOCK_OP_SPLICE_OUT          4
+#define SOCK_OP_MASK                7
+
+#endif /* #ifdef HTTP_USE_IO_URING */
+
+
+/* -- local types ---------------------------------------------------------------*/
+
+
+/*
+ *  Client connection, each one keeps its own HTTP object
+ *  with its own receive and transmit state
+ */
+typedef struct _SOCK_CONN
+{
+  HTTP_OBJ              http_obj;       /* request processing state */
+  int                   socket;         /* client socket, -1 when unused */
+  int                   responding;     /* response is being transmitted */
+  TIMER_NODE            timer;          /* drops the connection when expired */
+  unsigned long         end_of_life;    /* tick when the connection is not kept alive anymore */
+#ifdef HTTP_USE_IO_URING
+  int                   index;          /* slot of registered socket and buffers */
+  int                   fixed;          /* socket is registered with the ring */
+  int                   registered;     /* buffers of the HTTP object are registered */
+  int                   inflight;       /* number of submitted but not completed operations */
+  int                   closing;        /* close as soon as all operations are completed */
+  int                   pipe_fd[2];     /* pipe for splicing static content, -1 if not created */
+  long                  pipe_len;       /* number of bytes of static content within the pipe */
+#endif
+  struct _SOCK_CONN*    prev;           /* double linked list of active connections */
+  struct _SOCK_CONN*    next;           /* resp. single linked list of free connections */
+} SOCK_CONN;
+
+
+/*
+ *  Event loop instance, one per worker thread
+ */
+typedef struct
+{
+  const SOCK_CONFIG* config;            /* server configuration */
+  int           reuse_port;             /* several listening sockets share the port */
+  const HTTP_OBJ* cgi_handlers;         /* shared read-only CGI handler table */
+  FILECACHE*    file_cache;             /* shared static content cache, NULL if disabled */
+  PACK_STORE*   pack_store;             /* shared content pack, NULL if none */
+  pthread_t     thread;                 /* worker thread */
+  int           epoll_fd;               /* epoll instance, -1 when served by io_uring */
+  int           listen_socket;          /* socket for accepting new clients */
+  SOCK_CONN*    active_list;            /* connections currently served */
+  SOCK_CONN*    free_list;              /* initialized connections for reuse */
+  int           nr_connections;         /* number of allocated connections */
+  TIMER_WHEEL   timers;                 /* idle and i/o timeouts of all connections */
+#ifdef HTTP_USE_IO_URING
+  struct io_uring ring;                 /* submission and completion queues */
+  int           fixed_files;            /* table of registered sockets has been set up */
+  int           fixed_buffers;          /* table of registered buffers has been set up */
+  int           multishot_accept;       /* one accept submission serves all connections */
+#endif
+} SOCK_SERVER;
+
+
+/* -- local functions -------------------------------------------------------------*/
+
+
+/*!
+ *  monotonic time in timer ticks
+ */
+static unsigned long _sock_ticks( void )
+{
+  struct timespec now;
+
+  clock_gettime( CLOCK_MONOTONIC, &now );
+  return (unsigned long) now.tv_sec * SOCK_TICKS_PER_SEC + now.tv_nsec / ( 1000000000L / SOCK_TICKS_PER_SEC );
+}
+
+
+/*!
+ *  put socket into non-blocking mode
+ */
+static int _sock_set_nonblocking( int socket )
+{
+  int flags = fcntl( socket, F_GETFL, 0 );
+
+  if( flags < 0 )
+    return flags;
+
+  return fcntl( socket, F_SETFL, flags | O_NONBLOCK );
+}
+
+
+/*!
+ *  get connection from free list or allocate and initialize a new one
+ */
+static SOCK_CONN* _sock_conn_alloc( SOCK_SERVER* server )
+{
+  SOCK_CONN*  conn = server->free_list;
+  int         error;
+
+  if( conn != NULL )
+  {
+    server->free_list = conn->next;
+  }
+  else 
+  {
+    if( server->nr_connections >= SOCK_MAX_CONNECTIONS )
+      return NULL;
+
+    conn = malloc( sizeof( SOCK_CONN ) );
+    if( conn == NULL )
+      return NULL;
+
+    /* intialize HTTP object, it serves requests with the shared CGI handlers */
+    error = HTTP_ObjInit( & conn->http_obj, HTML_SERVER_NAME, server->config->ht_root_dir, server->config->port );
+    if( ! error )
+    {
+      HTTP_ShareCgiHandlers( & conn->http_obj, server->cgi_handlers );
+      conn->http_obj.file_cache = server->file_cache;
+      conn->http_obj.pack_store = server->pack_store;
+    }
+
+    if( error )
+    {
+      fprintf( stderr, "Could not initialize connection error: %s!\n", HTTP_GetErrorMsg( error ) );
+      free( conn );
+      return NULL;
+    }
+
+    TIMER_Init( & conn->timer );
+#ifdef HTTP_USE_IO_URING
+    conn->index       = server->nr_connections;
+    conn->fixed       = false;
+    conn->registered  = false;
+    conn->inflight    = 0;
+    conn->closing     = false;
+    conn->pipe_fd[0]  = conn->pipe_fd[1] = -1;
+    conn->pipe_len    = 0;
+#endif
+    ++server->nr_connections;
+  }
+
+  /* insert into list of active connections */
+  conn->prev = NULL;
+  conn->next = server->active_list;
+  if( conn->next != NULL )
+    conn->next->prev = conn;
+  server->active_list = conn;
+
+  return conn;
+}
+
+
+/*!
+ *  close client socket and move connection to free list
+ */
+static void _sock_conn_close( SOCK_SERVER* server, SOCK_CONN* conn )
 {
-  HTTP_OBJ            http_obj;           /* HTTP thread's object, we keep it on the stack here */
-  HTTP_OBJ*           this = & http_obj;
+#ifdef HTTP_USE_IO_URING
+  int unused = -1;
+#endif
+
+  TIMER_Cancel( & conn->timer );
+
+#ifdef HTTP_USE_IO_URING
+  /* submitted operations still refer to the connection, let them fail first */
+  if( conn->inflight > 0 )
+  {
+    if( ! conn->closing )
+      shutdown( conn->socket, SHUT_RDWR );
+    conn->closing = true;
+    return;
+  }
+  conn->closing = false;
+
+  if( conn->fixed )
+  {
+    io_uring_register_files_update( & server->ring, conn->index + 1, &unused, 1 );
+    conn->fixed = false;
+  }
+
+  /* the pipe might still keep parts of the response */
+  if( conn->pipe_fd[0] >= 0 )
+  {
+    close( conn->pipe_fd[0] );
+    close( conn->pipe_fd[1] );
+    conn->pipe_fd[0] = conn->pipe_fd[1] = -1;
+  }
+  conn->pipe_len = 0;
+#endif
+
+  HTTP_DetachSocket( & conn->http_obj );
+  close( conn->socket );  /* removes socket from epoll set as well */
+  conn->socket = -1;
   
-  int                 create_socket, new_socket;
-  socklen_t           addrlen;
+  /* remove from list of active connections */
+  if( conn->prev != NULL )
+    conn->prev->next = conn->next;
+  else
+    server->active_list = conn->next;
+  if( conn->next != NULL )
+    conn->next->prev = conn->prev;
+
+  conn->next = server->free_list;
+  server->free_list = conn;
+}
+
+
+/*!
+ *  assign accepted client socket to a connection and supervise it
+ */
+static void _sock_conn_attach( SOCK_SERVER* server, SOCK_CONN* conn, const int socket, const int io_mode )
+{
+  conn->socket        = socket;
+  conn->responding    = false;
+  conn->end_of_life   = server->timers.now + server->config->max_conn_time * SOCK_TICKS_PER_SEC;
+  HTTP_AttachSocket( & conn->http_obj, socket, io_mode );
+  if( server->config->keep_alive_timeout <= 0 )
+    conn->http_obj.keep_alive_enabled = false;
+
+  /* the first request is expected right away */
+  TIMER_Set( & server->timers, & conn->timer, server->timers.now + SOCK_IO_TIME_OUT * SOCK_TICKS_PER_SEC );
+}
+
+
+/*!
+ *  accept all pending client connections
+ */
+static void _sock_accept( SOCK_SERVER* server )
+{
   struct sockaddr_in  address;
-  const int           y = 1;
+  socklen_t           addrlen;
+  struct epoll_event  ev;
+  SOCK_CONN*          conn;
+  int                 new_socket;
+
+  for( ;; )
+  {
+    addrlen = sizeof( struct sockaddr_in );
+    new_socket = accept( server->listen_socket, (struct sockaddr *) &address, &addrlen );
+    if( new_socket < 0 )
+    {
+      if( errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR )
+        perror( "accept" );
+      if( errno != EINTR )
+        break;
+      continue;
+    }
+
+    if( _sock_set_nonblocking( new_socket ) < 0 )
+    {
+      fprintf( stderr, "Could not set client socket (%s) nonblocking, error: %s, reject!\n",
+               inet_ntoa( address.sin_addr ), strerror( errno ) );
+      close( new_socket );
+      continue;
+    }
+
+    conn = _sock_conn_alloc( server );
+    if( conn == NULL )
+    {
+      fprintf( stderr, "Too many client connections, reject (%s)!\n", inet_ntoa( address.sin_addr ) );
+      close( new_socket );
+      continue;
+    }
+
+    printf ("Client (%s) is connected!\n", inet_ntoa (address.sin_addr));
+
+    _sock_conn_attach( server, conn, new_socket, HTTP_IO_NONBLOCKING );
+
+    /* edge triggered, we are always reading and writing until the socket runs dry */
+    ev.events   = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = conn;
+    if( epoll_ctl( server->epoll_fd, EPOLL_CTL_ADD, new_socket, &ev ) < 0 )
+    {
+      perror( "epoll_ctl" );
+      _sock_conn_close( server, conn );
+    }
+  }
+}
+
+
+/*!
+ *  process a completely received request, the response is queued
+ */
+static void _sock_process_request( SOCK_SERVER* server, SOCK_CONN* conn )
+{
+  HTTP_OBJ*           this   = & conn->http_obj;
+  const SOCK_CONFIG*  config = server->config;
   int                 error;
-  
-  /* intialize HTTP object */
-  if( ( error = HTTP_ObjInit( this, HTML_SERVER_NAME, ht_root_dir, port ) ) != 0 )
+
+  /* answer it with Connection: close when the connection is too old */
+  if( config->max_conn_time > 0 && (long) ( server->timers.now - conn->end_of_life ) >= 0 )
+    this->keep_alive_enabled = false;
+
+  /* the response, error responses as well, is transmitted afterwards */
+  error = HTTP_ProcessRequest( this );
+  if( error < 0 )
   {
-    fprintf( stderr, "Could not create buffer error!\n" );
-    return error;
+    fprintf( stderr, 
+      "Error while rocessing of http request occured:\n\t%s!\n",
+      HTTP_GetErrorMsg(error) 
+      );
+
+    /* a complete 404 response has been generated, otherwise it might be truncated */
+    if( error != HTTP_FILE_NOT_FOUND )
+      this->keep_alive = false;
   }
+  conn->responding = true;
+}
 
-  /* register CGI handlers (cgi.c) */
-  if( ( error = RegisterCgiHandlers( this ) ) != 0 )
+
+/*!
+ *  (re)arm timer while waiting for a further request or for i/o progress of the current one
+ */
+static void _sock_conn_wait( SOCK_SERVER* server, SOCK_CONN* conn )
+{
+  const SOCK_CONFIG*  config = server->config;
+  const unsigned long now    = server->timers.now;
+  unsigned long       expires;
+
+  if( conn->responding || conn->http_obj.rcv_len > 0 )
   {
-    fprintf( stderr, "Could not register CGI handlers!\n" );
-    return error;    
+    expires = now + SOCK_IO_TIME_OUT * SOCK_TICKS_PER_SEC;
+  }
+  else
+  {
+    expires = now + config->keep_alive_timeout * SOCK_TICKS_PER_SEC;
+    if( config->max_conn_time > 0 && (long) ( expires - conn->end_of_life ) > 0 )
+      expires = conn->end_of_life;
   }
+  TIMER_Set( & server->timers, & conn->timer, expires );
+}
+
+
+/*!
+ *  advance receive, processing and transmit state of a connection
+ *  as far as possible without blocking
+ */
+static void _sock_serve( SOCK_SERVER* server, SOCK_CONN* conn )
+{
+  HTTP_OBJ*   this  = & conn->http_obj;
+  int         error = HTTP_OK;
 
-  /* create socket */ 
-  printf("Server Started\n");
-  if ((create_socket = socket (AF_INET, SOCK_STREAM, 0)) > 0)
+  while( error == HTTP_OK )
   {
-    printf ( "Socket successfully created\n" );
+    /* complete transmission of current response first */
+    if( conn->responding )
+    {
+      error = HTTP_SendPending( this );
+      if( error != HTTP_OK )
+        break;
+
+      conn->responding = false;
+      if( ! this->keep_alive )
+      {
+        error = HTTP_CONNECTION_CLOSED;
+        break;
+      }
+    }
+
+    /* read next request */
+    error = HTTP_ReceiveRequest( this );
+    if( error != HTTP_OK )
+      break;
+
+    _sock_process_request( server, conn );
   }
-  else 
+
+  if( error == HTTP_PENDING )
+  {
+    _sock_conn_wait( server, conn );
+    return;
+  }
+  
+  if( error < 0 )
+  {
+    fprintf( stderr, 
+      "Error while rocessing of http request occured:\n\t%s!\n",
+      HTTP_GetErrorMsg(error) 
+      );
+  }
+
+  _sock_conn_close( server, conn );
+}
+
+
+/*!
+ *  drop connection whose idle or i/o timer expired
+ */
+static void _sock_drop_connection( TIMER_NODE* timer, void* arg )
+{
+  SOCK_SERVER*  server = (SOCK_SERVER *) arg;
+  SOCK_CONN*    conn   = (SOCK_CONN *) ( (char *) timer - offsetof( SOCK_CONN, timer ) );
+
+  if( conn->responding || conn->http_obj.rcv_len > 0 )
+    fprintf( stderr, "Drop client connection without i/o progress!\n" );
+  else
+    printf( "Close idle client connection\n" );
+
+  _sock_conn_close( server, conn );
+}
+
+
+/*!
+ *  create non-blocking socket listening to given port
+ */
+static int _sock_listen( const int port, const int reuse_port )
+{
+  struct sockaddr_in  address;
+  const int           y = 1;
+  int                 listen_socket;
+
+  if ((listen_socket = socket (AF_INET, SOCK_STREAM, 0)) <= 0)
   {
     fprintf( stderr, "Could not create socket error!\n" );
-    return create_socket;
+    return -1;
   }
 
+  setsockopt( listen_socket, SOL_SOCKET,  SO_REUSEADDR, &y, sizeof(int));
 
-  setsockopt( create_socket, SOL_SOCKET,  SO_REUSEADDR, &y, sizeof(int));
+  /* let the kernel distribute incoming connections to all listening sockets */
+  if( reuse_port && setsockopt( listen_socket, SOL_SOCKET, SO_REUSEPORT, &y, sizeof(int) ) != 0 )
+  {
+    fprintf( stderr, "Could not share port between several sockets error!\n" );
+    close( listen_socket );
+    return -1;
+  }
   
   address.sin_family = AF_INET;
   address.sin_addr.s_addr = INADDR_ANY;
-  address.sin_port = htons ( this->port );
+  address.sin_port = htons ( port );
   
-  if ( bind( create_socket,
+  if ( bind( listen_socket,
             (struct sockaddr *) &address,
             sizeof (address)) != 0 ) 
   {
-    fprintf( stderr, "The port %d is already in use!\n", address.sin_port );
+    fprintf( stderr, "The port %d is already in use!\n", port );
+    close( listen_socket );
     return -1;
   }
   
-  listen( create_socket, 5 );
-  addrlen = sizeof( struct sockaddr_in );
-  
+  listen( listen_socket, SOCK_LISTEN_BACKLOG );
+  _sock_set_nonblocking( listen_socket );
+
+  return listen_socket;
+}
+
+
+/*!
+ *  create epoll instance of a worker and register its listening socket
+ */
+static int _sock_epoll_init( SOCK_SERVER* server )
+{
+  struct epoll_event  ev;
+
+  server->epoll_fd = epoll_create1( 0 );
+  if( server->epoll_fd < 0 )
+  {
+    fprintf( stderr, "Could not create epoll instance error!\n" );
+    return -1;
+  }
+
+  ev.events   = EPOLLIN | EPOLLET;
+  ev.data.ptr = NULL;   /* marks the listening socket */
+  epoll_ctl( server->epoll_fd, EPOLL_CTL_ADD, server->listen_socket, &ev );
+
+  return 0;
+}
+
+
+/*!
+ *  event loop of one worker
+ */
+static void* _sock_worker( void* arg )
+{
+  SOCK_SERVER*        server = (SOCK_SERVER *) arg;
+  struct epoll_event  events[SOCK_MAX_EVENTS];
+  int                 i, n;
+
+  if( _sock_epoll_init( server ) < 0 )
+    return NULL;
+
+  TIMER_WheelInit( & server->timers, _sock_ticks() );
+
   while (1) 
   {
-    printf("Waiting for client connections ...\n");
-    new_socket = accept ( create_socket,
-      (struct sockaddr *) &address,
-      &addrlen );
-    
-    if (new_socket > 0)
+    n = epoll_wait( server->epoll_fd, events, SOCK_MAX_EVENTS, 1000 / SOCK_TICKS_PER_SEC );
+    if( n < 0 && errno != EINTR )
     {
-      printf ("Client (%s) is connected!\n",
-              inet_ntoa (address.sin_addr));
-    
-      this->socket = new_socket;
-      do 
-      {
-        error = HTTP_ProcessRequest( this );
-        if( error < 0 )
-        {
-          fprintf( stderr, 
-            "Error while rocessing of http request occured:\n\t%s!\n",
-            HTTP_GetErrorMsg(error) 
-            );
-        }
-      } while( !error && this->keep_alive );
+      perror( "epoll_wait" );
+      break;
+    }
 
-      close (new_socket);
-      }
+    for( i = 0; i < n; ++i )
+    {
+      if( events[i].data.ptr == NULL )
+        _sock_accept( server );
+      else 
+        _sock_serve( server, (SOCK_CONN *) events[i].data.ptr );
+    }
+
+    TIMER_Advance( & server->timers, _sock_ticks(), _sock_drop_connection, server );
   }
   
-  close (create_socket);
-  
-  return EXIT_SUCCESS;
+  while( server->active_list != NULL )
+    _sock_conn_close( server, server->active_list );
+
+  return NULL;
+}
+
+
+#ifdef HTTP_USE_IO_URING
+
+/*!
+ *  get submission queue entry, the queue is flushed when it is full
+ */
+static struct io_uring_sqe* _sock_uring_sqe( SOCK_SERVER* server )
+{
+  struct io_uring_sqe* sqe = io_uring_get_sqe( & server->ring );
+
+  if( sqe == NULL )
+  {
+    io_uring_submit( & server->ring );
+    sqe = io_uring_get_sqe( & server->ring );
+  }
+
+  return sqe;
+}
+
+
+/*!
+ *  file descriptor to use for client socket, index when it is registered
+ */
+static int _sock_uring_fd( const SOCK_CONN* conn )
+{
+  return conn->fixed ? conn->index + 1 : conn->socket;
+}
+
+
+/*!
+ *  tag submission with connection and operation
+ */
+static void _sock_uring_tag( struct io_uring_sqe* sqe, SOCK_CONN* conn, const int op, const int on_socket )
+{
+  if( on_socket && conn->fixed )
+    sqe->flags |= IOSQE_FIXED_FILE;
+
+  io_uring_sqe_set_data( sqe, (void *) ( (uintptr_t) conn | op ) );
+  ++conn->inflight;
+}
+
+
+/*!
+ *  submit accept request for the listening socket
+ */
+static int _sock_uring_accept( SOCK_SERVER* server )
+{
+  struct io_uring_sqe*  sqe = _sock_uring_sqe( server );
+  const int             fd  = server->fixed_files ? 0 : server->listen_socket;
+
+  if( sqe == NULL )
+    return -1;
+
+  if( server->multishot_accept )
+    io_uring_prep_multishot_accept( sqe, fd, NULL, NULL, SOCK_NONBLOCK );
+  else
+    io_uring_prep_accept( sqe, fd, NULL, NULL, SOCK_NONBLOCK );
+
+  if( server->fixed_files )
+    sqe->flags |= IOSQE_FIXED_FILE;
+  io_uring_sqe_set_data( sqe, (void *) SOCK_OP_ACCEPT );
+
+  return 0;
+}
+
+
+/*!
+ *  submit receive request for the next bytes of the current request
+ */
+static int _sock_uring_recv( SOCK_SERVER* server, SOCK_CONN* conn )
+{
+  struct io_uring_sqe*  sqe;
+  long                  size;
+  char*                 buf = HTTP_GetReceiveBuffer( & conn->http_obj, &size );
+
+  if( size <= 0 || ( sqe = _sock_uring_sqe( server ) ) == NULL )
+    return -1;
+
+  if( conn->registered )
+    io_uring_prep_read_fixed( sqe, _sock_uring_fd( conn ), buf, size, 0, 2 * conn->index );
+  else
+    io_uring_prep_recv( sqe, _sock_uring_fd( conn ), buf, size, 0 );
+
+  _sock_uring_tag( sqe, conn, SOCK_OP_RECV, true );
+  return 0;
+}
+
+
+/*!
+ *  submit transmission of given segment of the response, static 
+ *  content is spliced from file to socket through a pipe
+ */
+static int _sock_uring_send( SOCK_SERVER* server, SOCK_CONN* conn, const HTTP_OUTPUT* out )
+{
+  struct io_uring_sqe*  sqe;
+  long                  len = conn->pipe_len;
+
+  if( out->buf != NULL )
+  {
+    if( ( sqe = _sock_uring_sqe( server ) ) == NULL )
+      return -1;
+
+    /* header followed by file content must not go out in a segment of its own,
+       cached content is not located within the registered buffer */
+    if( conn->registered && ! out->more && out->buf >= conn->http_obj.sndbuf && 
+        out->buf < conn->http_obj.sndbuf + HTTP_SND_BUF_LEN )
+      io_uring_prep_write_fixed( sqe, _sock_uring_fd( conn ), out->buf, out->len, 0, 2 * conn->index + 1 );
+    else
+      io_uring_prep_send( sqe, _sock_uring_fd( conn ), out->buf, out->len, out->more ? MSG_MORE : 0 );
+
+    _sock_uring_tag( sqe, conn, SOCK_OP_SEND, true );
+    return 0;
+  }
+
+  if( conn->pipe_fd[0] < 0 && pipe( conn->pipe_fd ) != 0 )
+  {
+    conn->pipe_fd[0] = conn->pipe_fd[1] = -1;
+    return -1;
+  }
+
+  /* linked requests must be submitted together */
+  if( io_uring_sq_space_left( & server->ring ) < 2 )
+    io_uring_submit( & server->ring );
+
+  /* fill the pipe unless bytes of a short transmission are left */
+  if( len == 0 )
+  {
+    len = ( out->len < SOCK_SPLICE_CHUNK ) ? out->len : SOCK_SPLICE_CHUNK;
+    if( ( sqe = _sock_uring_sqe( server ) ) == NULL )
+      return -1;
+    io_uring_prep_splice( sqe, out->fd, out->offset, conn->pipe_fd[1], -1, len, 0 );
+    sqe->flags |= IOSQE_IO_LINK;
+    _sock_uring_tag( sqe, conn, SOCK_OP_SPLICE_IN, false );
+  }
+
+  if( ( sqe = _sock_uring_sqe( server ) ) == NULL )
+    return -1;
+  io_uring_prep_splice( sqe, conn->pipe_fd[0], -1, _sock_uring_fd( conn ), -1, len, 0 );
+  _sock_uring_tag( sqe, conn, SOCK_OP_SPLICE_OUT, true );
+  return 0;
+}
+
+
+/*!
+ *  advance receive, processing and transmit state of a connection 
+ *  until a transfer has to be submitted to the ring
+ */
+static void _sock_uring_serve( SOCK_SERVER* server, SOCK_CONN* conn )
+{
+  HTTP_OBJ*     this  = & conn->http_obj;
+  HTTP_OUTPUT   out;
+  int           error = HTTP_OK;
+
+  while( error == HTTP_OK )
+  {
+    /* complete transmission of current response first */
+    if( conn->responding )
+    {
+      error = HTTP_GetPendingOutput( this, &out );
+      if( error == HTTP_PENDING && _sock_uring_send( server, conn, &out ) != 0 )
+        error = HTTP_SEND_ERROR;
+      if( error != HTTP_OK )
+        break;
+
+      conn->responding = false;
+      if( ! this->keep_alive )
+      {
+        error = HTTP_CONNECTION_CLOSED;
+        break;
+      }
+    }
+
+    /* process next request as soon as it has been received */
+    error = HTTP_ReceiveRequest( this );
+    if( error == HTTP_PENDING && _sock_uring_recv( server, conn ) != 0 )
+      error = HTTP_RCV_ERROR;
+    if( error != HTTP_OK )
+      break;
+
+    _sock_process_request( server, conn );
+  }
+
+  if( error == HTTP_PENDING )
+  {
+    _sock_conn_wait( server, conn );
+    return;
+  }
+
+  if( error < 0 )
+  {
+    fprintf( stderr, 
+      "Error while rocessing of http request occured:\n\t%s!\n",
+      HTTP_GetErrorMsg(error) 
+      );
+  }
+
+  _sock_conn_close( server, conn );
+}
+
+
+/*!
+ *  set up connection for accepted client socket
+ */
+static void _sock_uring_connect( SOCK_SERVER* server, const int new_socket )
+{
+  SOCK_CONN*    conn = _sock_conn_alloc( server );
+  struct iovec  iov[2];
+
+  if( conn == NULL )
+  {
+    fprintf( stderr, "Too many client connections, reject!\n" );
+    close( new_socket );
+    return;
+  }
+
+  printf ("Client is connected!\n");
+
+  /* buffers of the HTTP object stay the same for the lifetime of the connection object */
+  if( server->fixed_buffers && ! conn->registered )
+  {
+    iov[0].iov_base = conn->http_obj.rcvbuf;
+    iov[0].iov_len  = MAX_HTML_BUF_LEN;
+    iov[1].iov_base = conn->http_obj.sndbuf;
+    iov[1].iov_len  = HTTP_SND_BUF_LEN;
+    conn->registered = ( io_uring_register_buffers_update_tag( & server->ring, 2 * conn->index, iov, NULL, 2 ) == 2 );
+  }
+
+  if( server->fixed_files )
+    conn->fixed = ( io_uring_register_files_update( & server->ring, conn->index + 1, (int *) &new_socket, 1 ) == 1 );
+
+  _sock_conn_attach( server, conn, new_socket, HTTP_IO_COMPLETION );
+  _sock_uring_serve( server, conn );
+}
+
+
+/*!
+ *  handle completion of a submitted operation
+ */
+static void _sock_uring_complete( SOCK_SERVER* server, const struct io_uring_cqe* cqe )
+{
+  const uintptr_t   data = (uintptr_t) io_uring_cqe_get_data( cqe );
+  const int         op   = data & SOCK_OP_MASK;
+  const int         res  = cqe->res;
+  SOCK_CONN*        conn = (SOCK_CONN *) ( data & ~ (uintptr_t) SOCK_OP_MASK );
+
+  if( op == SOCK_OP_ACCEPT )
+  {
+    if( res >= 0 )
+    {
+      _sock_uring_connect( server, res );
+    }
+    else if( res == -EINVAL && server->multishot_accept )
+    {
+      /* kernel does not support multishot accept */
+      server->multishot_accept = false;
+    }
+    else if( res != -EINTR && res != -EAGAIN )
+    {
+      fprintf( stderr, "accept: %s\n", strerror( -res ) );
+    }
+
+    if( ! ( cqe->flags & IORING_CQE_F_MORE ) )
+      _sock_uring_accept( server );
+    return;
+  }
+
+  --conn->inflight;
+
+  if( ! conn->closing )
+  {
+    switch( op )
+    {
+      case SOCK_OP_RECV:
+        if( res > 0 )
+          HTTP_CommitReceived( & conn->http_obj, res );
+        else if( res != -EAGAIN && res != -EINTR )
+          _sock_conn_close( server, conn );
+        break;
+
+      case SOCK_OP_SEND:
+        if( res >= 0 )
+          HTTP_CommitSent( & conn->http_obj, res );
+        else
+          _sock_conn_close( server, conn );
+        break;
+
+      case SOCK_OP_SPLICE_IN:
+        if( res > 0 )
+          conn->pipe_len += res;
+        else
+          _sock_conn_close( server, conn );
+        break;
+
+      case SOCK_OP_SPLICE_OUT:
+        /* canceled when the pipe could not be filled completely */
+        if( res > 0 )
+        {
+          conn->pipe_len -= res;
+          HTTP_CommitSent( & conn->http_obj, res );
+        }
+        else if( res != -ECANCELED )
+        {
+          _sock_conn_close( server, conn );
+        }
+        break;
+    }
+  }
+
+  /* continue when all transfers of the current step are completed */
+  if( conn->inflight == 0 && conn->socket >= 0 )
+  {
+    if( conn->closing )
+      _sock_conn_close( server, conn );
+    else
+      _sock_uring_serve( server, conn );
+  }
+}
+
+
+/*!
+ *  event loop of one worker based on io_uring, transfers of all connections
+ *  are submitted and completed in batches with one system call
+ *
+ *  Returns -1 when io_uring is not available
+ */
+static int _sock_uring_worker( SOCK_SERVER* server )
+{
+  struct io_uring_cqe*      cqe;
+  struct __kernel_timespec  timeout;
+  unsigned                  head, count;
+  int                       n;
+
+  if( io_uring_queue_init( SOCK_URING_ENTRIES, & server->ring, 0 ) < 0 )
+    return -1;
+
+  server->multishot_accept = true;
+
+  /* socket descriptors and buffers are looked up once instead of per transfer */
+  server->fixed_files = 
+    ( io_uring_register_files_sparse( & server->ring, SOCK_MAX_CONNECTIONS + 1 ) == 0 &&
+      io_uring_register_files_update( & server->ring, 0, & server->listen_socket, 1 ) == 1 );
+  server->fixed_buffers = 
+    ( io_uring_register_buffers_sparse( & server->ring, 2 * SOCK_MAX_CONNECTIONS ) == 0 );
+
+  TIMER_WheelInit( & server->timers, _sock_ticks() );
+  _sock_uring_accept( server );
+
+  printf( "Serving client connections by io_uring\n" );
+
+  while (1) 
+  {
+    timeout.tv_sec  = 0;
+    timeout.tv_nsec = 1000000000L / SOCK_TICKS_PER_SEC;
+    n = io_uring_submit_and_wait_timeout( & server->ring, &cqe, 1, &timeout, NULL );
+    if( n < 0 && n != -ETIME && n != -EINTR )
+    {
+      fprintf( stderr, "io_uring_submit_and_wait_timeout: %s\n", strerror( -n ) );
+      break;
+    }
+
+    count = 0;
+    io_uring_for_each_cqe( & server->ring, head, cqe )
+    {
+      _sock_uring_complete( server, cqe );
+      ++count;
+    }
+    io_uring_cq_advance( & server->ring, count );
+
+    TIMER_Advance( & server->timers, _sock_ticks(), _sock_drop_connection, server );
+  }
+
+  /* cancels all outstanding operations */
+  io_uring_queue_exit( & server->ring );
+  server->fixed_files = server->fixed_buffers = false;
+
+  while( server->active_list != NULL )
+  {
+    server->active_list->inflight = 0;
+    server->active_list->fixed    = false;
+    _sock_conn_close( server, server->active_list );
+  }
+
+  return 0;
+}
+
+#endif /* #ifdef HTTP_USE_IO_URING */
+
+
+/*!
+ *  run event loop of one worker, io_uring is used when available
+ */
+static void* _sock_run_worker( void* arg )
+{
+#ifdef HTTP_USE_IO_URING
+  if( _sock_uring_worker( (SOCK_SERVER *) arg ) == 0 )
+    return NULL;
+#endif
+
+  return _sock_worker( arg );
+}
+
+
+/*!
+ *  create listening socket of a worker, its epoll instance is created 
+ *  by the event loop only when io_uring is not used
+ */
+static int _sock_server_init( SOCK_SERVER* server )
+{
+  server->epoll_fd      = -1;
+  server->listen_socket = _sock_listen( server->config->port, server->reuse_port );
+  if( server->listen_socket < 0 )
+    return -1;
+
+  return 0;
+}
+
+
+/*!
+ *  release listening socket and epoll instance of a worker
+ */
+static void _sock_server_release( SOCK_SERVER* server )
+{
+  SOCK_CONN* conn;
+  
+  if( server->epoll_fd >= 0 )
+    close( server->epoll_fd );
+  close( server->listen_socket );
+  server->epoll_fd      = -1;
+  server->listen_socket = -1;
+  
+  while( ( conn = server->free_list ) != NULL )
+  {
+    server->free_list = conn->next;
+    free( conn );
+  }
+}
+
+
+/*!
+ *  content pack of the process, reloaded on SIGHUP
+ */
+static PACK_STORE*    _sock_pack_store;
+
+
+/*!
+ *  swap in new version of the content pack on SIGHUP
+ */
+static void _sock_reload_handler( int sig )
+{
+  (void) sig;
+
+  if( _sock_pack_store != NULL )
+    PACK_RequestReload( _sock_pack_store );
+}
+
+
+/*!
+ *  set up workers and serve client connections until all workers terminate
+ */
+static int _sock_service( const SOCK_CONFIG* config, const int reuse_port ) 
+{
+  const int           nr_threads = config->nr_threads;
+  HTTP_OBJ*           cgi_handlers;       /* owner of the shared CGI handler table */
+  FILECACHE*          file_cache = NULL;  /* static content cache shared by all workers */
+  PACK_STORE*         pack_store = NULL;  /* content pack shared by all workers */
+  SOCK_SERVER*        servers;            /* event loop instance of each worker */
+  int                 i, nr_servers = 0, error = 0;
+
+  if( nr_threads < 1 )
+    return -1;
+
+  /* intialize HTTP object keeping the CGI handler table */
+  cgi_handlers = calloc( 1, sizeof( HTTP_OBJ ) );
+  servers      = calloc( nr_threads, sizeof( SOCK_SERVER ) );
+  if( cgi_handlers == NULL || servers == NULL )
+    error = HTTP_HEAP_OVERFLOW;
+
+  if( ! error && ( error = HTTP_ObjInit( cgi_handlers, HTML_SERVER_NAME, config->ht_root_dir, config->port ) ) != 0 )
+    fprintf( stderr, "Could not create buffer error!\n" );
+
+  /* register CGI handlers (cgi.c) */
+  if( ! error && ( error = RegisterCgiHandlers( cgi_handlers, config->upload_dir ) ) != 0 )
+    fprintf( stderr, "Could not register CGI handlers!\n" );
+
+  /* caching policies, shared like the CGI handlers */
+  if( ! error && config->cache_rules != NULL && ( error = HTTP_LoadCacheRules( cgi_handlers, config->cache_rules ) ) != 0 )
+    fprintf( stderr, "Could not load cache rules from %s!\n", config->cache_rules );
+
+  /* static content cache, the server runs without when modifications cannot be watched */
+  if( ! error && config->cache_size > 0 )
+  {
+    file_cache = malloc( sizeof( FILECACHE ) );
+    if( file_cache != NULL && FILECACHE_Init( file_cache, config->ht_root_dir, config->cache_size ) != 0 )
+    {
+      fprintf( stderr, "Could not watch root directory, static content is not cached!\n" );
+      FILECACHE_Exit( file_cache );
+      free( file_cache );
+      file_cache = NULL;
+    }
+  }
+
+  /* content pack, a new version is swapped in on SIGHUP */
+  if( ! error && config->pack_file != NULL )
+  {
+    pack_store = malloc( sizeof( PACK_STORE ) );
+    if( pack_store == NULL || PACK_Init( pack_store, config->pack_file ) != 0 )
+    {
+      fprintf( stderr, "Could not load content pack %s!\n", config->pack_file );
+      error = -1;
+    }
+    else
+    {
+      _sock_pack_store = pack_store;
+      signal( SIGHUP, _sock_reload_handler );
+    }
+  }
+
+  /* create sockets */ 
+  if( ! error )
+    printf("Server Started\n");
+
+  for( i = 0; ! error && i < nr_threads; ++i )
+  {
+    servers[i].config       = config;
+    servers[i].reuse_port   = reuse_port;
+    servers[i].cgi_handlers = cgi_handlers;
+    servers[i].file_cache   = file_cache;
+    servers[i].pack_store   = pack_store;
+
+    if( ( error = _sock_server_init( & servers[i] ) ) == 0 )
+      ++nr_servers;
+  }
+
+  if( ! error )
+  {
+    printf ( "Socket successfully created\n" );
+    printf("Waiting for client connections ...\n");
+    
+    /* the calling thread serves as first worker */
+    for( i = 1; i < nr_servers; ++i )
+    {
+      if( pthread_create( & servers[i].thread, NULL, _sock_run_worker, & servers[i] ) != 0 )
+      {
+        fprintf( stderr, "Could not create worker thread %d error!\n", i );
+        _sock_server_release( & servers[i] );
+      }
+    }
+
+    _sock_run_worker( & servers[0] );
+    
+    for( i = 1; i < nr_servers; ++i )
+    {
+      if( servers[i].listen_socket >= 0 )
+        pthread_join( servers[i].thread, NULL );
+    }
+  }
+
+  for( i = 0; i < nr_servers; ++i )
+  {
+    if( servers[i].listen_socket >= 0 )
+      _sock_server_release( & servers[i] );
+  }
+
+  free( servers );
+  if( cgi_handlers != NULL )
+    HTTP_ObjExit( cgi_handlers );
+  free( cgi_handlers );
+
+  if( file_cache != NULL )
+  {
+    FILECACHE_Exit( file_cache );
+    free( file_cache );
+  }
+
+  if( pack_store != NULL )
+  {
+    if( _sock_pack_store == pack_store )
+    {
+      signal( SIGHUP, SIG_DFL );
+      _sock_pack_store = NULL;
+    }
+    PACK_Exit( pack_store );
+    free( pack_store );
+  }
+  
+  return error ? error : EXIT_SUCCESS;
+}
+
+
+/*!
+ *  pid of the worker processes, 0 when not running
+ */
+static pid_t*         _sock_worker_pids;
+static int            _sock_nr_workers;
+static volatile int   _sock_terminate;
+
+
+/*!
+ *  forward SIGHUP to all worker processes for reloading their content pack
+ */
+static void _sock_forward_handler( int sig )
+{
+  int i;
+
+  for( i = 0; i < _sock_nr_workers; ++i )
+  {
+    if( _sock_worker_pids[i] > 0 )
+      kill( _sock_worker_pids[i], sig );
+  }
+}
+
+
+/*!
+ *  terminate all worker processes on SIGINT or SIGTERM
+ */
+static void _sock_terminate_handler( int sig )
+{
+  int i;
+
+  (void) sig;
+  _sock_terminate = true;
+  for( i = 0; i < _sock_nr_workers; ++i )
+  {
+    if( _sock_worker_pids[i] > 0 )
+      kill( _sock_worker_pids[i], SIGTERM );
+  }
+}
+
+
+/*!
+ *  start worker process with given index and pin it to a core
+ */
+static pid_t _sock_spawn_worker( const SOCK_CONFIG* config, const int index )
+{
+  cpu_set_t   cpus;
+  long        nr_cpus = sysconf( _SC_NPROCESSORS_ONLN );
+  pid_t       pid = fork();
+
+  if( pid != 0 )
+    return pid;
+
+  /* child process, a forwarded SIGHUP is ignored until the content pack is set up */
+  signal( SIGINT, SIG_DFL );
+  signal( SIGTERM, SIG_DFL );
+  signal( SIGHUP, SIG_IGN );
+
+  if( nr_cpus > 0 )
+  {
+    CPU_ZERO( &cpus );
+    CPU_SET( index % nr_cpus, &cpus );
+    if( sched_setaffinity( 0, sizeof( cpus ), &cpus ) != 0 )
+      perror( "sched_setaffinity" );
+  }
+
+  exit( _sock_service( config, true ) ? EXIT_FAILURE : EXIT_SUCCESS );
+}
+
+
+/* -- public prototypes ----------------------------------------------------------*/
+
+
+/*******************************************************************************
+ * service_socket_loop() 
+ *                                                                         */ /*!
+ * Reads incoming HTTP requests from socket, and reacts appropriately
+ *
+ * All client connections of a worker thread are multiplexed by one edge 
+ * triggered epoll event loop, hence one slow client does not block the
+ * others. Each worker listens to its own socket, the kernel distributes 
+ * incoming connections among them ( SO_REUSEPORT ). Connections keep their
+ * own HTTP object, CGI handlers are registered only once for all of them.
+ * HTTP/1.1 connections are kept alive, idle ones are closed after the
+ * configured time out which is supervised by a timer wheel per worker.
+ * Pipelined requests are answered one after the other in their sequence.
+ * Static content is served from an in-memory cache shared by all workers
+ * of the process, which is invalidated by inotify.
+ * A content pack is resolved before the root directory, a new version is
+ * swapped in on SIGHUP while pending responses are completed from the old one.
+ * When built with liburing, each worker submits accept, receive, send and
+ * splice operations of all its connections in batches to an io_uring 
+ * instead, epoll is used when the kernel does not support it.
+ *
+ * Function parameters
+ *     - config:      server configuration
+ *
+ * Returnparameter
+ *     - R: 0 in case of success, otherwise error code
+ * 
+ *******************************************************************************/
+int service_socket_loop( const SOCK_CONFIG* config ) 
+{
+  return _sock_service( config, ( config->nr_threads > 1 ) );
+}
+
+
+/*******************************************************************************
+ * service_worker_processes() 
+ *                                                                         */ /*!
+ * Pre-forks worker processes, each of them runs service_socket_loop() with
+ * its own listening socket on the same port ( SO_REUSEPORT ) and is pinned
+ * to one core. Hence the kernel balances incoming connections among them 
+ * and a crashing CGI handler only takes down one worker. Workers killed by 
+ * a signal are restarted, with increasing delay when they crash right after
+ * their start and not at all after several such crashes in a row. The 
+ * function returns when all workers terminated.
+ * SIGHUP is forwarded to the workers for reloading their content pack.
+ *
+ * Function parameters
+ *     - config:      server configuration
+ *     - nr_workers:  number of worker processes
+ *
+ * Returnparameter
+ *     - R: 0 in case of success, otherwise error code
+ * 
+ *******************************************************************************/
+int service_worker_processes( const SOCK_CONFIG* config, const int nr_workers )
+{
+  pid_t           pid;
+  unsigned long*  started;    /* tick when the worker of a slot has been started */
+  int*            crashes;    /* number of crashes in a row shortly after the start */
+  unsigned long   resume;
+  int             i, status, nr_running = 0, error = 0;
+
+  if( nr_workers < 1 )
+    return -1;
+
+  _sock_worker_pids = calloc( nr_workers, sizeof( pid_t ) );
+  started           = calloc( nr_workers, sizeof( unsigned long ) );
+  crashes           = calloc( nr_workers, sizeof( int ) );
+  if( _sock_worker_pids == NULL || started == NULL || crashes == NULL )
+  {
+    free( _sock_worker_pids );
+    free( started );
+    free( crashes );
+    _sock_worker_pids = NULL;
+    return HTTP_HEAP_OVERFLOW;
+  }
+  _sock_nr_workers = nr_workers;
+
+  signal( SIGINT, _sock_terminate_handler );
+  signal( SIGTERM, _sock_terminate_handler );
+  if( config->pack_file != NULL )
+    signal( SIGHUP, _sock_forward_handler );
+
+  for( i = 0; i < nr_workers; ++i )
+  {
+    started[i] = _sock_ticks();
+    _sock_worker_pids[i] = _sock_spawn_worker( config, i );
+    if( _sock_worker_pids[i] < 0 )
+    {
+      perror( "fork" );
+      _sock_worker_pids[i] = 0;
+      error = -1;
+    }
+    else
+    {
+      ++nr_running;
+    }
+  }
+
+  while( nr_running > 0 )
+  {
+    pid = wait( &status );
+    if( pid < 0 )
+    {
+      if( errno == EINTR )
+        continue;
+      break;
+    }
+
+    for( i = 0; i < nr_workers && _sock_worker_pids[i] != pid; ++i )
+      ;
+    if( i == nr_workers )
+      continue;
+
+    _sock_worker_pids[i] = 0;
+    --nr_running;
+
+    if( WIFSIGNALED( status ) && ! _sock_terminate )
+    {
+      /* workers crashing right after their start are restarted with increasing delay */
+      if( _sock_ticks() - started[i] < SOCK_WORKER_MIN_UPTIME * SOCK_TICKS_PER_SEC )
+        ++crashes[i];
+      else
+        crashes[i] = 0;
+
+      if( crashes[i] >= SOCK_WORKER_MAX_RESTARTS )
+      {
+        fprintf( stderr, "Worker process %d terminated by signal %d, crashed %d times in a row, give up!\n", 
+          (int) pid, WTERMSIG( status ), crashes[i] );
+        error = -1;
+        continue;
+      }
+
+      /* crashed, e.g. within a CGI handler, start a new one */
+      fprintf( stderr, "Worker process %d terminated by signal %d, restart it!\n", 
+        (int) pid, WTERMSIG( status ) );
+
+      if( crashes[i] > 0 )
+      {
+        resume = _sock_ticks() + ( 1UL << ( crashes[i] - 1 ) ) * SOCK_TICKS_PER_SEC;
+        while( ! _sock_terminate && (long) ( resume - _sock_ticks() ) > 0 )
+          usleep( 1000000 / SOCK_TICKS_PER_SEC );
+        if( _sock_terminate )
+          continue;
+      }
+
+      started[i] = _sock_ticks();
+      _sock_worker_pids[i] = _sock_spawn_worker( config, i );
+      if( _sock_worker_pids[i] > 0 )
+        ++nr_running;
+      else
+        _sock_worker_pids[i] = 0;
+    }
+    else if( WIFEXITED( status ) && WEXITSTATUS( status ) != EXIT_SUCCESS )
+    {
+      /* startup failed, e.g. port in use, do not retry */
+      error = -1;
+    }
+  }
+
+  signal( SIGINT, SIG_DFL );
+  signal( SIGTERM, SIG_DFL );
+  signal( SIGHUP, SIG_DFL );
+  free( _sock_worker_pids );
+  free( started );
+  free( crashes );
+  _sock_worker_pids = NULL;
+  _sock_nr_workers  = 0;
+
+  return error;
 }
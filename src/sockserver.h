@@ -10,6 +10,26 @@
 #ifndef _SOCKSERVER_H
 #define _SOCKSERVER_H
 
+/* -- public types    -----------------------------------------------------------*/
+
+
+/*!
+ *  Server configuration
+ */
+typedef struct
+{
+  const char*   ht_root_dir;          /* root directory for static web content */
+  int           port;                 /* port the server is listening to */
+  int           nr_threads;           /* number of worker threads per process */
+  int           keep_alive_timeout;   /* seconds an idle connection is kept open, 0 disables keep-alive */
+  int           max_conn_time;        /* seconds after which a connection is not kept alive anymore, 0 for unlimited */
+  long          cache_size;           /* bytes of static content cached in memory, 0 disables the cache */
+  const char*   cache_rules;          /* file with Cache-Control rules, NULL if none */
+  const char*   pack_file;            /* content pack resolved before the root directory, NULL if none */
+  const char*   upload_dir;           /* directory of the sample upload route, NULL disables the route */
+} SOCK_CONFIG;
+
+
 /* -- public prototypes ----------------------------------------------------------*/
 
 
@@ -18,15 +38,53 @@
  *                                                                         */ /*!
  * Reads incoming HTTP requests from socket, and reacts appropriately
  *
+ * All client connections of a worker thread are multiplexed by one edge 
+ * triggered epoll event loop, hence one slow client does not block the
+ * others. Each worker listens to its own socket, the kernel distributes 
+ * incoming connections among them ( SO_REUSEPORT ). Connections keep their
+ * own HTTP object, CGI handlers are registered only once for all of them.
+ * HTTP/1.1 connections are kept alive, idle ones are closed after the
+ * configured time out which is supervised by a timer wheel per worker.
+ * Pipelined requests are answered one after the other in their sequence.
+ * Static content is served from an in-memory cache shared by all workers
+ * of the process, which is invalidated by inotify.
+ * A content pack is resolved before the root directory, a new version is
+ * swapped in on SIGHUP while pending responses are completed from the old one.
+ * When configured --with-io-uring, each worker submits accept, receive, send and
+ * splice operations of all its connections in batches to an io_uring 
+ * instead, epoll is used when the kernel does not support it.
+ *
+ * Function parameters
+ *     - config:      server configuration
+ *
+ * Returnparameter
+ *     - R: 0 in case of success, otherwise error code
+ * 
+ *******************************************************************************/
+int service_socket_loop( const SOCK_CONFIG* config );
+
+
+/*******************************************************************************
+ * service_worker_processes() 
+ *                                                                         */ /*!
+ * Pre-forks worker processes, each of them runs service_socket_loop() with
+ * its own listening socket on the same port ( SO_REUSEPORT ) and is pinned
+ * to one core. Hence the kernel balances incoming connections among them 
+ * and a crashing CGI handler only takes down one worker. Workers killed by 
+ * a signal are restarted, with increasing delay when they crash right after
+ * their start and not at all after several such crashes in a row. The 
+ * function returns when all workers terminated.
+ * SIGHUP is forwarded to the workers for reloading their content pack.
+ *
  * Function parameters
- *     - ht_root_dir: root directory for static web content 
- *     - port:        port the server is listening to
+ *     - config:      server configuration
+ *     - nr_workers:  number of worker processes
  *
  * Returnparameter
  *     - R: 0 in case of success, otherwise error code
  * 
  *******************************************************************************/
-int service_socket_loop( const char* ht_root_dir, const int port );
+int service_worker_processes( const SOCK_CONFIG* config, const int nr_workers );
 
 
 #endif /* #define _SOCKSERVER_H */
@@ -0,0 +1,227 @@
+/*
+ *  timerwheel.c
+ *  idefix
+ *
+ *  hierarchical timer wheel for supervising a large number of 
+ *  connections with O(1) costs for arming and cancelling timers
+ *
+ *  Copyright 2010 GNU General Public Licence. All rights reserved.
+ *
+ */
+
+/* -- includes -------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include "timerwheel.h"
+
+
+/* -- const definitions -----------------------------------------------------------*/
+
+
+/*!
+ *  Mask for slot index within one level
+ */
+#define TIMER_SLOT_MASK             ( TIMER_SLOTS - 1 )
+
+
+/*!
+ *  Maximum distance in ticks between now and expiry of a timer
+ */
+#define TIMER_MAX_DELTA             ( ( 1UL << ( TIMER_LEVEL_BITS * TIMER_LEVELS ) ) - 1 )
+
+
+/* -- local functions -------------------------------------------------------------*/
+
+
+/*!
+ *  insert timer into the slot matching its expiry
+ *
+ *  Timers expiring within the next TIMER_SLOTS ticks are kept at level 0
+ *  with one slot per tick, each further level covers TIMER_SLOTS times
+ *  the range of the previous one with coarser slots. Coarse slots are
+ *  redistributed to the level below when it wraps around ( cascading ).
+ */
+static void _timer_link( TIMER_WHEEL* wheel, TIMER_NODE* timer )
+{
+  unsigned long   delta = timer->expires - wheel->now;
+  TIMER_NODE*     head;
+  int             level;
+
+  if( delta > TIMER_MAX_DELTA )
+  {
+    delta = TIMER_MAX_DELTA;
+    timer->expires = wheel->now + delta;
+  }
+
+  for( level = 0; level < TIMER_LEVELS - 1; ++level )
+  {
+    if( delta < ( 1UL << ( TIMER_LEVEL_BITS * ( level + 1 ) ) ) )
+      break;
+  }
+
+  head = & wheel->slots[level][ ( timer->expires >> ( TIMER_LEVEL_BITS * level ) ) & TIMER_SLOT_MASK ];
+
+  timer->prev = head;
+  timer->next = head->next;
+  head->next->prev = timer;
+  head->next = timer;
+}
+
+
+/*!
+ *  unlink timer from its slot
+ */
+static void _timer_unlink( TIMER_NODE* timer )
+{
+  timer->prev->next = timer->next;
+  timer->next->prev = timer->prev;
+  timer->prev = timer->next = NULL;
+}
+
+
+/*!
+ *  redistribute timers of given slot to lower levels
+ */
+static void _timer_cascade( TIMER_WHEEL* wheel, const int level, const int index )
+{
+  TIMER_NODE*   head = & wheel->slots[level][index];
+  TIMER_NODE*   timer;
+
+  while( ( timer = head->next ) != head )
+  {
+    _timer_unlink( timer );
+    _timer_link( wheel, timer );
+  }
+}
+
+
+/* -- public prototypes ----------------------------------------------------------*/
+
+
+/*******************************************************************************
+ * TIMER_WheelInit() 
+ *                                                                         */ /*!
+ * Initialize empty timer wheel
+ *                                                                              
+ * Function parameters
+ *     - wheel:     pointer to timer wheel
+ *     - now:       current tick
+ *
+ *******************************************************************************/
+void TIMER_WheelInit( TIMER_WHEEL* wheel, const unsigned long now )
+{
+  int level, index;
+
+  for( level = 0; level < TIMER_LEVELS; ++level )
+  {
+    for( index = 0; index < TIMER_SLOTS; ++index )
+    {
+      wheel->slots[level][index].prev = & wheel->slots[level][index];
+      wheel->slots[level][index].next = & wheel->slots[level][index];
+    }
+  }
+
+  wheel->now = now;
+}
+
+
+/*******************************************************************************
+ * TIMER_Init() 
+ *                                                                         */ /*!
+ * Initialize disarmed timer
+ *                                                                              
+ * Function parameters
+ *     - timer:     pointer to timer
+ *
+ *******************************************************************************/
+void TIMER_Init( TIMER_NODE* timer )
+{
+  timer->prev    = NULL;
+  timer->next    = NULL;
+  timer->expires = 0;
+}
+
+
+/*******************************************************************************
+ * TIMER_Set() 
+ *                                                                         */ /*!
+ * Arm or re-arm timer, timers in the past expire with the next tick
+ *                                                                              
+ * Function parameters
+ *     - wheel:     pointer to timer wheel
+ *     - timer:     pointer to timer
+ *     - expires:   tick when the timer expires
+ *
+ *******************************************************************************/
+void TIMER_Set( TIMER_WHEEL* wheel, TIMER_NODE* timer, unsigned long expires )
+{
+  if( timer->next != NULL )
+    _timer_unlink( timer );
+
+  /* the slot of the current tick has been processed already */
+  if( (long) ( expires - wheel->now ) <= 0 )
+    expires = wheel->now + 1;
+
+  timer->expires = expires;
+  _timer_link( wheel, timer );
+}
+
+
+/*******************************************************************************
+ * TIMER_Cancel() 
+ *                                                                         */ /*!
+ * Disarm timer, nothing happens when it is not armed
+ *                                                                              
+ * Function parameters
+ *     - timer:     pointer to timer
+ *
+ *******************************************************************************/
+void TIMER_Cancel( TIMER_NODE* timer )
+{
+  if( timer->next != NULL )
+    _timer_unlink( timer );
+}
+
+
+/*******************************************************************************
+ * TIMER_Advance() 
+ *                                                                         */ /*!
+ * Process all ticks up to given one and invoke handler for each expired
+ * timer. The handler may arm or cancel any timer.
+ *                                                                              
+ * Function parameters
+ *     - wheel:     pointer to timer wheel
+ *     - now:       current tick
+ *     - handler:   invoked for each expired timer
+ *     - context:   passed to handler
+ *
+ *******************************************************************************/
+void TIMER_Advance( TIMER_WHEEL* wheel, const unsigned long now, TIMER_HANDLER handler, void* context )
+{
+  TIMER_NODE*   head;
+  TIMER_NODE*   timer;
+  unsigned long tick;
+  int           level;
+
+  while( (long) ( now - wheel->now ) > 0 )
+  {
+    tick = ++wheel->now;
+
+    /* when a level wraps around, refill it from the next higher level */
+    for( level = 1; level < TIMER_LEVELS; ++level )
+    {
+      if( ( ( tick >> ( TIMER_LEVEL_BITS * ( level - 1 ) ) ) & TIMER_SLOT_MASK ) != 0 )
+        break;
+
+      _timer_cascade( wheel, level, ( tick >> ( TIMER_LEVEL_BITS * level ) ) & TIMER_SLOT_MASK );
+    }
+
+    /* all timers of this slot are expired */
+    head = & wheel->slots[0][ tick & TIMER_SLOT_MASK ];
+    while( ( timer = head->next ) != head )
+    {
+      _timer_unlink( timer );
+      handler( timer, context );
+    }
+  }
+}
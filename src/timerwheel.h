@@ -0,0 +1,144 @@
+/*
+ *  timerwheel.h
+ *  idefix
+ *
+ *  hierarchical timer wheel for supervising a large number of 
+ *  connections with O(1) costs for arming and cancelling timers
+ *
+ *  Copyright 2010 GNU General Public Licence. All rights reserved.
+ *
+ */
+
+#ifndef _TIMERWHEEL_H
+#define _TIMERWHEEL_H
+
+
+/* -- const definitions -----------------------------------------------------------*/
+
+
+/*!
+ *  Number of bits of a tick counter covered by one level of the wheel
+ */
+#define TIMER_LEVEL_BITS            6
+
+
+/*!
+ *  Number of slots per level
+ */
+#define TIMER_SLOTS                 ( 1 << TIMER_LEVEL_BITS )
+
+
+/*!
+ *  Number of levels, timers can expire up to 
+ *  TIMER_SLOTS ^ TIMER_LEVELS - 1 ticks in the future
+ */
+#define TIMER_LEVELS                4
+
+
+
+/* -- public types    -----------------------------------------------------------*/
+
+
+/*!
+ *  Timer, to be embedded into the supervised object
+ */
+typedef struct _TIMER_NODE
+{
+  struct _TIMER_NODE*   prev;       /* double linked list of timers in the same slot */
+  struct _TIMER_NODE*   next;       /* NULL when timer is not armed */
+  unsigned long         expires;    /* tick when the timer expires */
+} TIMER_NODE;
+
+
+/*!
+ *  Callback invoked for expired timers
+ *
+ *  Function parameters
+ *      - timer:     expired timer, already disarmed
+ *      - context:   user data given to TIMER_Advance()
+ */
+typedef void (* TIMER_HANDLER)( TIMER_NODE* timer, void* context );
+
+
+/*!
+ *  Timer wheel
+ */
+typedef struct
+{
+  TIMER_NODE        slots[TIMER_LEVELS][TIMER_SLOTS];   /* list heads */
+  unsigned long     now;                                /* last processed tick */
+} TIMER_WHEEL;
+
+
+
+/* -- public prototypes ----------------------------------------------------------*/
+
+
+/*******************************************************************************
+ * TIMER_WheelInit() 
+ *                                                                         */ /*!
+ * Initialize empty timer wheel
+ *                                                                              
+ * Function parameters
+ *     - wheel:     pointer to timer wheel
+ *     - now:       current tick
+ *
+ *******************************************************************************/
+void TIMER_WheelInit( TIMER_WHEEL* wheel, const unsigned long now );
+
+
+/*******************************************************************************
+ * TIMER_Init() 
+ *                                                                         */ /*!
+ * Initialize disarmed timer
+ *                                                                              
+ * Function parameters
+ *     - timer:     pointer to timer
+ *
+ *******************************************************************************/
+void TIMER_Init( TIMER_NODE* timer );
+
+
+/*******************************************************************************
+ * TIMER_Set() 
+ *                                                                         */ /*!
+ * Arm or re-arm timer, timers in the past expire with the next tick
+ *                                                                              
+ * Function parameters
+ *     - wheel:     pointer to timer wheel
+ *     - timer:     pointer to timer
+ *     - expires:   tick when the timer expires
+ *
+ *******************************************************************************/
+void TIMER_Set( TIMER_WHEEL* wheel, TIMER_NODE* timer, unsigned long expires );
+
+
+/*******************************************************************************
+ * TIMER_Cancel() 
+ *                                                                         */ /*!
+ * Disarm timer, nothing happens when it is not armed
+ *                                                                              
+ * Function parameters
+ *     - timer:     pointer to timer
+ *
+ *******************************************************************************/
+void TIMER_Cancel( TIMER_NODE* timer );
+
+
+/*******************************************************************************
+ * TIMER_Advance() 
+ *                                                                         */ /*!
+ * Process all ticks up to given one and invoke handler for each expired
+ * timer. The handler may arm or cancel any timer.
+ *                                                                              
+ * Function parameters
+ *     - wheel:     pointer to timer wheel
+ *     - now:       current tick
+ *     - handler:   invoked for each expired timer
+ *     - context:   passed to handler
+ *
+ *******************************************************************************/
+void TIMER_Advance( TIMER_WHEEL* wheel, const unsigned long now, TIMER_HANDLER handler, void* context );
+
+
+#endif /* #ifndef _TIMERWHEEL_H */